@@ -0,0 +1,487 @@
+#ifndef FLATMAP_CHUNKED_FLATMAP_HPP
+#define FLATMAP_CHUNKED_FLATMAP_HPP
+
+#include "flatmap.hpp"
+#include <cstddef>
+#include <iterator>
+#include <utility>
+
+// A sorted map in chunks of at most ChunkSize elements, each a sorted
+// vector like the storage of a flatmap, so an insert or erase shifts
+// within one chunk instead of the whole map. A full chunk splits in two
+// halves, and a chunk that falls below a quarter full merges with a
+// neighbour when they fit in one.
+//
+// m_mins holds, for each chunk but the first, a key that is greater than
+// every key of the chunk before it and not greater than any key of the
+// chunk itself. It is the least key of the chunk when the chunk was split
+// off, and is left as is when that key is erased, since it still divides
+// the chunks. A lookup finds the chunk by searching m_mins, and the
+// element by searching the chunk.
+//
+// Iterators are invalidated by inserts and erases, as for flatmap.
+template <typename Key, typename Value, typename Compare = std::less<>, std::size_t ChunkSize = 512>
+class chunked_flatmap : private Compare
+{
+  static_assert(std::is_nothrow_move_constructible<Key>{});
+  static_assert(std::is_nothrow_move_constructible<Value>{});
+  static_assert(ChunkSize >= 4);
+  using element = std::pair<Key, Value>;
+  using chunk = impl::relocating_vector<element>;
+public:
+  using key_type = Key;
+  using mapped_type = Value;
+  using value_type = std::pair<const Key, Value>;
+  using size_type = std::size_t;
+  template <typename container>
+  class iterator_type;
+  using iterator = iterator_type<chunked_flatmap>;
+  using const_iterator = iterator_type<const chunked_flatmap>;
+
+  chunked_flatmap() = default;
+  chunked_flatmap(std::initializer_list<value_type> list);
+  template <typename Iterator,
+            typename EIterator,
+            typename = std::enable_if_t<type_traits::is_input_iterator<Iterator>{} &&
+    type_traits::are_equal_comparable<Iterator, EIterator>{} &&
+                                      std::is_constructible<value_type, typename std::iterator_traits<Iterator>::value_type>{}>>
+  chunked_flatmap(Iterator b, EIterator e);
+
+  void clear() noexcept { m_chunks.clear(); m_mins.clear(); m_size = 0;}
+  bool empty() const noexcept { return m_size == 0;}
+  size_type size() const noexcept { return m_size;}
+  iterator begin() noexcept { return { *this, 0, 0 };}
+  iterator end() noexcept { return { *this, m_chunks.size(), 0 };}
+  const_iterator begin() const noexcept { return { *this, 0, 0 };}
+  const_iterator end() const noexcept { return { *this, m_chunks.size(), 0 };}
+  const_iterator cbegin() const noexcept { return begin();}
+  const_iterator cend() const noexcept { return end();}
+
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, T, Key>{}>>
+  iterator find(const T &key) noexcept;
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, T, Key>{}>>
+  const_iterator find(const T &key) const noexcept;
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, T, Key>{}>>
+  Value& operator[](const T &key);
+  std::pair<iterator, bool> insert(const value_type& v) { return try_emplace(v.first, v.second);}
+  std::pair<iterator, bool> insert(value_type&& v) { return try_emplace(v.first, std::move(v.second));}
+  template <typename K,
+            typename V,
+            typename = std::enable_if_t<type_traits::is_callable<Compare, K, Key>{} &&
+                                        std::is_constructible<Value, V>{} &&
+                                        std::is_assignable<Value&, V>{}>>
+  std::pair<iterator, bool> insert_or_assign(K&& key, V&& value);
+  template <typename ... T, typename = std::enable_if_t<std::is_constructible<value_type, T...>{}>>
+  std::pair<iterator, bool> emplace(T&& ... t);
+  template <typename K,
+            typename ... V,
+            typename = std::enable_if_t<type_traits::is_callable<Compare, K, Key>{} &&
+                                        std::is_constructible<Value, V...>{}>>
+  std::pair<iterator, bool> try_emplace(K&& key, V&& ... v);
+  void erase(iterator i) noexcept;
+  template <typename K, typename = std::enable_if_t<type_traits::is_callable<Compare, K, Key>{}>>
+  size_type erase(const K& key) noexcept;
+  template <typename K, typename = std::enable_if_t<type_traits::is_callable<Compare, K, Key>{}>>
+  size_type count(const K& key) const noexcept { return find_key(key).second ? 1 : 0;}
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, T, Key>{}>>
+  iterator lower_bound(const T& key) noexcept { return at(find_key(key).first);}
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, T, Key>{}>>
+  const_iterator lower_bound(const T& key) const noexcept { return at(find_key(key).first);}
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, T, Key>{}>>
+  iterator upper_bound(const T& key) noexcept { return at(upper_position(key));}
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, T, Key>{}>>
+  const_iterator upper_bound(const T& key) const noexcept { return at(upper_position(key));}
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, T, Key>{}>>
+  std::pair<iterator, iterator> equal_range(const T& key) noexcept;
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, T, Key>{}>>
+  std::pair<const_iterator, const_iterator> equal_range(const T& key) const noexcept;
+  template <typename L,
+            typename H,
+            typename = std::enable_if_t<type_traits::is_callable<Compare, L, Key>{} && type_traits::is_callable<Compare, H, Key>{}>>
+  impl::range_view<iterator> range(const L& lo, const H& hi) noexcept;
+  template <typename L,
+            typename H,
+            typename = std::enable_if_t<type_traits::is_callable<Compare, L, Key>{} && type_traits::is_callable<Compare, H, Key>{}>>
+  impl::range_view<const_iterator> range(const L& lo, const H& hi) const noexcept;
+
+private:
+  // A chunk and an index in it, up to and including its size.
+  struct position
+  {
+    size_type chunk;
+    size_type idx;
+  };
+  static constexpr size_type merge_below = ChunkSize / 4;
+
+  const Compare& compare() const noexcept { return *this;}
+  auto key_compare() const noexcept
+  {
+    const Compare& comp = *this;
+    return [&comp](const auto& lh, const auto& rh) { return comp(key_of(lh), key_of(rh));};
+  }
+  template <typename T>
+  static const T& key_of(const T& t) { return t;}
+  static const Key& key_of(const value_type& v) { return v.first;}
+  static const Key& key_of(const element& v) { return v.first;}
+  template <typename T>
+  size_type chunk_of(const T& key) const noexcept;
+  template <typename T>
+  std::pair<position, bool> find_key(const T& key) const noexcept;
+  template <typename T>
+  position upper_position(const T& key) const noexcept;
+  // The first element at or after p, or end.
+  iterator at(position p) noexcept;
+  const_iterator at(position p) const noexcept;
+  template <typename ... A>
+  iterator emplace_at(position p, A&& ... a);
+  position split(position p);
+  void merge(size_type c) noexcept;
+
+  impl::relocating_vector<chunk> m_chunks;
+  impl::relocating_vector<Key>   m_mins;
+  size_type                      m_size = 0;
+};
+
+template <typename Key, typename Value, typename Compare, std::size_t ChunkSize>
+template <typename container>
+class chunked_flatmap<Key, Value, Compare, ChunkSize>::iterator_type
+{
+  template <typename C>
+  friend class chunked_flatmap<Key, Value, Compare, ChunkSize>::iterator_type;
+  friend class chunked_flatmap<Key, Value, Compare, ChunkSize>;
+public:
+  using value_type = std::conditional_t<std::is_const<container>{}, const typename chunked_flatmap::value_type, typename chunked_flatmap::value_type>;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using pointer = value_type*;
+  using reference = value_type&;
+  using difference_type = std::ptrdiff_t;
+
+  constexpr iterator_type() noexcept = default;
+  constexpr iterator_type(container& c_, size_type chunk_, size_type idx_) noexcept : c{&c_}, chunk{chunk_}, idx{idx_} {}
+  template <typename C, typename = std::enable_if_t<std::is_convertible<C*, container*>{}>>
+  constexpr iterator_type(const iterator_type<C>& i) noexcept : c{i.c}, chunk{i.chunk}, idx{i.idx} {}
+  constexpr iterator_type& operator++() noexcept
+  {
+    if (++idx == c->m_chunks[chunk].size())
+    {
+      ++chunk;
+      idx = 0;
+    }
+    return *this;
+  }
+  constexpr iterator_type operator++(int) noexcept { auto rv = *this; operator++(); return rv;}
+  constexpr iterator_type& operator--() noexcept
+  {
+    if (idx == 0)
+    {
+      idx = c->m_chunks[--chunk].size();
+    }
+    --idx;
+    return *this;
+  }
+  constexpr iterator_type operator--(int) noexcept { auto rv = *this; operator--(); return rv;}
+  reference operator*() const noexcept { return reinterpret_cast<reference>(c->m_chunks[chunk][idx]);}
+  pointer operator->() const noexcept { return &operator*();}
+  template <typename C>
+  constexpr bool operator==(const iterator_type<C>& ci) const noexcept
+  {
+    return c == ci.c && chunk == ci.chunk && idx == ci.idx;
+  }
+  template <typename C>
+  constexpr bool operator!=(const iterator_type<C>& ci) const noexcept
+  {
+    return !(*this == ci);
+  }
+private:
+  container* c = nullptr;
+  size_type chunk = 0;
+  size_type idx = 0;
+};
+
+template <typename Key, typename Value, typename Compare, std::size_t ChunkSize>
+chunked_flatmap<Key, Value, Compare, ChunkSize>::chunked_flatmap(std::initializer_list<value_type> list)
+{
+  for (auto&& x : list)
+  {
+    insert(x);
+  }
+}
+
+template <typename Key, typename Value, typename Compare, std::size_t ChunkSize>
+template <typename Iterator, typename EIterator, typename>
+chunked_flatmap<Key, Value, Compare, ChunkSize>::chunked_flatmap(Iterator b, EIterator e)
+{
+  while (b != e)
+  {
+    emplace(*b);
+    ++b;
+  }
+}
+
+template <typename Key, typename Value, typename Compare, std::size_t ChunkSize>
+template <typename T>
+auto chunked_flatmap<Key, Value, Compare, ChunkSize>::chunk_of(const T& key) const noexcept -> size_type
+{
+  auto i = impl::tuned_lower_bound(m_mins.begin(), m_mins.end(), key, compare(),
+                                   tuning::thresholds<Key>::linear_search_max);
+  if (i != m_mins.end() && !compare()(key, *i)) ++i;
+  return static_cast<size_type>(i - m_mins.begin());
+}
+
+template <typename Key, typename Value, typename Compare, std::size_t ChunkSize>
+template <typename T>
+auto chunked_flatmap<Key, Value, Compare, ChunkSize>::find_key(const T& key) const noexcept -> std::pair<position, bool>
+{
+  if (m_chunks.empty()) return { position{ 0, 0 }, false };
+  auto const c = chunk_of(key);
+  auto& ch = m_chunks[c];
+  auto i = impl::tuned_lower_bound(ch.begin(), ch.end(), key, key_compare(),
+                                   tuning::thresholds<Key>::linear_search_max);
+  auto const exact_match = i != ch.end() && !key_compare()(key, *i);
+  return { position{ c, static_cast<size_type>(i - ch.begin()) }, exact_match };
+}
+
+template <typename Key, typename Value, typename Compare, std::size_t ChunkSize>
+template <typename T>
+auto chunked_flatmap<Key, Value, Compare, ChunkSize>::upper_position(const T& key) const noexcept -> position
+{
+  if (m_chunks.empty()) return { 0, 0 };
+  auto const c = chunk_of(key);
+  auto& ch = m_chunks[c];
+  auto i = std::upper_bound(ch.begin(), ch.end(), key, key_compare());
+  return { c, static_cast<size_type>(i - ch.begin()) };
+}
+
+template <typename Key, typename Value, typename Compare, std::size_t ChunkSize>
+auto chunked_flatmap<Key, Value, Compare, ChunkSize>::at(position p) noexcept -> iterator
+{
+  if (p.chunk != m_chunks.size() && p.idx == m_chunks[p.chunk].size())
+  {
+    return { *this, p.chunk + 1, 0 };
+  }
+  return { *this, p.chunk, p.idx };
+}
+
+template <typename Key, typename Value, typename Compare, std::size_t ChunkSize>
+auto chunked_flatmap<Key, Value, Compare, ChunkSize>::at(position p) const noexcept -> const_iterator
+{
+  return const_cast<chunked_flatmap&>(*this).at(p);
+}
+
+// Splits the full chunk of p in halves, and returns where p is after the
+// split. The allocations come first, so a throw leaves the map as it was.
+// The chunk index grows geometrically, since relocating_vector reserves
+// exactly what it is asked for.
+template <typename Key, typename Value, typename Compare, std::size_t ChunkSize>
+auto chunked_flatmap<Key, Value, Compare, ChunkSize>::split(position p) -> position
+{
+  constexpr size_type half = ChunkSize / 2;
+  Key min(m_chunks[p.chunk][half].first);
+  chunk upper;
+  upper.reserve(ChunkSize);
+  if (m_chunks.size() == m_chunks.capacity())
+  {
+    m_chunks.reserve(std::max(m_chunks.size() + 1, 2 * m_chunks.capacity()));
+  }
+  if (m_mins.size() == m_mins.capacity())
+  {
+    m_mins.reserve(std::max(m_mins.size() + 1, 2 * m_mins.capacity()));
+  }
+
+  auto& lower = m_chunks[p.chunk];
+  for (auto i = lower.begin() + half; i != lower.end(); ++i)
+  {
+    upper.emplace_back(std::move(*i));
+  }
+  lower.erase(lower.begin() + half, lower.end());
+  m_chunks.emplace(m_chunks.begin() + p.chunk + 1, std::move(upper));
+  m_mins.emplace(m_mins.begin() + p.chunk, std::move(min));
+  if (p.idx > half)
+  {
+    return { p.chunk + 1, p.idx - half };
+  }
+  return p;
+}
+
+template <typename Key, typename Value, typename Compare, std::size_t ChunkSize>
+template <typename ... A>
+auto chunked_flatmap<Key, Value, Compare, ChunkSize>::emplace_at(position p, A&& ... a) -> iterator
+{
+  if (m_chunks.empty())
+  {
+    chunk first;
+    first.emplace_back(std::forward<A>(a)...);
+    m_chunks.push_back(std::move(first));
+  }
+  else
+  {
+    if (m_chunks[p.chunk].size() == ChunkSize)
+    {
+      p = split(p);
+    }
+    auto& ch = m_chunks[p.chunk];
+    ch.emplace(ch.begin() + p.idx, std::forward<A>(a)...);
+  }
+  ++m_size;
+  return { *this, p.chunk, p.idx };
+}
+
+// Merges chunk c with a neighbour if it is less than a quarter full and
+// they fit in one chunk, and removes it if it is empty. The chunks get
+// room for ChunkSize elements when they split, so the left one normally
+// has room for both. One without room, as after a copy, is given room
+// first, and the merge is skipped if that allocation fails.
+template <typename Key, typename Value, typename Compare, std::size_t ChunkSize>
+void chunked_flatmap<Key, Value, Compare, ChunkSize>::merge(size_type c) noexcept
+{
+  if (m_chunks[c].size() >= merge_below) return;
+  if (m_chunks[c].empty())
+  {
+    m_chunks.erase(m_chunks.begin() + c);
+    if (!m_mins.empty()) m_mins.erase(m_mins.begin() + (c ? c - 1 : 0));
+    return;
+  }
+  if (m_chunks.size() == 1) return;
+  auto const left = c + 1 == m_chunks.size() ? c - 1 : c;
+  auto& lower = m_chunks[left];
+  auto& upper = m_chunks[left + 1];
+  auto const n = lower.size() + upper.size();
+  if (n > ChunkSize) return;
+  if (n > lower.capacity())
+  {
+    try
+    {
+      lower.reserve(ChunkSize);
+    }
+    catch (...)
+    {
+      return;
+    }
+  }
+  for (auto& x : upper)
+  {
+    lower.emplace_back(std::move(x));
+  }
+  m_chunks.erase(m_chunks.begin() + left + 1);
+  m_mins.erase(m_mins.begin() + left);
+}
+
+template <typename Key, typename Value, typename Compare, std::size_t ChunkSize>
+template <typename T, typename>
+auto chunked_flatmap<Key, Value, Compare, ChunkSize>::find(const T& key) noexcept -> iterator
+{
+  auto [ p, exact_match ] = find_key(key);
+  return exact_match ? iterator{ *this, p.chunk, p.idx } : end();
+}
+
+template <typename Key, typename Value, typename Compare, std::size_t ChunkSize>
+template <typename T, typename>
+auto chunked_flatmap<Key, Value, Compare, ChunkSize>::find(const T& key) const noexcept -> const_iterator
+{
+  auto [ p, exact_match ] = find_key(key);
+  return exact_match ? const_iterator{ *this, p.chunk, p.idx } : end();
+}
+
+template <typename Key, typename Value, typename Compare, std::size_t ChunkSize>
+template <typename T, typename>
+auto chunked_flatmap<Key, Value, Compare, ChunkSize>::operator[](const T& key) -> Value&
+{
+  auto [ p, exact_match ] = find_key(key);
+  if (exact_match) return m_chunks[p.chunk][p.idx].second;
+  return emplace_at(p, key, Value{})->second;
+}
+
+template <typename Key, typename Value, typename Compare, std::size_t ChunkSize>
+template <typename K, typename V, typename>
+auto chunked_flatmap<Key, Value, Compare, ChunkSize>::insert_or_assign(K&& key, V&& value) -> std::pair<iterator, bool>
+{
+  auto [ p, exact_match ] = find_key(key);
+  if (exact_match)
+  {
+    m_chunks[p.chunk][p.idx].second = std::forward<V>(value);
+    return { iterator{ *this, p.chunk, p.idx }, false };
+  }
+  return { emplace_at(p, std::forward<K>(key), std::forward<V>(value)), true };
+}
+
+template <typename Key, typename Value, typename Compare, std::size_t ChunkSize>
+template <typename ... T, typename>
+auto chunked_flatmap<Key, Value, Compare, ChunkSize>::emplace(T&& ... t) -> std::pair<iterator, bool>
+{
+  element v(std::forward<T>(t)...);
+  auto [ p, exact_match ] = find_key(v.first);
+  if (exact_match)
+  {
+    return { iterator{ *this, p.chunk, p.idx }, false };
+  }
+  return { emplace_at(p, std::move(v)), true };
+}
+
+template <typename Key, typename Value, typename Compare, std::size_t ChunkSize>
+template <typename K, typename ... V, typename>
+auto chunked_flatmap<Key, Value, Compare, ChunkSize>::try_emplace(K&& key, V&& ... v) -> std::pair<iterator, bool>
+{
+  auto [ p, exact_match ] = find_key(key);
+  if (exact_match)
+  {
+    return { iterator{ *this, p.chunk, p.idx }, false };
+  }
+  return { emplace_at(p, std::forward<K>(key), Value(std::forward<V>(v)...)), true };
+}
+
+template <typename Key, typename Value, typename Compare, std::size_t ChunkSize>
+void chunked_flatmap<Key, Value, Compare, ChunkSize>::erase(iterator i) noexcept
+{
+  auto& ch = m_chunks[i.chunk];
+  ch.erase(ch.begin() + i.idx);
+  --m_size;
+  merge(i.chunk);
+}
+
+template <typename Key, typename Value, typename Compare, std::size_t ChunkSize>
+template <typename K, typename>
+auto chunked_flatmap<Key, Value, Compare, ChunkSize>::erase(const K& key) noexcept -> size_type
+{
+  auto [ p, exact_match ] = find_key(key);
+  if (!exact_match) return 0;
+  erase(iterator{ *this, p.chunk, p.idx });
+  return 1;
+}
+
+template <typename Key, typename Value, typename Compare, std::size_t ChunkSize>
+template <typename T, typename>
+auto chunked_flatmap<Key, Value, Compare, ChunkSize>::equal_range(const T& key) noexcept -> std::pair<iterator, iterator>
+{
+  auto [ p, exact_match ] = find_key(key);
+  auto const b = at(p);
+  return { b, exact_match ? std::next(b) : b };
+}
+
+template <typename Key, typename Value, typename Compare, std::size_t ChunkSize>
+template <typename T, typename>
+auto chunked_flatmap<Key, Value, Compare, ChunkSize>::equal_range(const T& key) const noexcept -> std::pair<const_iterator, const_iterator>
+{
+  auto [ p, exact_match ] = find_key(key);
+  auto const b = at(p);
+  return { b, exact_match ? std::next(b) : b };
+}
+
+template <typename Key, typename Value, typename Compare, std::size_t ChunkSize>
+template <typename L, typename H, typename>
+auto chunked_flatmap<Key, Value, Compare, ChunkSize>::range(const L& lo, const H& hi) noexcept -> impl::range_view<iterator>
+{
+  auto const b = lower_bound(lo);
+  auto const e = lower_bound(hi);
+  auto const empty = e.chunk < b.chunk || (e.chunk == b.chunk && e.idx < b.idx);
+  return { b, empty ? b : e };
+}
+
+template <typename Key, typename Value, typename Compare, std::size_t ChunkSize>
+template <typename L, typename H, typename>
+auto chunked_flatmap<Key, Value, Compare, ChunkSize>::range(const L& lo, const H& hi) const noexcept -> impl::range_view<const_iterator>
+{
+  auto const r = const_cast<chunked_flatmap&>(*this).range(lo, hi);
+  return { r.begin(), r.end() };
+}
+
+#endif //FLATMAP_CHUNKED_FLATMAP_HPP
@@ -2,11 +2,19 @@
 #define FLATMAP_FLATMAP_HPP
 
 #include <vector>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <type_traits>
 #include <experimental/type_traits>
 #include <algorithm>
+#include <memory>
 #include <new>
 #include <tuple>
+#include <utility>
+#include <string>
+#include <string_view>
 
 namespace type_traits {
   template <typename T, typename U>
@@ -24,14 +32,1070 @@ namespace type_traits {
   template <typename I>
   using is_input_iterator
     = typename std::is_base_of<std::input_iterator_tag, typename std::iterator_traits<I>::iterator_category>::type;
+
+  template <typename I>
+  using is_forward_iterator
+    = typename std::is_base_of<std::forward_iterator_tag, typename std::iterator_traits<I>::iterator_category>::type;
+
+  // Strings whose std::less order is the character order. Pointers such
+  // as const char* convert to std::string_view too, but std::less orders
+  // them by address.
+  template <typename T>
+  struct is_char_string : std::false_type {};
+
+  template <typename A>
+  struct is_char_string<std::basic_string<char, std::char_traits<char>, A>> : std::true_type {};
+
+  template <>
+  struct is_char_string<std::string_view> : std::true_type {};
+
+  template <typename Compare, typename Key>
+  using is_lexicographic
+    = std::integral_constant<bool,
+                             is_char_string<Key>{} &&
+                             (std::is_same<Compare, std::less<>>{} || std::is_same<Compare, std::less<Key>>{})>;
+
+  // Whether moving a T to other storage and destroying the source is the
+  // same as copying its bytes. The maps then shift and grow their storage
+  // with memmove. Defaults to trivially copyable types and the standard
+  // library types below. Specialize it as std::true_type for other types
+  // that hold no pointers into themselves.
+  template <typename T>
+  struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+  template <typename T, typename U>
+  struct is_trivially_relocatable<std::pair<T, U>>
+    : std::integral_constant<bool, is_trivially_relocatable<T>{} && is_trivially_relocatable<U>{}> {};
+
+  template <typename T, typename D>
+  struct is_trivially_relocatable<std::unique_ptr<T, D>> : is_trivially_relocatable<D> {};
+
+  template <typename T>
+  struct is_trivially_relocatable<std::shared_ptr<T>> : std::true_type {};
+
+#if defined(_LIBCPP_VERSION)
+  // libc++ keeps short strings inline without pointing to them. libstdc++
+  // points to its inline buffer, so its strings are not relocatable.
+  template <typename C, typename T, typename A>
+  struct is_trivially_relocatable<std::basic_string<C, T, A>> : is_trivially_relocatable<A> {};
+#endif
+}
+
+namespace tuning {
+  // Crossover points for a key type. flatmap_tune measures them on the
+  // machine it runs on, and writes flatmap_tuning.hpp with specializations
+  // for the key types it measured. Other key types, and all key types in
+  // a build that never ran it, use these defaults, which always bisect.
+  template <typename Key>
+  struct thresholds
+  {
+    // The sorted maps search up to this many keys linearly, rather than by
+    // bisection.
+    static constexpr std::size_t linear_search_max = 0;
+    // From this many elements a hash map looks up faster than the sorted
+    // maps. Not used here, but by code choosing a container.
+    static constexpr std::size_t hash_min = static_cast<std::size_t>(-1);
+  };
+}
+
+#if __has_include("flatmap_tuning.hpp")
+#include "flatmap_tuning.hpp"
+#endif
+
+#if !defined(FLATMAP_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define FLATMAP_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace simd {
+  // Vectorized scans of 32 and 64 bit integer key columns. The kernel for
+  // each instruction set is compiled with a target attribute, and the best
+  // one the CPU supports is picked the first time a scan runs, so the maps
+  // do not need to be built with -march. Define FLATMAP_NO_SIMD to always
+  // scan with plain loops.
+  enum class isa { scalar, sse4_2, avx2, avx512 };
+
+  constexpr const char* name(isa i) noexcept
+  {
+    switch (i)
+    {
+      case isa::sse4_2: return "sse4.2";
+      case isa::avx2:   return "avx2";
+      case isa::avx512: return "avx512";
+      default:          return "scalar";
+    }
+  }
+
+  // The best instruction set the CPU, and the OS, supports.
+  inline isa detected() noexcept
+  {
+#if defined(FLATMAP_SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return isa::avx512;
+    if (__builtin_cpu_supports("avx2")) return isa::avx2;
+    if (__builtin_cpu_supports("sse4.2")) return isa::sse4_2;
+#endif
+    return isa::scalar;
+  }
+
+  namespace kernels {
+    template <typename T>
+    using is_key = std::integral_constant<bool, std::is_integral<T>{} && !std::is_same<T, bool>{} &&
+                                                (sizeof(T) == 4 || sizeof(T) == 8)>;
+
+    // The index of the first of the n keys at p equal to key, or n.
+    template <typename T>
+    std::size_t find_equal_scalar(const T* p, std::size_t n, T key) noexcept
+    {
+      return static_cast<std::size_t>(std::find(p, p + n, key) - p);
+    }
+
+    // How many of the n keys at p are less than key. For sorted keys that
+    // is the lower bound.
+    template <typename T>
+    std::size_t count_less_scalar(const T* p, std::size_t n, T key) noexcept
+    {
+      std::size_t rv = 0;
+      for (std::size_t i = 0; i != n; ++i)
+      {
+        rv += p[i] < key;
+      }
+      return rv;
+    }
+
+#if defined(FLATMAP_SIMD_X86)
+    template <typename T>
+    __attribute__((target("sse4.2")))
+    std::size_t find_equal_sse4_2(const T* p, std::size_t n, T key) noexcept
+    {
+      constexpr std::size_t lanes = 16 / sizeof(T);
+      std::size_t i = 0;
+      for (; i + lanes <= n; i += lanes)
+      {
+        auto const v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        int mask;
+        if constexpr (sizeof(T) == 4)
+        {
+          mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, _mm_set1_epi32(static_cast<int>(key)))));
+        }
+        else
+        {
+          mask = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(v, _mm_set1_epi64x(static_cast<long long>(key)))));
+        }
+        if (mask) return i + static_cast<std::size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+      }
+      return i + find_equal_scalar(p + i, n - i, key);
+    }
+
+    template <typename T>
+    __attribute__((target("sse4.2")))
+    std::size_t count_less_sse4_2(const T* p, std::size_t n, T key) noexcept
+    {
+      constexpr std::size_t lanes = 16 / sizeof(T);
+      std::size_t rv = 0;
+      std::size_t i = 0;
+      for (; i + lanes <= n; i += lanes)
+      {
+        auto const v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        int mask;
+        if constexpr (sizeof(T) == 4)
+        {
+          mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(_mm_set1_epi32(static_cast<int>(key)), v)));
+        }
+        else
+        {
+          mask = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(_mm_set1_epi64x(static_cast<long long>(key)), v)));
+        }
+        rv += static_cast<std::size_t>(__builtin_popcount(static_cast<unsigned>(mask)));
+      }
+      return rv + count_less_scalar(p + i, n - i, key);
+    }
+
+    template <typename T>
+    __attribute__((target("avx2")))
+    std::size_t find_equal_avx2(const T* p, std::size_t n, T key) noexcept
+    {
+      constexpr std::size_t lanes = 32 / sizeof(T);
+      std::size_t i = 0;
+      for (; i + lanes <= n; i += lanes)
+      {
+        auto const v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        int mask;
+        if constexpr (sizeof(T) == 4)
+        {
+          mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, _mm256_set1_epi32(static_cast<int>(key)))));
+        }
+        else
+        {
+          mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, _mm256_set1_epi64x(static_cast<long long>(key)))));
+        }
+        if (mask) return i + static_cast<std::size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+      }
+      return i + find_equal_scalar(p + i, n - i, key);
+    }
+
+    template <typename T>
+    __attribute__((target("avx2")))
+    std::size_t count_less_avx2(const T* p, std::size_t n, T key) noexcept
+    {
+      constexpr std::size_t lanes = 32 / sizeof(T);
+      std::size_t rv = 0;
+      std::size_t i = 0;
+      for (; i + lanes <= n; i += lanes)
+      {
+        auto const v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        int mask;
+        if constexpr (sizeof(T) == 4)
+        {
+          mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(key)), v)));
+        }
+        else
+        {
+          mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(_mm256_set1_epi64x(static_cast<long long>(key)), v)));
+        }
+        rv += static_cast<std::size_t>(__builtin_popcount(static_cast<unsigned>(mask)));
+      }
+      return rv + count_less_scalar(p + i, n - i, key);
+    }
+
+    // AVX-512 handles the tail with a masked load, rather than a scalar loop.
+    template <typename T>
+    __attribute__((target("avx512f")))
+    std::size_t find_equal_avx512(const T* p, std::size_t n, T key) noexcept
+    {
+      constexpr std::size_t lanes = 64 / sizeof(T);
+      for (std::size_t i = 0; i < n; i += lanes)
+      {
+        auto const left = std::min(lanes, n - i);
+        unsigned mask;
+        if constexpr (sizeof(T) == 4)
+        {
+          auto const valid = static_cast<__mmask16>((1U << left) - 1U);
+          auto const v = _mm512_maskz_loadu_epi32(valid, p + i);
+          mask = _mm512_mask_cmpeq_epi32_mask(valid, v, _mm512_set1_epi32(static_cast<int>(key)));
+        }
+        else
+        {
+          auto const valid = static_cast<__mmask8>((1U << left) - 1U);
+          auto const v = _mm512_maskz_loadu_epi64(valid, p + i);
+          mask = _mm512_mask_cmpeq_epi64_mask(valid, v, _mm512_set1_epi64(static_cast<long long>(key)));
+        }
+        if (mask) return i + static_cast<std::size_t>(__builtin_ctz(mask));
+      }
+      return n;
+    }
+
+    template <typename T>
+    __attribute__((target("avx512f")))
+    std::size_t count_less_avx512(const T* p, std::size_t n, T key) noexcept
+    {
+      constexpr std::size_t lanes = 64 / sizeof(T);
+      std::size_t rv = 0;
+      for (std::size_t i = 0; i < n; i += lanes)
+      {
+        auto const left = std::min(lanes, n - i);
+        unsigned mask;
+        if constexpr (sizeof(T) == 4)
+        {
+          auto const valid = static_cast<__mmask16>((1U << left) - 1U);
+          auto const v = _mm512_maskz_loadu_epi32(valid, p + i);
+          mask = _mm512_mask_cmplt_epi32_mask(valid, v, _mm512_set1_epi32(static_cast<int>(key)));
+        }
+        else
+        {
+          auto const valid = static_cast<__mmask8>((1U << left) - 1U);
+          auto const v = _mm512_maskz_loadu_epi64(valid, p + i);
+          mask = _mm512_mask_cmplt_epi64_mask(valid, v, _mm512_set1_epi64(static_cast<long long>(key)));
+        }
+        rv += static_cast<std::size_t>(__builtin_popcount(mask));
+      }
+      return rv;
+    }
+#endif
+
+    // One function pointer per scan and key width, all for one instruction
+    // set. Equality does not care about signedness, so the signed kernels
+    // serve the unsigned keys too.
+    struct table
+    {
+      std::size_t (*find_equal32)(const std::int32_t*, std::size_t, std::int32_t) noexcept;
+      std::size_t (*find_equal64)(const std::int64_t*, std::size_t, std::int64_t) noexcept;
+      std::size_t (*count_less32)(const std::int32_t*, std::size_t, std::int32_t) noexcept;
+      std::size_t (*count_less64)(const std::int64_t*, std::size_t, std::int64_t) noexcept;
+    };
+
+#define FLATMAP_SIMD_TABLE(suffix) \
+    table{ find_equal_##suffix<std::int32_t>, find_equal_##suffix<std::int64_t>, \
+           count_less_##suffix<std::int32_t>, count_less_##suffix<std::int64_t> }
+
+    inline const table& table_for(isa i) noexcept
+    {
+      static const table scalar = FLATMAP_SIMD_TABLE(scalar);
+#if defined(FLATMAP_SIMD_X86)
+      static const table sse4_2 = FLATMAP_SIMD_TABLE(sse4_2);
+      static const table avx2 = FLATMAP_SIMD_TABLE(avx2);
+      static const table avx512 = FLATMAP_SIMD_TABLE(avx512);
+      switch (i)
+      {
+        case isa::sse4_2: return sse4_2;
+        case isa::avx2:   return avx2;
+        case isa::avx512: return avx512;
+        default:          break;
+      }
+#else
+      static_cast<void>(i);
+#endif
+      return scalar;
+    }
+
+#undef FLATMAP_SIMD_TABLE
+
+    inline std::atomic<const table*>& active() noexcept
+    {
+      static std::atomic<const table*> rv{&table_for(detected())};
+      return rv;
+    }
+
+    inline std::atomic<isa>& active_isa() noexcept
+    {
+      static std::atomic<isa> rv{detected()};
+      return rv;
+    }
+
+    template <typename T>
+    using word = std::conditional_t<sizeof(T) == 4, std::int32_t, std::int64_t>;
+
+    // Keys the kernels may read as words. A long long column, where
+    // std::int64_t is long, is scanned by the scalar loop instead.
+    template <typename T>
+    using aliases_word = std::integral_constant<bool, std::is_same<T, word<T>>{} ||
+                                                      std::is_same<T, std::make_unsigned_t<word<T>>>{}>;
+  }
+
+  // The instruction set the scans use.
+  inline isa active() noexcept
+  {
+    return kernels::active_isa().load(std::memory_order_relaxed);
+  }
+
+  // Makes the scans use i, or the best supported instruction set below it,
+  // and returns the one in effect. Meant for comparing the kernels, before
+  // the maps are used.
+  inline isa force(isa i) noexcept
+  {
+    auto const best = detected();
+    if (static_cast<int>(i) > static_cast<int>(best)) i = best;
+    kernels::active_isa().store(i, std::memory_order_relaxed);
+    kernels::active().store(&kernels::table_for(i), std::memory_order_relaxed);
+    return i;
+  }
+
+  template <typename T, typename = std::enable_if_t<kernels::is_key<T>{}>>
+  std::size_t find_equal(const T* p, std::size_t n, T key) noexcept
+  {
+    using w = kernels::word<T>;
+    auto const& t = *kernels::active().load(std::memory_order_relaxed);
+    if constexpr (!kernels::aliases_word<T>{})
+    {
+      return kernels::find_equal_scalar(p, n, key);
+    }
+    else if constexpr (sizeof(T) == 4)
+    {
+      return t.find_equal32(reinterpret_cast<const w*>(p), n, static_cast<w>(key));
+    }
+    else
+    {
+      return t.find_equal64(reinterpret_cast<const w*>(p), n, static_cast<w>(key));
+    }
+  }
+
+  template <typename T, typename = std::enable_if_t<kernels::is_key<T>{} && std::is_signed<T>{}>>
+  std::size_t count_less(const T* p, std::size_t n, T key) noexcept
+  {
+    using w = kernels::word<T>;
+    auto const& t = *kernels::active().load(std::memory_order_relaxed);
+    if constexpr (!kernels::aliases_word<T>{})
+    {
+      return kernels::count_less_scalar(p, n, key);
+    }
+    else if constexpr (sizeof(T) == 4)
+    {
+      return t.count_less32(reinterpret_cast<const w*>(p), n, static_cast<w>(key));
+    }
+    else
+    {
+      return t.count_less64(reinterpret_cast<const w*>(p), n, static_cast<w>(key));
+    }
+  }
 }
 
 namespace impl
 {
+  // Grants non-member algorithms, like serialization, access to the columns.
+  struct storage_access;
+
+  template <typename Iterator>
+  class range_view
+  {
+  public:
+    constexpr range_view(Iterator b, Iterator e) noexcept : m_begin{b}, m_end{e} {}
+    constexpr Iterator begin() const noexcept { return m_begin;}
+    constexpr Iterator end() const noexcept { return m_end;}
+    constexpr bool empty() const noexcept { return m_begin == m_end;}
+  private:
+    Iterator m_begin;
+    Iterator m_end;
+  };
+
+  // Iterators into a column the simd kernels can read, for a key type they
+  // can scan.
+  template <typename Iterator, typename V = typename std::iterator_traits<Iterator>::value_type>
+  using is_simd_column
+    = std::integral_constant<bool, simd::kernels::is_key<V>{} &&
+                                   (std::is_pointer<Iterator>{} ||
+                                    std::is_same<Iterator, typename std::vector<V>::iterator>{} ||
+                                    std::is_same<Iterator, typename std::vector<V>::const_iterator>{})>;
+
+  template <typename Iterator, typename T, typename Compare,
+            typename V = typename std::iterator_traits<Iterator>::value_type>
+  using is_simd_ordered
+    = std::integral_constant<bool, is_simd_column<Iterator>{} && std::is_signed<V>{} && std::is_same<T, V>{} &&
+                                   (std::is_same<Compare, std::less<>>{} || std::is_same<Compare, std::less<V>>{})>;
+
+  // lower_bound that scans [b, e) linearly when it holds at most
+  // linear_max keys. See tuning::thresholds.
+  template <typename Iterator, typename T, typename Compare>
+  Iterator tuned_lower_bound(Iterator b, Iterator e, const T& t, Compare comp, std::size_t linear_max)
+  {
+    auto const n = static_cast<std::size_t>(e - b);
+    if (n <= linear_max)
+    {
+      if constexpr (is_simd_ordered<Iterator, T, Compare>{})
+      {
+        return n == 0 ? b : b + static_cast<std::ptrdiff_t>(simd::count_less(std::addressof(*b), n, t));
+      }
+      else
+      {
+        return std::find_if(b, e, [&](const auto& k) { return !comp(k, t);});
+      }
+    }
+    return std::lower_bound(b, e, t, comp);
+  }
+
+  // The index of the first key in the column [b, e) equal to t, or its size.
+  template <typename Key, typename T>
+  std::size_t find_index(const Key* b, const Key* e, const T& t) noexcept
+  {
+    if constexpr (simd::kernels::is_key<Key>{} && std::is_same<T, Key>{})
+    {
+      return simd::find_equal(b, static_cast<std::size_t>(e - b), t);
+    }
+    else
+    {
+      return static_cast<std::size_t>(std::find_if(b, e, [&](auto& x) { return x == t;}) - b);
+    }
+  }
+
+  // The first key not less than t in the sorted key column [b, e), and
+  // whether it is equivalent to t.
+  template <typename Iterator, typename T, typename Compare>
+  std::pair<Iterator, bool> search_keys(Iterator b, Iterator e, const T& t, Compare comp, std::size_t linear_max = 0)
+  {
+    auto i = tuned_lower_bound(b, e, t, comp, linear_max);
+    return { i, i != e && !comp(t, *i) };
+  }
+
+  // lower_bound that probes 1, 2, 4... elements ahead of b before bisecting,
+  // so that a sequence of increasing searches costs O(log distance) each.
+  template <typename Iterator, typename T, typename Compare>
+  Iterator gallop_lower_bound(Iterator b, Iterator e, const T& t, Compare comp)
+  {
+    using d = typename std::iterator_traits<Iterator>::difference_type;
+    d step = 1;
+    while (step <= e - b && comp(b[step - 1], t))
+    {
+      b += step;
+      step *= 2;
+    }
+    return std::lower_bound(b, b + std::min(step - 1, d(e - b)), t, comp);
+  }
+
+  // When one sorted sequence is this many times longer than the other,
+  // merge_walk gallops through the longer one instead of stepping.
+  constexpr std::size_t gallop_ratio = 8;
+
+  // Walks the sorted [a, ae) and [b, be) in step. Runs of elements only
+  // in a are passed to only_a(first, last), runs only in b to
+  // only_b(first, last), and elements in both to both(i, j), all in
+  // order. Between sequences of very different lengths, this takes
+  // O(m log(n/m)) comparisons rather than O(n + m).
+  template <typename Iterator, typename Compare, typename OnlyA, typename OnlyB, typename Both>
+  void merge_walk(Iterator a, Iterator ae, Iterator b, Iterator be, Compare comp, OnlyA&& only_a, OnlyB&& only_b, Both&& both)
+  {
+    auto const na = static_cast<std::size_t>(ae - a);
+    auto const nb = static_cast<std::size_t>(be - b);
+    if (na / gallop_ratio >= nb)
+    {
+      for (; b != be; ++b)
+      {
+        auto const n = gallop_lower_bound(a, ae, *b, comp);
+        if (n != a) only_a(a, n);
+        a = n;
+        if (a != ae && !comp(*b, *a)) both(a++, b);
+        else only_b(b, b + 1);
+      }
+    }
+    else if (nb / gallop_ratio >= na)
+    {
+      for (; a != ae; ++a)
+      {
+        auto const n = gallop_lower_bound(b, be, *a, comp);
+        if (n != b) only_b(b, n);
+        b = n;
+        if (b != be && !comp(*a, *b)) both(a, b++);
+        else only_a(a, a + 1);
+      }
+    }
+    else
+    {
+      while (a != ae && b != be)
+      {
+        if (comp(*a, *b)) { only_a(a, a + 1); ++a;}
+        else if (comp(*b, *a)) { only_b(b, b + 1); ++b;}
+        else both(a++, b++);
+      }
+    }
+    if (a != ae) only_a(a, ae);
+    if (b != be) only_b(b, be);
+  }
+
+  // The conflict resolution of merge and the set operations unless one is
+  // given: the value from the first map.
+  struct keep_first
+  {
+    template <typename T, typename U>
+    T&& operator()(T&& t, U&&) const noexcept { return std::forward<T>(t);}
+  };
+
+  // Moves from into the constructed to. A move assignment that may throw
+  // is replaced by destroying to and move constructing it, so that the
+  // maps only need move construction not to throw.
+  template <typename T>
+  void move_assign(T& to, T& from) noexcept
+  {
+    if constexpr (std::is_nothrow_move_assignable<T>{})
+    {
+      to = std::move(from);
+    }
+    else
+    {
+      to.~T();
+      ::new(std::addressof(to)) T(std::move(from));
+    }
+  }
+
+  // Moves [b, e) to the unconstructed to, destroying the sources.
+  template <typename T>
+  void relocate(T* b, T* e, T* to) noexcept
+  {
+    if constexpr (type_traits::is_trivially_relocatable<T>{})
+    {
+      if (b != e) std::memmove(static_cast<void*>(to), static_cast<const void*>(b), static_cast<std::size_t>(e - b) * sizeof(T));
+    }
+    else
+    {
+      for (; b != e; ++b, ++to)
+      {
+        ::new(to) T(std::move(*b));
+        b->~T();
+      }
+    }
+  }
+
+  // Moves [b, e) to to, which is not below b, destroying the sources. The
+  // ranges may overlap, and what of [to, to + (e - b)) lies outside
+  // [b, e) is unconstructed.
+  template <typename T>
+  void relocate_up(T* b, T* e, T* to) noexcept
+  {
+    if constexpr (type_traits::is_trivially_relocatable<T>{})
+    {
+      if (b != e) std::memmove(static_cast<void*>(to), static_cast<const void*>(b), static_cast<std::size_t>(e - b) * sizeof(T));
+    }
+    else
+    {
+      for (auto n = e - b; n-- != 0;)
+      {
+        ::new(to + n) T(std::move(b[n]));
+        b[n].~T();
+      }
+    }
+  }
+
+  // The elements of [b, e), reserved up front when the length is known.
+  template <typename T, typename Iterator, typename EIterator>
+  std::vector<T> collect(Iterator b, EIterator e)
+  {
+    std::vector<T> rv;
+    if constexpr (type_traits::is_forward_iterator<Iterator>{} && std::is_same<Iterator, EIterator>{})
+    {
+      rv.reserve(static_cast<std::size_t>(std::distance(b, e)));
+    }
+    for (; b != e; ++b)
+    {
+      rv.emplace_back(*b);
+    }
+    return rv;
+  }
+
+  // The indexes of the elements of batch in key order, with one index for
+  // each key: that of the first element with it, or with keep_last that
+  // of the last. The indexes are sorted rather than the elements, so each
+  // element moves only once, into the map.
+  template <bool keep_last, typename Batch, typename Compare>
+  std::vector<std::size_t> sorted_unique_order(const Batch& batch, Compare comp)
+  {
+    std::vector<std::size_t> order(batch.size());
+    for (std::size_t i = 0; i != order.size(); ++i) order[i] = i;
+    auto const by_key = [&batch, &comp](std::size_t lh, std::size_t rh) { return comp(batch[lh], batch[rh]);};
+    if (!std::is_sorted(order.begin(), order.end(), by_key))
+    {
+      std::stable_sort(order.begin(), order.end(), by_key);
+    }
+    auto out = order.begin();
+    for (auto i = order.begin(); i != order.end();)
+    {
+      auto j = std::next(i);
+      while (j != order.end() && !by_key(*i, *j)) ++j;
+      *out++ = keep_last ? *std::prev(j) : *i;
+      i = j;
+    }
+    order.erase(out, order.end());
+    return order;
+  }
+
+  // The lower bound in the sorted [b, e) of each element of batch, taken
+  // in the sorted order, galloping from one to the next.
+  template <typename Iterator, typename Batch, typename Compare>
+  std::vector<std::size_t> insert_positions(Iterator b, Iterator e, const Batch& batch, const std::vector<std::size_t>& order, Compare comp)
+  {
+    std::vector<std::size_t> rv;
+    rv.reserve(order.size());
+    auto cursor = b;
+    for (auto i : order)
+    {
+      cursor = gallop_lower_bound(cursor, e, batch[i], comp);
+      rv.push_back(static_cast<std::size_t>(cursor - b));
+    }
+    return rv;
+  }
+
+  // The permutation that sorts the keys [0, n), as the index of the key
+  // that goes to each position, or an empty one if they are sorted
+  // already. Equal keys keep their order if Stable.
+  template <bool Stable, typename Key, typename Compare>
+  std::vector<std::size_t> sort_order(std::size_t n, const Key* keys, Compare comp)
+  {
+    if (std::is_sorted(keys, keys + n, comp)) return {};
+    std::vector<std::size_t> order(n);
+    for (std::size_t i = 0; i != n; ++i) order[i] = i;
+    auto const by_key = [&comp, keys](std::size_t lh, std::size_t rh) { return comp(keys[lh], keys[rh]);};
+    if constexpr (Stable) std::stable_sort(order.begin(), order.end(), by_key);
+    else std::sort(order.begin(), order.end(), by_key);
+    return order;
+  }
+
+  // Moves the elements of the columns to where order, from sort_order,
+  // puts them, moving each element once. Each cycle of order is rotated
+  // through one saved element per column, with the done positions marked
+  // by pointing them at themselves.
+  template <typename ... T>
+  void permute_columns(std::vector<std::size_t>& order, T* ... columns) noexcept
+  {
+    for (std::size_t i = 0; i != order.size(); ++i)
+    {
+      if (order[i] == i) continue;
+      std::tuple<T...> saved(std::move(columns[i])...);
+      auto j = i;
+      for (auto from = order[j]; from != i; from = order[j])
+      {
+        (move_assign(columns[j], columns[from]), ...);
+        order[j] = j;
+        j = from;
+      }
+      std::apply([&](auto& ... s) { (move_assign(columns[j], s), ...);}, saved);
+      order[j] = j;
+    }
+  }
+
+  // Sorts the elements of the columns [0, n) by keys, moving each element
+  // once. Elements with equal keys keep their order if Stable.
+  template <bool Stable = false, typename Key, typename Compare, typename ... T>
+  void sort_columns(std::size_t n, const Key* keys, Compare comp, T* ... columns)
+  {
+    auto order = sort_order<Stable>(n, keys, comp);
+    permute_columns(order, columns...);
+  }
+
+  // Moves the non-empty [b, e) one step up, into the unconstructed e,
+  // leaving b unconstructed.
+  template <typename T>
+  void shift_up(T* b, T* e) noexcept
+  {
+    if constexpr (type_traits::is_trivially_relocatable<T>{})
+    {
+      std::memmove(static_cast<void*>(b + 1), static_cast<const void*>(b), static_cast<std::size_t>(e - b) * sizeof(T));
+    }
+    else if constexpr (!std::is_nothrow_move_assignable<T>{})
+    {
+      relocate_up(b, e, b + 1);
+    }
+    else
+    {
+      ::new(e) T(std::move(e[-1]));
+      std::move_backward(b, e - 1, e);
+      b->~T();
+    }
+  }
+
+  // Removes b by moving (b, e) one step down, leaving e - 1 unconstructed.
+  template <typename T>
+  void shift_down(T* b, T* e) noexcept
+  {
+    if constexpr (type_traits::is_trivially_relocatable<T>{})
+    {
+      b->~T();
+      std::memmove(static_cast<void*>(b), static_cast<const void*>(b + 1), static_cast<std::size_t>(e - b - 1) * sizeof(T));
+    }
+    else if constexpr (!std::is_nothrow_move_assignable<T>{})
+    {
+      b->~T();
+      relocate(b + 1, e, b);
+    }
+    else
+    {
+      std::move(b + 1, e, b);
+      e[-1].~T();
+    }
+  }
+
+  // Removes [b, m) by moving [m, e) down to b, leaving the last m - b
+  // positions of [b, e) unconstructed.
+  template <typename T>
+  void close_gap(T* b, T* m, T* e) noexcept
+  {
+    if (b == m) return;
+    if constexpr (type_traits::is_trivially_relocatable<T>{})
+    {
+      std::destroy(b, m);
+      std::memmove(static_cast<void*>(b), static_cast<const void*>(m), static_cast<std::size_t>(e - m) * sizeof(T));
+    }
+    else if constexpr (!std::is_nothrow_move_assignable<T>{})
+    {
+      std::destroy(b, m);
+      relocate(m, e, b);
+    }
+    else
+    {
+      std::destroy(std::move(m, e, b), e);
+    }
+  }
+
+  // The subset of std::vector the maps use, shifting and growing with
+  // relocate, shift_up and shift_down, so that trivially relocatable
+  // elements move with memmove. An insertion either completes or leaves
+  // the vector as it was. Unlike std::vector, it does not copy elements
+  // whose move may throw, but requires T to be nothrow move constructible.
+  template <typename T>
+  class relocating_vector
+  {
+    static_assert(std::is_nothrow_move_constructible<T>{}, "elements must be nothrow move constructible, see README.md");
+  public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    relocating_vector() = default;
+    relocating_vector(const relocating_vector& rh);
+    relocating_vector(relocating_vector&& rh) noexcept;
+    relocating_vector& operator=(const relocating_vector& rh);
+    relocating_vector& operator=(relocating_vector&& rh) noexcept;
+    ~relocating_vector();
+
+    void swap(relocating_vector& rh) noexcept;
+
+    bool empty() const noexcept { return m_size == 0;}
+    size_type size() const noexcept { return m_size;}
+    size_type capacity() const noexcept { return m_capacity;}
+    T* data() noexcept { return m_data;}
+    const T* data() const noexcept { return m_data;}
+    iterator begin() noexcept { return m_data;}
+    iterator end() noexcept { return m_data + m_size;}
+    const_iterator begin() const noexcept { return m_data;}
+    const_iterator end() const noexcept { return m_data + m_size;}
+    T& operator[](size_type i) noexcept { return m_data[i];}
+    const T& operator[](size_type i) const noexcept { return m_data[i];}
+    T& back() noexcept { return m_data[m_size - 1];}
+    const T& back() const noexcept { return m_data[m_size - 1];}
+
+    void clear() noexcept;
+    void reserve(size_type n);
+    // Value initializes any added elements.
+    void resize(size_type n);
+    template <typename ... A>
+    iterator emplace(const_iterator pos, A&& ... a);
+    iterator insert(const_iterator pos, const T& t) { return emplace(pos, t);}
+    iterator insert(const_iterator pos, T&& t) { return emplace(pos, std::move(t));}
+    template <typename ... A>
+    T& emplace_back(A&& ... a) { return *emplace(end(), std::forward<A>(a)...);}
+    void push_back(const T& t) { emplace_back(t);}
+    void push_back(T&& t) { emplace_back(std::move(t));}
+    iterator erase(const_iterator pos) noexcept;
+    iterator erase(const_iterator first, const_iterator last) noexcept;
+    // Moves batch[order[j]] in before the element at pos[j], for the n
+    // ascending positions pos, in one pass from the back that moves each
+    // element at most once. The capacity must already hold them.
+    void insert_sorted(T* batch, const size_type* order, const size_type* pos, size_type n) noexcept;
+    void insert_sorted(relocating_vector& batch, const size_type* order, const size_type* pos, size_type n) noexcept
+    {
+      insert_sorted(batch.data(), order, pos, n);
+    }
+    // As insert_sorted, but builds the result in grown, empty and reserved
+    // for it, and swaps with it, so that each element moves once.
+    void insert_sorted(relocating_vector& grown, relocating_vector& batch, const size_type* order, const size_type* pos, size_type n) noexcept;
+    // Makes the n elements the caller constructed past the end, within
+    // the capacity, part of the vector.
+    void append_constructed(size_type n) noexcept { m_size += n;}
+    // Removes the elements that pred holds for in one pass, keeping the
+    // order of the rest, and returns how many it removed. If pred throws,
+    // the elements it held for so far are removed and the rest kept.
+    template <typename Pred>
+    size_type erase_if(Pred pred);
+    void pop_back() noexcept;
+  private:
+    template <typename ... A>
+    iterator emplace_grow(size_type pos, A&& ... a);
+
+    T*        m_data = nullptr;
+    size_type m_size = 0;
+    size_type m_capacity = 0;
+  };
+
+  template <typename T>
+  relocating_vector<T>::relocating_vector(const relocating_vector& rh)
+    : relocating_vector()
+  {
+    reserve(rh.m_size);
+    for (auto& t : rh)
+    {
+      emplace_back(t);
+    }
+  }
+
+  template <typename T>
+  relocating_vector<T>::relocating_vector(relocating_vector&& rh) noexcept
+    : m_data(std::exchange(rh.m_data, nullptr))
+    , m_size(std::exchange(rh.m_size, 0))
+    , m_capacity(std::exchange(rh.m_capacity, 0))
+  {
+  }
+
+  template <typename T>
+  auto relocating_vector<T>::operator=(const relocating_vector& rh) -> relocating_vector&
+  {
+    if (this != &rh)
+    {
+      relocating_vector(rh).swap(*this);
+    }
+    return *this;
+  }
+
+  template <typename T>
+  auto relocating_vector<T>::operator=(relocating_vector&& rh) noexcept -> relocating_vector&
+  {
+    relocating_vector(std::move(rh)).swap(*this);
+    return *this;
+  }
+
+  template <typename T>
+  relocating_vector<T>::~relocating_vector()
+  {
+    clear();
+    if (m_data) std::allocator<T>{}.deallocate(m_data, m_capacity);
+  }
+
+  template <typename T>
+  void relocating_vector<T>::swap(relocating_vector& rh) noexcept
+  {
+    std::swap(m_data, rh.m_data);
+    std::swap(m_size, rh.m_size);
+    std::swap(m_capacity, rh.m_capacity);
+  }
+
+  template <typename T>
+  void relocating_vector<T>::clear() noexcept
+  {
+    std::destroy(begin(), end());
+    m_size = 0;
+  }
+
+  template <typename T>
+  void relocating_vector<T>::reserve(size_type n)
+  {
+    if (n <= m_capacity) return;
+    relocating_vector grown;
+    grown.m_data = std::allocator<T>{}.allocate(n);
+    grown.m_capacity = n;
+    relocate(begin(), end(), grown.m_data);
+    grown.m_size = std::exchange(m_size, 0);
+    swap(grown);
+  }
+
+  template <typename T>
+  void relocating_vector<T>::resize(size_type n)
+  {
+    if (n < m_size)
+    {
+      std::destroy(begin() + n, end());
+      m_size = n;
+      return;
+    }
+    reserve(n);
+    while (m_size != n)
+    {
+      emplace_back();
+    }
+  }
+
+  template <typename T>
+  template <typename ... A>
+  auto relocating_vector<T>::emplace(const_iterator pos, A&& ... a) -> iterator
+  {
+    auto const idx = static_cast<size_type>(pos - m_data);
+    if (m_size == m_capacity)
+    {
+      return emplace_grow(idx, std::forward<A>(a)...);
+    }
+    if (idx == m_size)
+    {
+      ::new(m_data + idx) T(std::forward<A>(a)...);
+    }
+    else
+    {
+      // Constructed aside first, since a may refer to an element that is
+      // about to move, and so that a throw leaves the elements untouched.
+      T t(std::forward<A>(a)...);
+      shift_up(m_data + idx, end());
+      ::new(m_data + idx) T(std::move(t));
+    }
+    ++m_size;
+    return m_data + idx;
+  }
+
+  template <typename T>
+  template <typename ... A>
+  auto relocating_vector<T>::emplace_grow(size_type idx, A&& ... a) -> iterator
+  {
+    relocating_vector grown;
+    grown.m_capacity = m_capacity ? 2 * m_capacity : 1;
+    grown.m_data = std::allocator<T>{}.allocate(grown.m_capacity);
+    ::new(grown.m_data + idx) T(std::forward<A>(a)...);
+    relocate(begin(), begin() + idx, grown.m_data);
+    relocate(begin() + idx, end(), grown.m_data + idx + 1);
+    grown.m_size = std::exchange(m_size, 0) + 1;
+    swap(grown);
+    return m_data + idx;
+  }
+
+  template <typename T>
+  auto relocating_vector<T>::erase(const_iterator pos) noexcept -> iterator
+  {
+    auto const p = m_data + (pos - m_data);
+    shift_down(p, end());
+    --m_size;
+    return p;
+  }
+
+  template <typename T>
+  auto relocating_vector<T>::erase(const_iterator first, const_iterator last) noexcept -> iterator
+  {
+    auto const b = m_data + (first - m_data);
+    close_gap(b, m_data + (last - m_data), end());
+    m_size -= static_cast<size_type>(last - first);
+    return b;
+  }
+
+  template <typename T>
+  template <typename Pred>
+  auto relocating_vector<T>::erase_if(Pred pred) -> size_type
+  {
+    auto kept = std::find_if(begin(), end(), [&pred](T& t) { return pred(t);});
+    if (kept == end()) return 0;
+    auto i = kept + 1;
+    try
+    {
+      for (; i != end(); ++i)
+      {
+        if (!pred(*i)) move_assign(*kept++, *i);
+      }
+    }
+    catch (...)
+    {
+      erase(kept, i);
+      throw;
+    }
+    auto const removed = static_cast<size_type>(end() - kept);
+    std::destroy(kept, end());
+    m_size -= removed;
+    return removed;
+  }
+
+  template <typename T>
+  void relocating_vector<T>::insert_sorted(T* batch, const size_type* order, const size_type* pos, size_type n) noexcept
+  {
+    auto end = m_size;
+    for (auto j = n; j-- != 0;)
+    {
+      relocate_up(m_data + pos[j], m_data + end, m_data + pos[j] + j + 1);
+      ::new(m_data + pos[j] + j) T(std::move(batch[order[j]]));
+      end = pos[j];
+    }
+    m_size += n;
+  }
+  template <typename T>
+  void relocating_vector<T>::insert_sorted(relocating_vector& grown, relocating_vector& batch, const size_type* order, const size_type* pos, size_type n) noexcept
+  {
+    auto out = grown.m_data;
+    size_type from = 0;
+    for (size_type j = 0; j != n; ++j)
+    {
+      relocate(m_data + from, m_data + pos[j], out);
+      out += pos[j] - from;
+      from = pos[j];
+      ::new(out++) T(std::move(batch[order[j]]));
+    }
+    relocate(m_data + from, m_data + m_size, out);
+    grown.m_size = m_size + n;
+    m_size = 0;
+    swap(grown);
+  }
+
+
+  template <typename T>
+  void relocating_vector<T>::pop_back() noexcept
+  {
+    --m_size;
+    m_data[m_size].~T();
+  }
+
   template <typename Key, typename Value>
   class flatmap_storage
   {
-    using storage = std::vector<std::pair<Key, Value>>;
+    using storage = relocating_vector<std::pair<Key, Value>>;
   public:
     using value_type = std::pair<const Key, Value>;
     using size_type = typename storage::size_type;
@@ -61,18 +1125,372 @@ namespace impl
     storage m_values;
   };
 
+  // The key and value columns of the split maps, in one allocation. Each
+  // column starts on a cache line, and growing relocates both at once. The
+  // first allocation fills the cache line of the keys. An insertion either
+  // completes or leaves the columns as they were. Keys and values must be
+  // nothrow move constructible, since relocating them cannot fail.
+  template <typename Key, typename Value>
+  class split_columns
+  {
+    static_assert(std::is_nothrow_move_constructible<Key>{}, "keys must be nothrow move constructible, see README.md");
+    static_assert(std::is_nothrow_move_constructible<Value>{}, "values must be nothrow move constructible, see README.md");
+  public:
+    using size_type = std::size_t;
+
+    split_columns() = default;
+    split_columns(const split_columns& rh);
+    split_columns(split_columns&& rh) noexcept;
+    split_columns& operator=(const split_columns& rh);
+    split_columns& operator=(split_columns&& rh) noexcept;
+    ~split_columns();
+
+    void swap(split_columns& rh) noexcept;
+
+    bool empty() const noexcept { return m_size == 0;}
+    size_type size() const noexcept { return m_size;}
+    size_type capacity() const noexcept { return m_capacity;}
+
+    Key* keys() noexcept { return reinterpret_cast<Key*>(m_data);}
+    const Key* keys() const noexcept { return reinterpret_cast<const Key*>(m_data);}
+    Value* values() noexcept { return reinterpret_cast<Value*>(m_data + value_offset(m_capacity));}
+    const Value* values() const noexcept { return reinterpret_cast<const Value*>(m_data + value_offset(m_capacity));}
+
+    void clear() noexcept;
+    void reserve(size_type n);
+    // Default constructs any added keys and values.
+    void resize(size_type n);
+    // Inserts a key constructed from k and a value constructed from v at
+    // pos in both columns.
+    template <typename K, typename ... V>
+    void emplace(size_type pos, K&& k, V&& ... v);
+    void erase(size_type pos) noexcept;
+    void erase(size_type first, size_type last) noexcept;
+    // Moves the keys and values of batch[order[j]] in before the elements
+    // at pos[j], as relocating_vector does.
+    template <typename Pair>
+    void insert_sorted(Pair* batch, const size_type* order, const size_type* pos, size_type n) noexcept;
+    void insert_sorted(split_columns& batch, const size_type* order, const size_type* pos, size_type n) noexcept;
+    // As insert_sorted, but builds the result in grown, empty and reserved
+    // for it, and swaps with it, so that each element moves once.
+    void insert_sorted(split_columns& grown, split_columns& batch, const size_type* order, const size_type* pos, size_type n) noexcept;
+    // Makes the n keys and values the caller constructed past the end of
+    // both columns, within the capacity, part of the columns.
+    void append_constructed(size_type n) noexcept { m_size += n;}
+    // Removes the elements where pred(key, value) holds from both columns
+    // in one pass, keeping the order of the rest, and returns how many it
+    // removed. If pred throws, the elements it held for so far are removed
+    // and the rest kept.
+    template <typename Pred>
+    size_type erase_if(Pred pred);
+    void pop_back() noexcept;
+  private:
+    static constexpr size_type line = 64;
+    static constexpr size_type alignment = std::max({line, alignof(Key), alignof(Value)});
+
+    static constexpr size_type round_up(size_type n, size_type a) noexcept { return (n + a - 1) / a * a;}
+    static constexpr size_type value_offset(size_type capacity) noexcept
+    {
+      return round_up(capacity * sizeof(Key), std::max(line, alignof(Value)));
+    }
+    static std::byte* allocate(size_type capacity);
+    static void deallocate(std::byte* p) noexcept;
+    template <typename K, typename ... V>
+    void emplace_grow(size_type pos, K&& k, V&& ... v);
+
+    std::byte* m_data = nullptr;
+    size_type  m_size = 0;
+    size_type  m_capacity = 0;
+  };
+
+  template <typename Key, typename Value>
+  split_columns<Key, Value>::split_columns(const split_columns& rh)
+    : split_columns()
+  {
+    reserve(rh.m_size);
+    for (size_type i = 0; i != rh.m_size; ++i)
+    {
+      emplace(i, rh.keys()[i], rh.values()[i]);
+    }
+  }
+
+  template <typename Key, typename Value>
+  split_columns<Key, Value>::split_columns(split_columns&& rh) noexcept
+    : m_data(std::exchange(rh.m_data, nullptr))
+    , m_size(std::exchange(rh.m_size, 0))
+    , m_capacity(std::exchange(rh.m_capacity, 0))
+  {
+  }
+
+  template <typename Key, typename Value>
+  auto split_columns<Key, Value>::operator=(const split_columns& rh) -> split_columns&
+  {
+    if (this != &rh)
+    {
+      split_columns(rh).swap(*this);
+    }
+    return *this;
+  }
+
+  template <typename Key, typename Value>
+  auto split_columns<Key, Value>::operator=(split_columns&& rh) noexcept -> split_columns&
+  {
+    split_columns(std::move(rh)).swap(*this);
+    return *this;
+  }
+
+  template <typename Key, typename Value>
+  split_columns<Key, Value>::~split_columns()
+  {
+    clear();
+    deallocate(m_data);
+  }
+
+  template <typename Key, typename Value>
+  void split_columns<Key, Value>::swap(split_columns& rh) noexcept
+  {
+    std::swap(m_data, rh.m_data);
+    std::swap(m_size, rh.m_size);
+    std::swap(m_capacity, rh.m_capacity);
+  }
+
+  template <typename Key, typename Value>
+  void split_columns<Key, Value>::clear() noexcept
+  {
+    std::destroy(keys(), keys() + m_size);
+    std::destroy(values(), values() + m_size);
+    m_size = 0;
+  }
+
+  template <typename Key, typename Value>
+  void split_columns<Key, Value>::reserve(size_type n)
+  {
+    if (n <= m_capacity) return;
+    split_columns grown;
+    grown.m_data = allocate(n);
+    grown.m_capacity = n;
+    relocate(keys(), keys() + m_size, grown.keys());
+    relocate(values(), values() + m_size, grown.values());
+    grown.m_size = std::exchange(m_size, 0);
+    swap(grown);
+  }
+
+  template <typename Key, typename Value>
+  void split_columns<Key, Value>::resize(size_type n)
+  {
+    if (n < m_size)
+    {
+      std::destroy(keys() + n, keys() + m_size);
+      std::destroy(values() + n, values() + m_size);
+      m_size = n;
+      return;
+    }
+    reserve(n);
+    while (m_size != n)
+    {
+      emplace(m_size, Key());
+    }
+  }
+
+  template <typename Key, typename Value>
+  template <typename K, typename ... V>
+  void split_columns<Key, Value>::emplace(size_type pos, K&& k, V&& ... v)
+  {
+    if (m_size == m_capacity)
+    {
+      emplace_grow(pos, std::forward<K>(k), std::forward<V>(v)...);
+    }
+    else if (pos == m_size)
+    {
+      ::new(keys() + pos) Key(std::forward<K>(k));
+      try
+      {
+        ::new(values() + pos) Value(std::forward<V>(v)...);
+      }
+      catch (...)
+      {
+        keys()[pos].~Key();
+        throw;
+      }
+      ++m_size;
+    }
+    else
+    {
+      // Constructed aside first, since k or v may refer to an element that
+      // is about to move, and so that a throw leaves the columns untouched.
+      Key key(std::forward<K>(k));
+      Value value(std::forward<V>(v)...);
+      shift_up(keys() + pos, keys() + m_size);
+      shift_up(values() + pos, values() + m_size);
+      ::new(keys() + pos) Key(std::move(key));
+      ::new(values() + pos) Value(std::move(value));
+      ++m_size;
+    }
+  }
+
+  template <typename Key, typename Value>
+  template <typename K, typename ... V>
+  void split_columns<Key, Value>::emplace_grow(size_type pos, K&& k, V&& ... v)
+  {
+    split_columns grown;
+    grown.m_capacity = m_capacity ? 2 * m_capacity : std::max<size_type>(1, line / sizeof(Key));
+    grown.m_data = allocate(grown.m_capacity);
+    ::new(grown.keys() + pos) Key(std::forward<K>(k));
+    try
+    {
+      ::new(grown.values() + pos) Value(std::forward<V>(v)...);
+    }
+    catch (...)
+    {
+      grown.keys()[pos].~Key();
+      throw;
+    }
+    relocate(keys(), keys() + pos, grown.keys());
+    relocate(keys() + pos, keys() + m_size, grown.keys() + pos + 1);
+    relocate(values(), values() + pos, grown.values());
+    relocate(values() + pos, values() + m_size, grown.values() + pos + 1);
+    grown.m_size = std::exchange(m_size, 0) + 1;
+    swap(grown);
+  }
+
+  template <typename Key, typename Value>
+  void split_columns<Key, Value>::erase(size_type pos) noexcept
+  {
+    shift_down(keys() + pos, keys() + m_size);
+    shift_down(values() + pos, values() + m_size);
+    --m_size;
+  }
+
+  template <typename Key, typename Value>
+  void split_columns<Key, Value>::erase(size_type first, size_type last) noexcept
+  {
+    close_gap(keys() + first, keys() + last, keys() + m_size);
+    close_gap(values() + first, values() + last, values() + m_size);
+    m_size -= last - first;
+  }
+
+  template <typename Key, typename Value>
+  template <typename Pred>
+  auto split_columns<Key, Value>::erase_if(Pred pred) -> size_type
+  {
+    auto const k = keys();
+    auto const v = values();
+    size_type kept = 0;
+    while (kept != m_size && !pred(k[kept], v[kept])) ++kept;
+    if (kept == m_size) return 0;
+    auto i = kept + 1;
+    try
+    {
+      for (; i != m_size; ++i)
+      {
+        if (pred(k[i], v[i])) continue;
+        move_assign(k[kept], k[i]);
+        move_assign(v[kept], v[i]);
+        ++kept;
+      }
+    }
+    catch (...)
+    {
+      erase(kept, i);
+      throw;
+    }
+    auto const removed = m_size - kept;
+    std::destroy(k + kept, k + m_size);
+    std::destroy(v + kept, v + m_size);
+    m_size = kept;
+    return removed;
+  }
+
+  template <typename Key, typename Value>
+  template <typename Pair>
+  void split_columns<Key, Value>::insert_sorted(Pair* batch, const size_type* order, const size_type* pos, size_type n) noexcept
+  {
+    auto const k = keys();
+    auto const v = values();
+    auto end = m_size;
+    for (auto j = n; j-- != 0;)
+    {
+      relocate_up(k + pos[j], k + end, k + pos[j] + j + 1);
+      relocate_up(v + pos[j], v + end, v + pos[j] + j + 1);
+      ::new(k + pos[j] + j) Key(std::move(batch[order[j]].first));
+      ::new(v + pos[j] + j) Value(std::move(batch[order[j]].second));
+      end = pos[j];
+    }
+    m_size += n;
+  }
+  template <typename Key, typename Value>
+  void split_columns<Key, Value>::insert_sorted(split_columns& batch, const size_type* order, const size_type* pos, size_type n) noexcept
+  {
+    auto const k = keys();
+    auto const v = values();
+    auto end = m_size;
+    for (auto j = n; j-- != 0;)
+    {
+      relocate_up(k + pos[j], k + end, k + pos[j] + j + 1);
+      relocate_up(v + pos[j], v + end, v + pos[j] + j + 1);
+      ::new(k + pos[j] + j) Key(std::move(batch.keys()[order[j]]));
+      ::new(v + pos[j] + j) Value(std::move(batch.values()[order[j]]));
+      end = pos[j];
+    }
+    m_size += n;
+  }
+  template <typename Key, typename Value>
+  void split_columns<Key, Value>::insert_sorted(split_columns& grown, split_columns& batch, const size_type* order, const size_type* pos, size_type n) noexcept
+  {
+    auto const k = keys();
+    auto const v = values();
+    auto const gk = grown.keys();
+    auto const gv = grown.values();
+    size_type from = 0;
+    for (size_type j = 0; j != n; ++j)
+    {
+      relocate(k + from, k + pos[j], gk + from + j);
+      relocate(v + from, v + pos[j], gv + from + j);
+      from = pos[j];
+      ::new(gk + from + j) Key(std::move(batch.keys()[order[j]]));
+      ::new(gv + from + j) Value(std::move(batch.values()[order[j]]));
+    }
+    relocate(k + from, k + m_size, gk + from + n);
+    relocate(v + from, v + m_size, gv + from + n);
+    grown.m_size = m_size + n;
+    m_size = 0;
+    swap(grown);
+  }
+
+
+
+  template <typename Key, typename Value>
+  void split_columns<Key, Value>::pop_back() noexcept
+  {
+    --m_size;
+    keys()[m_size].~Key();
+    values()[m_size].~Value();
+  }
+
+  template <typename Key, typename Value>
+  std::byte* split_columns<Key, Value>::allocate(size_type capacity)
+  {
+    auto const bytes = value_offset(capacity) + capacity * sizeof(Value);
+    return static_cast<std::byte*>(::operator new(bytes, std::align_val_t{alignment}));
+  }
+
+  template <typename Key, typename Value>
+  void split_columns<Key, Value>::deallocate(std::byte* p) noexcept
+  {
+    if (p) ::operator delete(p, std::align_val_t{alignment});
+  }
+
 template <typename Key, typename Value>
 class split_flatmap_storage
 {
-  using key_storage = std::vector<Key>;
-  using value_storage = std::vector<Value>;
+  using columns = split_columns<Key, Value>;
 public:
   using key_type = Key;
   using mapped_type = Value;
   using value_type = std::pair<Key, Value>;
   using reference = std::pair<const Key&, Value&>&;
   using pointer = std::pair<const Key&, Value&>*;
-  using size_type = typename key_storage::size_type;
+  using size_type = typename columns::size_type;
 
   split_flatmap_storage() = default;
 
@@ -81,28 +1499,39 @@ public:
   using iterator = iterator_type<split_flatmap_storage>;
   using const_iterator = iterator_type<const split_flatmap_storage>;
 
-  void clear() noexcept { m_keys.clear();m_values.clear();}
-  bool empty() const noexcept { return m_values.empty();}
-  size_type size() const noexcept { return m_values.size();}
+  void clear() noexcept { m_columns.clear();}
+  bool empty() const noexcept { return m_columns.empty();}
+  size_type size() const noexcept { return m_columns.size();}
 
   iterator begin() noexcept { return iterator{*this, 0};}
-  iterator end() noexcept { return iterator{*this, m_keys.size()};}
+  iterator end() noexcept { return iterator{*this, m_columns.size()};}
   const_iterator begin() const noexcept { return const_iterator{*this, 0};}
-  const_iterator end() const noexcept { return const_iterator{*this, m_keys.size()};}
+  const_iterator end() const noexcept { return const_iterator{*this, m_columns.size()};}
   const_iterator cbegin() const noexcept { return begin();}
   const_iterator cend() const noexcept { return end();}
 
 protected:
+  Key* key_begin() noexcept { return m_columns.keys();}
+  Key* key_end() noexcept { return m_columns.keys() + m_columns.size();}
+  const Key* key_begin() const noexcept { return m_columns.keys();}
+  const Key* key_end() const noexcept { return m_columns.keys() + m_columns.size();}
 
-  key_storage m_keys;
-  value_storage m_values;
+  columns m_columns;
 };
 }
+
+namespace type_traits {
+  // Only pointers and sizes, none of which point into the vector itself.
+  template <typename T>
+  struct is_trivially_relocatable<impl::relocating_vector<T>> : std::true_type {};
+}
+
 template <typename Key, typename Value>
 class unordered_flatmap : private impl::flatmap_storage<Key, Value>
 {
-  static_assert(std::is_nothrow_move_constructible<Key>{});
-  static_assert(std::is_nothrow_move_constructible<Value>{});
+  static_assert(std::is_nothrow_move_constructible<Key>{}, "keys must be nothrow move constructible, see README.md");
+  static_assert(std::is_nothrow_move_constructible<Value>{}, "values must be nothrow move constructible, see README.md");
+  friend struct impl::storage_access;
 public:
   using value_type =     typename impl::flatmap_storage<Key, Value>::value_type;
   using iterator =       typename impl::flatmap_storage<Key, Value>::iterator;
@@ -130,7 +1559,7 @@ public:
   std::pair<iterator, bool> insert(value_type&& v);
   template <typename K,
             typename V,
-            typename = std::enable_if_t<type_traits::are_equal_comparable<Key, K>{} && std::is_constructible<Value, V>{} && std::is_assignable<Value, V>{}>>
+            typename = std::enable_if_t<type_traits::are_equal_comparable<Key, K>{} && std::is_constructible<Value, V>{} && std::is_assignable<Value&, V>{}>>
   std::pair<iterator, bool> insert_or_assign(K&& k, V&& v);
   template <typename ... T, typename = std::enable_if_t<std::is_constructible<value_type, T...>{}>>
   std::pair<iterator, bool> emplace(T&& ... t);
@@ -139,6 +1568,7 @@ public:
             typename = std::enable_if_t<type_traits::are_equal_comparable<Key, K>{} && std::is_constructible<Value, V...>{}>>
   std::pair<iterator, bool> try_emplace(K&& key, V&& ... v);
   void erase(iterator i);
+  iterator erase(const_iterator first, const_iterator last);
   template <typename K, typename = std::enable_if_t<type_traits::are_equal_comparable<Key, const K&>{}>>
   size_type erase(const K& key);
   template <typename T, typename = std::enable_if_t<type_traits::are_equal_comparable<Key, T>{}>>
@@ -152,8 +1582,9 @@ public:
 template <typename Key, typename Value>
 class unordered_split_flatmap : private impl::split_flatmap_storage<Key, Value>
 {
-  static_assert(std::is_nothrow_move_constructible<Key>{});
-  static_assert(std::is_nothrow_move_constructible<Value>{});
+  static_assert(std::is_nothrow_move_constructible<Key>{}, "keys must be nothrow move constructible, see README.md");
+  static_assert(std::is_nothrow_move_constructible<Value>{}, "values must be nothrow move constructible, see README.md");
+  friend struct impl::storage_access;
 public:
   using key_type = Key;
   using mapped_type = Value;
@@ -185,7 +1616,7 @@ public:
   std::pair<iterator, bool> insert(value_type&& v);
   template <typename K,
             typename V,
-            typename = std::enable_if_t<type_traits::are_equal_comparable<Key, K>{} && std::is_constructible<Value, V>{} && std::is_assignable<Value, V>{}>>
+            typename = std::enable_if_t<type_traits::are_equal_comparable<Key, K>{} && std::is_constructible<Value, V>{} && std::is_assignable<Value&, V>{}>>
   std::pair<iterator, bool> insert_or_assign(K&& k, V&& v);
   template <typename ... T, typename = std::enable_if_t<std::is_constructible<value_type, T...>{}>>
   std::pair<iterator, bool> emplace(T&& ... t);
@@ -194,6 +1625,7 @@ public:
             typename = std::enable_if_t<type_traits::are_equal_comparable<Key, K>{} && std::is_constructible<Value, V...>{}>>
   std::pair<iterator, bool> try_emplace(K&& key, V&& ... v);
   void erase(iterator i);
+  iterator erase(const_iterator first, const_iterator last);
   template <typename K, typename = std::enable_if_t<type_traits::are_equal_comparable<Key, const K&>{}>>
   size_type erase(const K& key);
   template <typename T, typename = std::enable_if_t<type_traits::are_equal_comparable<Key, T>{}>>
@@ -207,8 +1639,9 @@ public:
 template <typename Key, typename Value, typename Compare = std::less<>>
 class split_flatmap : private impl::split_flatmap_storage<Key, Value>, private Compare
 {
-  static_assert(std::is_nothrow_move_constructible<Key>{});
-  static_assert(std::is_nothrow_move_constructible<Value>{});
+  static_assert(std::is_nothrow_move_constructible<Key>{}, "keys must be nothrow move constructible, see README.md");
+  static_assert(std::is_nothrow_move_constructible<Value>{}, "values must be nothrow move constructible, see README.md");
+  friend struct impl::storage_access;
 public:
   using key_type = Key;
   using mapped_type = Value;
@@ -240,7 +1673,7 @@ public:
   std::pair<iterator, bool> insert(value_type&& v);
   template <typename K,
             typename V,
-            typename = std::enable_if_t<type_traits::is_callable<Compare, Key, K>{} && std::is_constructible<Value, V>{} && std::is_assignable<Value, V>{}>>
+            typename = std::enable_if_t<type_traits::is_callable<Compare, Key, K>{} && std::is_constructible<Value, V>{} && std::is_assignable<Value&, V>{}>>
   std::pair<iterator, bool> insert_or_assign(K&& k, V&& v);
   template <typename ... T, typename = std::enable_if_t<std::is_constructible<value_type, T...>{}>>
   std::pair<iterator, bool> emplace(T&& ... t);
@@ -249,6 +1682,7 @@ public:
             typename = std::enable_if_t<type_traits::is_callable<Compare, Key, K>{} && std::is_constructible<Value, V...>{}>>
   std::pair<iterator, bool> try_emplace(K&& key, V&& ... v);
   void erase(iterator i);
+  iterator erase(const_iterator first, const_iterator last);
   template <typename K, typename = std::enable_if_t<type_traits::is_callable<Compare, K, Key>{}>>
   size_type erase(const K& key);
   template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, Key, T>{}>>
@@ -257,24 +1691,75 @@ public:
   iterator find(const T &key) noexcept;
   template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, Key, T>{}>>
   const_iterator find(const T &key) const noexcept;
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, Key, T>{}>>
+  iterator lower_bound(const T& key) noexcept { return { *this, lower_index(key)};}
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, Key, T>{}>>
+  const_iterator lower_bound(const T& key) const noexcept { return { *this, lower_index(key)};}
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, Key, T>{}>>
+  iterator upper_bound(const T& key) noexcept { return { *this, upper_index(key)};}
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, Key, T>{}>>
+  const_iterator upper_bound(const T& key) const noexcept { return { *this, upper_index(key)};}
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, Key, T>{}>>
+  std::pair<iterator, iterator> equal_range(const T& key) noexcept;
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, Key, T>{}>>
+  std::pair<const_iterator, const_iterator> equal_range(const T& key) const noexcept;
+  template <typename L,
+            typename H,
+            typename = std::enable_if_t<type_traits::is_callable<Compare, Key, L>{} && type_traits::is_callable<Compare, Key, H>{}>>
+  impl::range_view<iterator> range(const L& lo, const H& hi) noexcept;
+  template <typename L,
+            typename H,
+            typename = std::enable_if_t<type_traits::is_callable<Compare, Key, L>{} && type_traits::is_callable<Compare, Key, H>{}>>
+  impl::range_view<const_iterator> range(const L& lo, const H& hi) const noexcept;
+  template <typename Iterator, typename F>
+  void scan_ranges(Iterator b, Iterator e, F&& f);
+  template <typename Iterator, typename F>
+  void scan_ranges(Iterator b, Iterator e, F&& f) const;
+  template <typename C = Compare, typename = std::enable_if_t<type_traits::is_lexicographic<C, Key>{}>>
+  impl::range_view<iterator> prefix_range(std::string_view prefix) noexcept;
+  template <typename C = Compare, typename = std::enable_if_t<type_traits::is_lexicographic<C, Key>{}>>
+  impl::range_view<const_iterator> prefix_range(std::string_view prefix) const noexcept;
+  // Moves the elements of other into this map in one linear merge. A key
+  // in both maps gets the value resolve(this value, other value), with
+  // both passed as rvalues. All comparisons and calls to resolve are done
+  // before any element moves, so if one throws, both maps are left as
+  // they were; a resolve that is not noexcept gets copies of copyable
+  // values for that.
+  template <typename Resolve = impl::keep_first>
+  void merge(split_flatmap&& other, Resolve resolve = {});
+  // Inserts the elements of [b, e) whose keys are not in the map, the first
+  // of any repeated key. The batch is sorted aside and merged in from the
+  // back after one reservation, so each element moves at most once.
+  template <typename Iterator, typename EIterator>
+  void insert_many(Iterator b, EIterator e) { insert_batch<false>(b, e);}
+  // As insert_many, but assigns the values of keys already in the map,
+  // and the last of any repeated key wins.
+  template <typename Iterator, typename EIterator>
+  void insert_or_assign_many(Iterator b, EIterator e) { insert_batch<true>(b, e);}
 private:
-  auto key_iter(iterator i)
+  auto key_compare() const noexcept
   {
-    using d = typename std::iterator_traits<iterator>::difference_type;
-    return this->m_keys.begin() + static_cast<d>(index(i));
+    const Compare& comp = *this;
+    return [&comp](const auto& lh, const auto& rh) { return comp(key_of(lh), key_of(rh));};
   }
-  auto value_iter(iterator i)
-  {
-    using d = typename std::iterator_traits<iterator>::difference_type;
-    return this->m_values.begin() + static_cast<d>(index(i));
-  }
-  static const Key& key_of(const Key& k) { return k;}
+  // For searches of the key column, which need no key_of, and where
+  // impl::tuned_lower_bound recognizes std::less for the simd kernels.
+  const Compare& key_column_compare() const noexcept { return *this;}
+  template <typename T>
+  static const T& key_of(const T& t) { return t;}
   static const Key& key_of(const value_type& v) { return v.first;}
 
+  template <typename T>
+  size_type lower_index(const T& t) const noexcept;
+  template <typename T>
+  size_type upper_index(const T& t) const noexcept;
+  std::pair<size_type, size_type> prefix_indexes(std::string_view prefix) const noexcept;
   template <typename T>
   std::pair<iterator, bool> find_key(const T& t) noexcept;
   template <typename T>
   std::pair<const_iterator, bool> find_key(const T& t) const noexcept;
+  template <bool assign, typename Iterator, typename EIterator>
+  void insert_batch(Iterator b, EIterator e);
 };
 
 template <typename Key, typename Value, typename Compare>
@@ -288,6 +1773,40 @@ split_flatmap<Key, Value, Compare>::split_flatmap(Iterator b, EIterator e)
   }
 }
 
+template <typename Key, typename Value, typename Compare>
+template <bool assign, typename Iterator, typename EIterator>
+void split_flatmap<Key, Value, Compare>::insert_batch(Iterator b, EIterator e)
+{
+  auto batch = impl::collect<value_type>(b, e);
+  auto const comp = key_compare();
+  auto order = impl::sorted_unique_order<assign>(batch, comp);
+  auto pos = impl::insert_positions(this->key_begin(), this->key_end(), batch, order, comp);
+  auto const old_size = this->m_columns.size();
+  auto const exists = [&](size_type j) { return pos[j] != old_size && !comp(batch[order[j]], this->m_columns.keys()[pos[j]]);};
+  size_type added = 0;
+  for (size_type j = 0; j != order.size(); ++j)
+  {
+    added += !exists(j);
+  }
+  if (old_size + added > this->m_columns.capacity())
+  {
+    this->m_columns.reserve(std::max(old_size + added, 2 * this->m_columns.capacity()));
+  }
+  size_type kept = 0;
+  for (size_type j = 0; j != order.size(); ++j)
+  {
+    if (exists(j))
+    {
+      if constexpr (assign) this->m_columns.values()[pos[j]] = std::move(batch[order[j]].second);
+      continue;
+    }
+    order[kept] = order[j];
+    pos[kept] = pos[j];
+    ++kept;
+  }
+  this->m_columns.insert_sorted(batch.data(), order.data(), pos.data(), kept);
+}
+
 template <typename Key, typename Value, typename Compare>
 split_flatmap<Key, Value, Compare>::split_flatmap(std::initializer_list<value_type> list)
 {
@@ -306,12 +1825,7 @@ auto split_flatmap<Key, Value, Compare>::insert(const value_type& v) -> std::pai
   }
   else
   {
-    auto ki = key_iter(iter);
-    auto vi = value_iter(iter);
-    auto& vals = this->m_values;
-    auto& keys = this->m_keys;
-    vals.insert(vi, v.second);
-    keys.insert(ki, v.first);
+    this->m_columns.emplace(index(iter), v.first, v.second);
     return { { *this, index(iter)}, true};
   }
 
@@ -326,8 +1840,7 @@ auto split_flatmap<Key, Value, Compare>::insert(value_type&& v) -> std::pair<ite
   }
   else
   {
-    this->m_keys.insert(key_iter(iter), v.first);
-    this->m_values.insert(value_iter(iter), std::move(v.second));
+    this->m_columns.emplace(index(iter), v.first, std::move(v.second));
     return { { *this, index(iter)}, true};
   }
 
@@ -350,8 +1863,7 @@ auto split_flatmap<Key, Value, Compare>::insert_or_assign(K&& k, V&& v) -> std::
   }
   else
   {
-    this->m_keys.emplace(key_iter(iter), std::forward<K>(k));
-    this->m_values.emplace(value_iter(iter), std::forward<V>(v));
+    this->m_columns.emplace(index(iter), std::forward<K>(k), std::forward<V>(v));
     return { { *this, index(iter)}, true};
 
   }
@@ -366,8 +1878,7 @@ auto split_flatmap<Key, Value, Compare>::try_emplace(K&& key, V&& ... v) -> std:
   }
   else
   {
-    this->m_keys.emplace(key_iter(iter), std::forward<K>(key));
-    this->m_values.emplace(value_iter(iter), std::forward<V>(v)...);
+    this->m_columns.emplace(index(iter), std::forward<K>(key), std::forward<V>(v)...);
     return { { *this, index(iter)}, true};
   }
 }
@@ -381,17 +1892,22 @@ auto split_flatmap<Key, Value, Compare>::operator[](const K& key) -> Value&
   }
   else
   {
-    this->m_keys.insert(key_iter(iter), key);
-    auto i = this->m_values.insert(value_iter(iter), Value());
-    return *i;
+    this->m_columns.emplace(index(iter), key);
+    return this->m_columns.values()[index(iter)];
   }
 }
 
 template <typename Key, typename Value, typename Compare>
 void split_flatmap<Key, Value, Compare>::erase(iterator i)
 {
-  this->m_values.erase(value_iter(i));
-  this->m_keys.erase(key_iter(i));
+  this->m_columns.erase(index(i));
+}
+
+template <typename Key, typename Value, typename Compare>
+auto split_flatmap<Key, Value, Compare>::erase(const_iterator first, const_iterator last) -> iterator
+{
+  this->m_columns.erase(index(first), index(last));
+  return { *this, index(first) };
 }
 
 template <typename Key, typename Value, typename Compare>
@@ -406,34 +1922,140 @@ auto split_flatmap<Key, Value, Compare>::erase(const K& k) -> size_type
   return 0;
 };
 
+template <typename Key, typename Value, typename Compare>
+template <typename T>
+auto split_flatmap<Key, Value, Compare>::lower_index(const T& t) const noexcept -> size_type
+{
+  auto i = impl::tuned_lower_bound(this->key_begin(), this->key_end(), t, key_column_compare(),
+                                   tuning::thresholds<Key>::linear_search_max);
+  return static_cast<size_type>(std::distance(this->key_begin(), i));
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename T>
+auto split_flatmap<Key, Value, Compare>::upper_index(const T& t) const noexcept -> size_type
+{
+  auto i = std::upper_bound(this->key_begin(), this->key_end(), t, key_compare());
+  return static_cast<size_type>(std::distance(this->key_begin(), i));
+}
+
 template <typename Key, typename Value, typename Compare>
 template <typename T>
 auto split_flatmap<Key, Value, Compare>::find_key(const T& t) noexcept -> std::pair<iterator, bool>
 {
-  Compare& comp = *this;
-  auto key_compare = [&comp,this](auto& lh, auto& rh) { return comp(this->key_of(lh), this->key_of(rh));};
-  auto i = std::lower_bound(std::begin(this->m_keys), std::end(this->m_keys), t, key_compare);
-  auto d = std::distance(std::begin(this->m_keys), i);
-  if (i != std::end(this->m_keys) && !key_compare(t, *i))
-  {
-    return { iterator{ *this, static_cast<size_type>(d)}, true };
-  }
-  return { iterator{ *this, static_cast<size_type>(d) }, false };
+  auto const first = this->key_begin();
+  auto [ i, exact_match ] = impl::search_keys(first, this->key_end(), t, key_column_compare(),
+                                              tuning::thresholds<Key>::linear_search_max);
+  return { iterator{ *this, static_cast<size_type>(i - first)}, exact_match };
 }
 
 template <typename Key, typename Value, typename Compare>
 template <typename T>
 auto split_flatmap<Key, Value, Compare>::find_key(const T& t) const noexcept -> std::pair<const_iterator, bool>
 {
-  const Compare& comp = *this;
-  auto key_compare = [&comp,this](auto& lh, auto& rh) { return comp(this->key_of(lh), this->key_of(rh));};
-  auto i = std::lower_bound(std::begin(this->m_keys), std::end(this->m_keys), t, key_compare);
-  auto d = static_cast<size_type>(std::distance(std::begin(this->m_keys), i));
-  if (i != std::end(this->m_keys) && !key_compare(t, *i))
+  auto const first = this->key_begin();
+  auto [ i, exact_match ] = impl::search_keys(first, this->key_end(), t, key_column_compare(),
+                                              tuning::thresholds<Key>::linear_search_max);
+  return { const_iterator{ *this, static_cast<size_type>(i - first)}, exact_match };
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename T, typename>
+auto split_flatmap<Key, Value, Compare>::equal_range(const T& key) noexcept -> std::pair<iterator, iterator>
+{
+  auto [ iter, exact_match ] = find_key(key);
+  return { iter, exact_match ? std::next(iter) : iter };
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename T, typename>
+auto split_flatmap<Key, Value, Compare>::equal_range(const T& key) const noexcept -> std::pair<const_iterator, const_iterator>
+{
+  auto [ iter, exact_match ] = find_key(key);
+  return { iter, exact_match ? std::next(iter) : iter };
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename L, typename H, typename>
+auto split_flatmap<Key, Value, Compare>::range(const L& lo, const H& hi) noexcept -> impl::range_view<iterator>
+{
+  auto b = lower_index(lo);
+  auto e = std::max(b, lower_index(hi));
+  return { iterator{ *this, b}, iterator{ *this, e}};
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename L, typename H, typename>
+auto split_flatmap<Key, Value, Compare>::range(const L& lo, const H& hi) const noexcept -> impl::range_view<const_iterator>
+{
+  auto b = lower_index(lo);
+  auto e = std::max(b, lower_index(hi));
+  return { const_iterator{ *this, b}, const_iterator{ *this, e}};
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename Iterator, typename F>
+void split_flatmap<Key, Value, Compare>::scan_ranges(Iterator b, Iterator e, F&& f)
+{
+  auto const first = this->key_begin();
+  auto const last = this->key_end();
+  auto const comp = key_compare();
+  auto cursor = first;
+  while (b != e)
+  {
+    auto&& [lo, hi] = *b;
+    cursor = impl::gallop_lower_bound(cursor, last, lo, comp);
+    auto range_end = impl::gallop_lower_bound(cursor, last, hi, comp);
+    f(impl::range_view<iterator>{ iterator{ *this, static_cast<size_type>(cursor - first)},
+                                  iterator{ *this, static_cast<size_type>(range_end - first)}});
+    ++b;
+  }
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename Iterator, typename F>
+void split_flatmap<Key, Value, Compare>::scan_ranges(Iterator b, Iterator e, F&& f) const
+{
+  auto const first = this->key_begin();
+  auto const last = this->key_end();
+  auto const comp = key_compare();
+  auto cursor = first;
+  while (b != e)
   {
-    return { const_iterator{ *this, d}, true };
+    auto&& [lo, hi] = *b;
+    cursor = impl::gallop_lower_bound(cursor, last, lo, comp);
+    auto range_end = impl::gallop_lower_bound(cursor, last, hi, comp);
+    f(impl::range_view<const_iterator>{ const_iterator{ *this, static_cast<size_type>(cursor - first)},
+                                        const_iterator{ *this, static_cast<size_type>(range_end - first)}});
+    ++b;
   }
-  return { const_iterator{ *this, d }, false };
+}
+
+template <typename Key, typename Value, typename Compare>
+auto split_flatmap<Key, Value, Compare>::prefix_indexes(std::string_view prefix) const noexcept -> std::pair<size_type, size_type>
+{
+  auto const first = this->key_begin();
+  auto b = std::lower_bound(first, this->key_end(), prefix,
+                            [](const Key& k, std::string_view p) { return std::string_view(k) < p; });
+  auto e = std::partition_point(b, this->key_end(),
+                                [prefix](const Key& k) { return std::string_view(k).compare(0, prefix.size(), prefix) == 0; });
+  return { static_cast<size_type>(b - first), static_cast<size_type>(e - first) };
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename C, typename>
+auto split_flatmap<Key, Value, Compare>::prefix_range(std::string_view prefix) noexcept -> impl::range_view<iterator>
+{
+  auto [ b, e ] = prefix_indexes(prefix);
+  return { iterator{ *this, b}, iterator{ *this, e}};
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename C, typename>
+auto split_flatmap<Key, Value, Compare>::prefix_range(std::string_view prefix) const noexcept -> impl::range_view<const_iterator>
+{
+  auto [ b, e ] = prefix_indexes(prefix);
+  return { const_iterator{ *this, b}, const_iterator{ *this, e}};
 }
 
 template <typename Key, typename Value, typename Compare>
@@ -518,17 +2140,27 @@ inline auto unordered_split_flatmap<Key, Value>::erase(const K& key) -> size_typ
 template <typename Key, typename Value>
 inline void unordered_split_flatmap<Key, Value>::erase(iterator i)
 {
-  if (i != std::prev(end()))
+  auto& stored = this->m_columns;
+  auto const last = stored.size() - 1;
+  if (index(i) != last)
   {
-    auto kp = std::addressof(i->first);
-    auto vp = std::addressof(i->second);
+    auto kp = stored.keys() + index(i);
+    auto vp = stored.values() + index(i);
     kp->~Key();
     vp->~Value();
-    new(const_cast<Key *>(kp)) Key(std::move(this->m_keys.back()));
-    new(vp) Value(std::move(this->m_values.back()));
+    new(kp) Key(std::move(stored.keys()[last]));
+    new(vp) Value(std::move(stored.values()[last]));
   }
-  this->m_keys.pop_back();
-  this->m_values.pop_back();
+  stored.pop_back();
+}
+
+// Unlike erasing one element, this keeps the order of the elements after
+// the range.
+template <typename Key, typename Value>
+inline auto unordered_split_flatmap<Key, Value>::erase(const_iterator first, const_iterator last) -> iterator
+{
+  this->m_columns.erase(index(first), index(last));
+  return { *this, index(first) };
 }
 
 template <typename Key, typename Value>
@@ -547,27 +2179,21 @@ inline auto unordered_split_flatmap<Key, Value>:: operator[](const T& key) -> Va
     return i->second;
   }
   emplace(key, Value());
-  return this->m_values.back();
+  return this->m_columns.values()[size() - 1];
 }
 
 template <typename Key, typename Value>
 template <typename T, typename >
 inline auto unordered_split_flatmap<Key, Value>::find(const T &key) noexcept -> iterator
 {
-  auto ki = std::find_if(std::begin(this->m_keys), std::end(this->m_keys),
-                         [&](auto& x) { return x == key;});
-  auto d = static_cast<size_type>(std::distance(std::begin(this->m_keys), ki));
-  return iterator{ *this, d };
+  return iterator{ *this, static_cast<size_type>(impl::find_index(this->key_begin(), this->key_end(), key)) };
 }
 
 template <typename Key, typename Value>
 template <typename T, typename>
 inline auto unordered_split_flatmap<Key, Value>::find(const T &key) const noexcept -> const_iterator
 {
-  auto ki = std::find_if(std::begin(this->m_keys), std::end(this->m_keys),
-                         [&](auto& x) { return x == key;});
-  auto d = static_cast<size_type>(std::distance(std::begin(this->m_keys), ki));
-  return const_iterator{ *this, d };
+  return const_iterator{ *this, static_cast<size_type>(impl::find_index(this->key_begin(), this->key_end(), key)) };
 }
 
 template <typename Key, typename Value>
@@ -577,9 +2203,8 @@ inline auto unordered_split_flatmap<Key, Value>::insert(const value_type& v) ->
   {
     return { i, false };
   }
-  this->m_keys.push_back(v.first);
-  this->m_values.push_back(v.second);
-  return {{std::prev(this->m_keys.end()), std::prev(this->m_values.end())}, true};
+  this->m_columns.emplace(size(), v.first, v.second);
+  return {std::prev(end()), true};
 }
 
 template <typename Key, typename Value>
@@ -589,17 +2214,17 @@ inline auto unordered_split_flatmap<Key, Value>::insert(value_type&& v) -> std::
   {
     return { i, false };
   }
-  this->m_keys.push_back(std::move(v.first));
-  this->m_values.push_back(std::move(v.second));
+  this->m_columns.emplace(size(), std::move(v.first), std::move(v.second));
   return {std::prev(end()), true};
 }
 
 template <typename Key, typename Value, typename Compare = std::less<>>
 class flatmap : private impl::flatmap_storage<Key, Value>, private Compare
 {
-  static_assert(std::is_nothrow_move_constructible<Key>{});
-  static_assert(std::is_nothrow_move_constructible<Value>{});
-  using storage = std::vector<std::pair<Key, Value>>;
+  static_assert(std::is_nothrow_move_constructible<Key>{}, "keys must be nothrow move constructible, see README.md");
+  static_assert(std::is_nothrow_move_constructible<Value>{}, "values must be nothrow move constructible, see README.md");
+  friend struct impl::storage_access;
+  using storage = impl::relocating_vector<std::pair<Key, Value>>;
 public:
   using value_type =     typename impl::flatmap_storage<Key, Value>::value_type;
   using iterator =       typename impl::flatmap_storage<Key, Value>::iterator;
@@ -634,7 +2259,7 @@ public:
             typename V,
             typename = std::enable_if_t<type_traits::is_callable<Compare, K, Key>{} &&
                                         std::is_constructible<Value, V>{} &&
-                                        std::is_assignable<Value, V>{}>>
+                                        std::is_assignable<Value&, V>{}>>
   std::pair<iterator, bool> insert_or_assign(K&& key, V&& value);
   template <typename ... T, typename = std::enable_if_t<std::is_constructible<value_type, T...>{}>>
   std::pair<iterator, bool> emplace(T&& ... t);
@@ -644,19 +2269,82 @@ public:
                                         std::is_constructible<Value, V...>{}>>
   std::pair<iterator, bool> try_emplace(K&& key, V&& ... v);
   void erase(iterator i);
+  iterator erase(const_iterator first, const_iterator last);
   template <typename K, typename = std::enable_if_t<type_traits::is_callable<Compare, K, Key>{}>>
   size_type erase(const K& key);
   template <typename K, typename = std::enable_if_t<type_traits::is_callable<Compare, K, Key>{}>>
   size_type count(const K& key) const noexcept;
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, T, Key>{}>>
+  iterator lower_bound(const T& key) noexcept { return at(lower_index(key));}
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, T, Key>{}>>
+  const_iterator lower_bound(const T& key) const noexcept { return at(lower_index(key));}
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, T, Key>{}>>
+  iterator upper_bound(const T& key) noexcept { return at(upper_index(key));}
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, T, Key>{}>>
+  const_iterator upper_bound(const T& key) const noexcept { return at(upper_index(key));}
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, T, Key>{}>>
+  std::pair<iterator, iterator> equal_range(const T& key) noexcept;
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, T, Key>{}>>
+  std::pair<const_iterator, const_iterator> equal_range(const T& key) const noexcept;
+  template <typename L,
+            typename H,
+            typename = std::enable_if_t<type_traits::is_callable<Compare, L, Key>{} && type_traits::is_callable<Compare, H, Key>{}>>
+  impl::range_view<iterator> range(const L& lo, const H& hi) noexcept;
+  template <typename L,
+            typename H,
+            typename = std::enable_if_t<type_traits::is_callable<Compare, L, Key>{} && type_traits::is_callable<Compare, H, Key>{}>>
+  impl::range_view<const_iterator> range(const L& lo, const H& hi) const noexcept;
+  template <typename Iterator, typename F>
+  void scan_ranges(Iterator b, Iterator e, F&& f);
+  template <typename Iterator, typename F>
+  void scan_ranges(Iterator b, Iterator e, F&& f) const;
+  template <typename C = Compare, typename = std::enable_if_t<type_traits::is_lexicographic<C, Key>{}>>
+  impl::range_view<iterator> prefix_range(std::string_view prefix) noexcept;
+  template <typename C = Compare, typename = std::enable_if_t<type_traits::is_lexicographic<C, Key>{}>>
+  impl::range_view<const_iterator> prefix_range(std::string_view prefix) const noexcept;
+  // Moves the elements of other into this map in one linear merge. A key
+  // in both maps gets the value resolve(this value, other value), with
+  // both passed as rvalues. All comparisons and calls to resolve are done
+  // before any element moves, so if one throws, both maps are left as
+  // they were; a resolve that is not noexcept gets copies of copyable
+  // values for that.
+  template <typename Resolve = impl::keep_first>
+  void merge(flatmap&& other, Resolve resolve = {});
+  // Inserts the elements of [b, e) whose keys are not in the map, the first
+  // of any repeated key. The batch is sorted aside and merged in from the
+  // back after one reservation, so each element moves at most once.
+  template <typename Iterator, typename EIterator>
+  void insert_many(Iterator b, EIterator e) { insert_batch<false>(b, e);}
+  // As insert_many, but assigns the values of keys already in the map,
+  // and the last of any repeated key wins.
+  template <typename Iterator, typename EIterator>
+  void insert_or_assign_many(Iterator b, EIterator e) { insert_batch<true>(b, e);}
 
 private:
   using impl::flatmap_storage<Key, Value>::inner;
-  static const Key& key_of(const Key& k) { return k;}
+  using difference_type = typename storage::difference_type;
+  iterator at(size_type idx) noexcept { return iterator{this->m_values.begin() + static_cast<difference_type>(idx)};}
+  const_iterator at(size_type idx) const noexcept { return const_iterator{this->m_values.begin() + static_cast<difference_type>(idx)};}
+  auto key_compare() const noexcept
+  {
+    const Compare& comp = *this;
+    return [&comp](const auto& lh, const auto& rh) { return comp(key_of(lh), key_of(rh));};
+  }
+  template <typename T>
+  static const T& key_of(const T& t) { return t;}
   static const Key& key_of(const value_type& v) { return v.first;}
+  static const Key& key_of(const typename storage::value_type& v) { return v.first;}
+  template <typename T>
+  size_type lower_index(const T& key) const noexcept;
+  template <typename T>
+  size_type upper_index(const T& key) const noexcept;
+  std::pair<size_type, size_type> prefix_indexes(std::string_view prefix) const noexcept;
   template <typename T>
   std::pair<iterator, bool> find_key(const T& key) noexcept;
   template <typename T>
   std::pair<const_iterator, bool> find_key(const T& key) const noexcept;
+  template <bool assign, typename Iterator, typename EIterator>
+  void insert_batch(Iterator b, EIterator e);
 };
 
 template <typename Key, typename Value, typename Compare>
@@ -680,33 +2368,176 @@ inline flatmap<Key, Value, Compare>::flatmap(Iterator b, EIterator e)
   }
 }
 
+template <typename Key, typename Value, typename Compare>
+template <bool assign, typename Iterator, typename EIterator>
+void flatmap<Key, Value, Compare>::insert_batch(Iterator b, EIterator e)
+{
+  auto batch = impl::collect<typename storage::value_type>(b, e);
+  auto const comp = key_compare();
+  auto order = impl::sorted_unique_order<assign>(batch, comp);
+  auto pos = impl::insert_positions(this->m_values.begin(), this->m_values.end(), batch, order, comp);
+  auto const old_size = this->m_values.size();
+  auto const exists = [&](size_type j) { return pos[j] != old_size && !comp(batch[order[j]], this->m_values[pos[j]]);};
+  size_type added = 0;
+  for (size_type j = 0; j != order.size(); ++j)
+  {
+    added += !exists(j);
+  }
+  if (old_size + added > this->m_values.capacity())
+  {
+    this->m_values.reserve(std::max(old_size + added, 2 * this->m_values.capacity()));
+  }
+  size_type kept = 0;
+  for (size_type j = 0; j != order.size(); ++j)
+  {
+    if (exists(j))
+    {
+      if constexpr (assign) this->m_values[pos[j]].second = std::move(batch[order[j]].second);
+      continue;
+    }
+    order[kept] = order[j];
+    pos[kept] = pos[j];
+    ++kept;
+  }
+  this->m_values.insert_sorted(batch.data(), order.data(), pos.data(), kept);
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename K>
+inline auto flatmap<Key, Value, Compare>::lower_index(const K& key) const noexcept -> size_type
+{
+  auto i = impl::tuned_lower_bound(std::begin(this->m_values), std::end(this->m_values), key, key_compare(),
+                                   tuning::thresholds<Key>::linear_search_max);
+  return static_cast<size_type>(i - std::begin(this->m_values));
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename K>
+inline auto flatmap<Key, Value, Compare>::upper_index(const K& key) const noexcept -> size_type
+{
+  auto i = std::upper_bound(std::begin(this->m_values), std::end(this->m_values), key, key_compare());
+  return static_cast<size_type>(i - std::begin(this->m_values));
+}
+
 template <typename Key, typename Value, typename Compare>
   template <typename K>
 inline auto flatmap<Key, Value, Compare>::find_key(const K& key) noexcept -> std::pair<iterator, bool>
 {
-  Compare& comp = *this;
-  auto key_compare = [&comp,this](auto& lh, auto& rh) { return comp(key_of(lh), key_of(rh));};
-  auto i = std::lower_bound(begin(), end(), key, key_compare);
-  if (i != end() && !key_compare(key, *i))
+  auto idx = lower_index(key);
+  if (idx != size() && !key_compare()(key, this->m_values[idx]))
   {
-    return { i, true };
+    return { at(idx), true };
   }
-  return {i, false };
+  return { at(idx), false };
 }
 
 template <typename Key, typename Value, typename Compare>
 template <typename K>
 inline auto flatmap<Key, Value, Compare>::find_key(const K& key) const noexcept -> std::pair<const_iterator, bool>
 {
-  const Compare& comp = *this;
-  auto key_compare = [&comp,this](auto& lh, auto& rh) { return comp(key_of(lh), key_of(rh));};
-  auto i = std::lower_bound(begin(), end(), key, key_compare);
-  if (i != end() && !key_compare(key, *i))
+  auto idx = lower_index(key);
+  if (idx != size() && !key_compare()(key, this->m_values[idx]))
+  {
+    return { at(idx), true };
+  }
+  return { at(idx), false };
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename K, typename>
+inline auto flatmap<Key, Value, Compare>::equal_range(const K& key) noexcept -> std::pair<iterator, iterator>
+{
+  auto [ iter, exact_match ] = find_key(key);
+  return { iter, exact_match ? std::next(iter) : iter };
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename K, typename>
+inline auto flatmap<Key, Value, Compare>::equal_range(const K& key) const noexcept -> std::pair<const_iterator, const_iterator>
+{
+  auto [ iter, exact_match ] = find_key(key);
+  return { iter, exact_match ? std::next(iter) : iter };
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename L, typename H, typename>
+inline auto flatmap<Key, Value, Compare>::range(const L& lo, const H& hi) noexcept -> impl::range_view<iterator>
+{
+  auto b = lower_index(lo);
+  auto e = std::max(b, lower_index(hi));
+  return { at(b), at(e) };
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename L, typename H, typename>
+inline auto flatmap<Key, Value, Compare>::range(const L& lo, const H& hi) const noexcept -> impl::range_view<const_iterator>
+{
+  auto b = lower_index(lo);
+  auto e = std::max(b, lower_index(hi));
+  return { at(b), at(e) };
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename Iterator, typename F>
+inline void flatmap<Key, Value, Compare>::scan_ranges(Iterator b, Iterator e, F&& f)
+{
+  auto const last = std::end(this->m_values);
+  auto const comp = key_compare();
+  auto cursor = std::begin(this->m_values);
+  while (b != e)
+  {
+    auto&& [lo, hi] = *b;
+    cursor = impl::gallop_lower_bound(cursor, last, lo, comp);
+    auto range_end = impl::gallop_lower_bound(cursor, last, hi, comp);
+    f(impl::range_view<iterator>{ iterator{cursor}, iterator{range_end}});
+    ++b;
+  }
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename Iterator, typename F>
+inline void flatmap<Key, Value, Compare>::scan_ranges(Iterator b, Iterator e, F&& f) const
+{
+  auto const last = std::end(this->m_values);
+  auto const comp = key_compare();
+  auto cursor = std::begin(this->m_values);
+  while (b != e)
   {
-    return { i, true };
+    auto&& [lo, hi] = *b;
+    cursor = impl::gallop_lower_bound(cursor, last, lo, comp);
+    auto range_end = impl::gallop_lower_bound(cursor, last, hi, comp);
+    f(impl::range_view<const_iterator>{ const_iterator{cursor}, const_iterator{range_end}});
+    ++b;
   }
-  return {i, false };
 }
+template <typename Key, typename Value, typename Compare>
+inline auto flatmap<Key, Value, Compare>::prefix_indexes(std::string_view prefix) const noexcept -> std::pair<size_type, size_type>
+{
+  using element = typename storage::value_type;
+  auto const first = std::begin(this->m_values);
+  auto b = std::lower_bound(first, std::end(this->m_values), prefix,
+                            [](const element& v, std::string_view p) { return std::string_view(v.first) < p; });
+  auto e = std::partition_point(b, std::end(this->m_values),
+                                [prefix](const element& v) { return std::string_view(v.first).compare(0, prefix.size(), prefix) == 0; });
+  return { static_cast<size_type>(b - first), static_cast<size_type>(e - first) };
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename C, typename>
+inline auto flatmap<Key, Value, Compare>::prefix_range(std::string_view prefix) noexcept -> impl::range_view<iterator>
+{
+  auto [ b, e ] = prefix_indexes(prefix);
+  return { at(b), at(e) };
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename C, typename>
+inline auto flatmap<Key, Value, Compare>::prefix_range(std::string_view prefix) const noexcept -> impl::range_view<const_iterator>
+{
+  auto [ b, e ] = prefix_indexes(prefix);
+  return { at(b), at(e) };
+}
+
 template <typename Key, typename Value, typename Compare>
 template <typename T, typename>
 inline auto flatmap<Key, Value, Compare>::operator[](const T &key) -> Value&
@@ -807,6 +2638,12 @@ inline void flatmap<Key, Value, Compare>::erase(iterator i)
   this->m_values.erase(inner(i));
 }
 
+template <typename Key, typename Value, typename Compare>
+inline auto flatmap<Key, Value, Compare>::erase(const_iterator first, const_iterator last) -> iterator
+{
+  return iterator{this->m_values.erase(this->inner(first), this->inner(last))};
+}
+
 template <typename Key, typename Value, typename Compare>
 template <typename T, typename>
 inline auto flatmap<Key, Value, Compare>::erase(const T& key) -> size_type
@@ -837,10 +2674,12 @@ public:
   using iterator_category = std::bidirectional_iterator_tag;
   using pointer = value_type*;
   using reference = value_type&;
-  using difference_type = typename storage::iterator::difference_type;
+  using difference_type = typename storage::difference_type;
 
   constexpr iterator_type() noexcept = default;
   explicit constexpr iterator_type(container_iterator i_) noexcept : i{i_} {}
+  template <typename V, typename I, typename = std::enable_if_t<std::is_convertible<I, container_iterator>{}>>
+  constexpr iterator_type(const iterator_type<V, I>& ci) noexcept : i{ci.i} {}
   constexpr iterator_type& operator++() noexcept { ++i; return *this;}
   constexpr iterator_type operator++(int) noexcept { auto rv = *this; ++i; return rv;}
   constexpr iterator_type& operator--() noexcept { --i; return *this;}
@@ -868,7 +2707,10 @@ class impl::split_flatmap_storage<Key, Value>::iterator_type
   template <typename C>
   friend class impl::split_flatmap_storage<Key, Value>::iterator_type;
   friend class impl::split_flatmap_storage<Key, Value>;
-  using data = std::pair<const typename container::key_type&, typename container::mapped_type&>;
+  using mapped = std::conditional_t<std::is_const<container>{},
+                                    const typename container::mapped_type,
+                                    typename container::mapped_type>;
+  using data = std::pair<const typename container::key_type&, mapped&>;
 public:
   class data_ptr
   {
@@ -883,16 +2725,18 @@ public:
   using iterator_category = std::bidirectional_iterator_tag;
   using reference = data;
   using pointer = data_ptr;
-  using difference_type = typename key_storage::iterator::difference_type;
+  using difference_type = std::ptrdiff_t;
 
   constexpr iterator_type() noexcept = default;
   constexpr iterator_type(container& c_, typename container::size_type idx_) noexcept : c{&c_}, idx{idx_} {}
+  template <typename C, typename = std::enable_if_t<std::is_same<const C, container>{} && !std::is_same<C, container>{}>>
+  constexpr iterator_type(const iterator_type<C>& ci) noexcept : c{ci.c}, idx{ci.idx} {}
   constexpr iterator_type& operator++() noexcept { ++idx; return *this;}
   constexpr iterator_type operator++(int) noexcept { auto rv = *this; operator++();return rv;}
   constexpr iterator_type& operator--() noexcept { --idx;return *this;}
   constexpr iterator_type operator--(int) noexcept { auto rv = *this; operator--();return rv;}
-  constexpr reference operator*() const noexcept { return {c->m_keys[idx], c->m_values[idx]};}
-  constexpr pointer operator->() const noexcept { return {c->m_keys[idx], c->m_values[idx]};}
+  constexpr reference operator*() const noexcept { return {c->m_columns.keys()[idx], c->m_columns.values()[idx]};}
+  constexpr pointer operator->() const noexcept { return {c->m_columns.keys()[idx], c->m_columns.values()[idx]};}
   template <typename C>
   constexpr bool operator==(const iterator_type<C>& ci) const noexcept
   {
@@ -1029,6 +2873,14 @@ inline auto unordered_flatmap<Key, Value>::erase(iterator i) -> void
   this->m_values.pop_back();
 }
 
+// Unlike erasing one element, this keeps the order of the elements after
+// the range.
+template <typename Key, typename Value>
+inline auto unordered_flatmap<Key, Value>::erase(const_iterator first, const_iterator last) -> iterator
+{
+  return iterator{this->m_values.erase(this->inner(first), this->inner(last))};
+}
+
 template <typename Key, typename Value>
 template <typename K, typename>
 inline auto unordered_flatmap<Key, Value>::erase(const K& key) -> size_type
@@ -1041,5 +2893,363 @@ inline auto unordered_flatmap<Key, Value>::erase(const K& key) -> size_type
   return 0;
 }
 
+struct impl::storage_access
+{
+  template <typename Map>
+  static auto& values(Map& m) noexcept { return m.m_values;}
+  template <typename Map>
+  static auto& columns(Map& m) noexcept { return m.m_columns;}
+  template <typename Key, typename Value, typename Compare>
+  static const Compare& compare(const flatmap<Key, Value, Compare>& m) noexcept { return m;}
+  template <typename Key, typename Value, typename Compare>
+  static const Compare& compare(const split_flatmap<Key, Value, Compare>& m) noexcept { return m;}
+};
+
+namespace impl
+{
+  template <typename Map, typename Pred>
+  auto erase_pairs_if(Map& map, Pred& pred)
+  {
+    using value_type = typename Map::value_type;
+    using element = std::pair<std::remove_const_t<typename value_type::first_type>, typename value_type::second_type>;
+    return storage_access::values(map).erase_if([&pred](element& e) { return pred(reinterpret_cast<value_type&>(e));});
+  }
+
+  template <typename Key, typename Value, typename Map, typename Pred>
+  auto erase_columns_if(Map& map, Pred& pred)
+  {
+    return storage_access::columns(map).erase_if([&pred](const Key& k, Value& v) { return pred(std::pair<const Key&, Value&>{k, v});});
+  }
+}
+
+// Removes the elements that pred holds for in one pass over the map,
+// keeping the order of the rest, also in the unordered maps. pred is
+// called with the element as iteration yields it, and the number of
+// removed elements is returned. If pred throws, the map keeps the
+// elements pred has not held for, in order, and rethrows.
+template <typename Key, typename Value, typename Compare, typename Pred>
+auto erase_if(flatmap<Key, Value, Compare>& map, Pred pred) { return impl::erase_pairs_if(map, pred);}
+
+template <typename Key, typename Value, typename Pred>
+auto erase_if(unordered_flatmap<Key, Value>& map, Pred pred) { return impl::erase_pairs_if(map, pred);}
+
+template <typename Key, typename Value, typename Compare, typename Pred>
+auto erase_if(split_flatmap<Key, Value, Compare>& map, Pred pred) { return impl::erase_columns_if<Key, Value>(map, pred);}
+
+template <typename Key, typename Value, typename Pred>
+auto erase_if(unordered_split_flatmap<Key, Value>& map, Pred pred) { return impl::erase_columns_if<Key, Value>(map, pred);}
+
+namespace impl
+{
+  // An element of a map the set operations read, moved from a mutable
+  // map and copied from a const one.
+  template <typename Map, typename T>
+  decltype(auto) take(T& t) noexcept
+  {
+    if constexpr (std::is_const<Map>{}) return static_cast<const T&>(t);
+    else return std::move(t);
+  }
+
+  template <bool keep_a, bool keep_b>
+  std::size_t combined_size(std::size_t na, std::size_t nb) noexcept
+  {
+    return keep_a && keep_b ? na + nb : keep_a ? na : keep_b ? nb : std::min(na, nb);
+  }
+
+  template <bool use_first, typename F, typename G>
+  auto& pick(F& f, G& g) noexcept
+  {
+    if constexpr (use_first) return f;
+    else return g;
+  }
+
+  // Builds the map with the elements only in a if keep_a, those only in
+  // b if keep_b, and with the keys in both if keep_both, with the value
+  // resolve(value in a, value in b). The output is reserved up front and
+  // filled in order, so no element is shifted.
+  template <bool keep_a, bool keep_b, bool keep_both, typename Map, typename Resolve>
+  std::remove_const_t<Map> combine_pairs(Map& a, Map& b, Resolve& resolve)
+  {
+    std::remove_const_t<Map> rv;
+    auto& out = storage_access::values(rv);
+    auto& va = storage_access::values(a);
+    auto& vb = storage_access::values(b);
+    out.reserve(combined_size<keep_a, keep_b>(va.size(), vb.size()));
+    auto const& comp = storage_access::compare(a);
+    auto const skip = [](auto, auto) {};
+    auto const append = [&out](auto first, auto last) {
+      for (; first != last; ++first) out.push_back(take<Map>(*first));
+    };
+    auto const resolved = [&out, &resolve](auto i, auto j) {
+      out.emplace_back(take<Map>(i->first), resolve(take<Map>(i->second), take<Map>(j->second)));
+    };
+    merge_walk(va.begin(), va.end(), vb.begin(), vb.end(),
+               [&comp](const auto& lh, const auto& rh) { return comp(lh.first, rh.first);},
+               pick<keep_a>(append, skip), pick<keep_b>(append, skip), pick<keep_both>(resolved, skip));
+    return rv;
+  }
+
+  template <bool keep_a, bool keep_b, bool keep_both, typename Map, typename Resolve>
+  std::remove_const_t<Map> combine_columns(Map& a, Map& b, Resolve& resolve)
+  {
+    std::remove_const_t<Map> rv;
+    auto& out = storage_access::columns(rv);
+    auto& ca = storage_access::columns(a);
+    auto& cb = storage_access::columns(b);
+    out.reserve(combined_size<keep_a, keep_b>(ca.size(), cb.size()));
+    auto const& comp = storage_access::compare(a);
+    auto const ka = ca.keys();
+    auto const kb = cb.keys();
+    auto const va = ca.values();
+    auto const vb = cb.values();
+    auto const skip = [](auto, auto) {};
+    auto const append_a = [&out, ka, va](auto first, auto last) {
+      for (; first != last; ++first) out.emplace(out.size(), take<Map>(*first), take<Map>(va[first - ka]));
+    };
+    auto const append_b = [&out, kb, vb](auto first, auto last) {
+      for (; first != last; ++first) out.emplace(out.size(), take<Map>(*first), take<Map>(vb[first - kb]));
+    };
+    auto const resolved = [&out, &resolve, ka, kb, va, vb](auto i, auto j) {
+      out.emplace(out.size(), take<Map>(*i), resolve(take<Map>(va[i - ka]), take<Map>(vb[j - kb])));
+    };
+    merge_walk(ka, ka + ca.size(), kb, kb + cb.size(), comp,
+               pick<keep_a>(append_a, skip), pick<keep_b>(append_b, skip), pick<keep_both>(resolved, skip));
+    return rv;
+  }
+}
+
+namespace impl
+{
+  // Where merging the sorted [b, be) into the sorted [a, ae) puts things,
+  // worked out before anything moves: the elements only in b, as their
+  // indices in b and the positions in a they go in before, and the keys
+  // in both, as pairs of indices.
+  struct merge_plan
+  {
+    std::vector<std::size_t> order;
+    std::vector<std::size_t> pos;
+    std::vector<std::pair<std::size_t, std::size_t>> both;
+  };
+
+  template <typename Iterator, typename Compare>
+  merge_plan plan_merge(Iterator a, Iterator ae, Iterator b, Iterator be, Compare comp)
+  {
+    merge_plan rv;
+    auto const nb = static_cast<std::size_t>(be - b);
+    rv.order.reserve(nb);
+    rv.pos.reserve(nb);
+    rv.both.reserve(std::min(static_cast<std::size_t>(ae - a), nb));
+    std::size_t at = 0;
+    merge_walk(a, ae, b, be, comp,
+               [&at, a](auto, auto last) { at = static_cast<std::size_t>(last - a);},
+               [&rv, &at, b](auto first, auto last) {
+                 for (; first != last; ++first)
+                 {
+                   rv.order.push_back(static_cast<std::size_t>(first - b));
+                   rv.pos.push_back(at);
+                 }
+               },
+               [&rv, &at, a, b](auto i, auto j) {
+                 at = static_cast<std::size_t>(i - a) + 1;
+                 rv.both.emplace_back(static_cast<std::size_t>(i - a), static_cast<std::size_t>(j - b));
+               });
+    return rv;
+  }
+
+  // The resolved values of the keys in both maps of plan, with a(i) and
+  // b(j) the values at those indices. The default keep_first leaves the
+  // values where they are. A resolve that may throw is given copies, if
+  // the values can be copied, so that a throw changes neither map.
+  template <typename Value, typename Resolve, typename A, typename B>
+  std::vector<Value> resolve_values(const merge_plan& plan, Resolve& resolve, A a, B b)
+  {
+    std::vector<Value> rv;
+    if constexpr (!std::is_same<Resolve, keep_first>{})
+    {
+      using result = std::invoke_result_t<Resolve&, Value&&, Value&&>;
+      constexpr bool nothrow = std::is_nothrow_invocable<Resolve&, Value&&, Value&&>{} &&
+                               std::is_nothrow_constructible<Value, result>{};
+      rv.reserve(plan.both.size());
+      for (auto [ i, j ] : plan.both)
+      {
+        if constexpr (nothrow || !std::is_copy_constructible<Value>{})
+        {
+          rv.emplace_back(resolve(std::move(a(i)), std::move(b(j))));
+        }
+        else
+        {
+          rv.emplace_back(resolve(Value(a(i)), Value(b(j))));
+        }
+      }
+    }
+    return rv;
+  }
+
+  // Storage for the result of merging added elements into storage, if it
+  // has no room for them, or else an empty one.
+  template <typename Storage>
+  Storage grown_for(const Storage& storage, std::size_t added)
+  {
+    Storage rv;
+    if (storage.size() + added > storage.capacity())
+    {
+      rv.reserve(std::max(storage.size() + added, 2 * storage.capacity()));
+    }
+    return rv;
+  }
+
+  // Merges the storage b into a by plan, once resolved holds the values
+  // of the keys in both and grown is from grown_for. Nothing here throws.
+  template <typename Storage, typename Value, typename ValueAt>
+  void apply_merge(Storage& a, Storage& b, Storage& grown, merge_plan& plan, std::vector<Value>& resolved, ValueAt value) noexcept
+  {
+    for (std::size_t k = 0; k != resolved.size(); ++k)
+    {
+      move_assign(value(plan.both[k].first), resolved[k]);
+    }
+    if (grown.capacity() != 0)
+    {
+      a.insert_sorted(grown, b, plan.order.data(), plan.pos.data(), plan.order.size());
+    }
+    else
+    {
+      a.insert_sorted(b, plan.order.data(), plan.pos.data(), plan.order.size());
+    }
+    b.clear();
+  }
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename Resolve>
+void flatmap<Key, Value, Compare>::merge(flatmap&& other, Resolve resolve)
+{
+  if (&other == this) return;
+  auto& a = this->m_values;
+  auto& b = other.m_values;
+  auto plan = impl::plan_merge(a.begin(), a.end(), b.begin(), b.end(), key_compare());
+  auto grown = impl::grown_for(a, plan.order.size());
+  auto resolved = impl::resolve_values<Value>(plan, resolve,
+                                              [&a](std::size_t i) -> Value& { return a[i].second;},
+                                              [&b](std::size_t j) -> Value& { return b[j].second;});
+  impl::apply_merge(a, b, grown, plan, resolved, [&a](std::size_t i) -> Value& { return a[i].second;});
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename Resolve>
+void split_flatmap<Key, Value, Compare>::merge(split_flatmap&& other, Resolve resolve)
+{
+  if (&other == this) return;
+  auto& a = this->m_columns;
+  auto& b = other.m_columns;
+  auto plan = impl::plan_merge(a.keys(), a.keys() + a.size(), b.keys(), b.keys() + b.size(), key_column_compare());
+  auto grown = impl::grown_for(a, plan.order.size());
+  auto resolved = impl::resolve_values<Value>(plan, resolve,
+                                              [&a](std::size_t i) -> Value& { return a.values()[i];},
+                                              [&b](std::size_t j) -> Value& { return b.values()[j];});
+  impl::apply_merge(a, b, grown, plan, resolved, [&a](std::size_t i) -> Value& { return a.values()[i];});
+}
+
+// Set operations between two sorted maps, as one linear merge that
+// gallops when one map is much smaller than the other. A key in both
+// maps gets the value resolve(value in a, value in b).
+template <typename Key, typename Value, typename Compare, typename Resolve = impl::keep_first>
+flatmap<Key, Value, Compare> set_union(const flatmap<Key, Value, Compare>& a, const flatmap<Key, Value, Compare>& b, Resolve resolve = {})
+{
+  return impl::combine_pairs<true, true, true>(a, b, resolve);
+}
+
+template <typename Key, typename Value, typename Compare, typename Resolve = impl::keep_first>
+split_flatmap<Key, Value, Compare> set_union(const split_flatmap<Key, Value, Compare>& a, const split_flatmap<Key, Value, Compare>& b, Resolve resolve = {})
+{
+  return impl::combine_columns<true, true, true>(a, b, resolve);
+}
+
+template <typename Key, typename Value, typename Compare, typename Resolve = impl::keep_first>
+flatmap<Key, Value, Compare> set_intersection(const flatmap<Key, Value, Compare>& a, const flatmap<Key, Value, Compare>& b, Resolve resolve = {})
+{
+  return impl::combine_pairs<false, false, true>(a, b, resolve);
+}
+
+template <typename Key, typename Value, typename Compare, typename Resolve = impl::keep_first>
+split_flatmap<Key, Value, Compare> set_intersection(const split_flatmap<Key, Value, Compare>& a, const split_flatmap<Key, Value, Compare>& b, Resolve resolve = {})
+{
+  return impl::combine_columns<false, false, true>(a, b, resolve);
+}
+
+// The elements of a whose keys are not in b.
+template <typename Key, typename Value, typename Compare>
+flatmap<Key, Value, Compare> set_difference(const flatmap<Key, Value, Compare>& a, const flatmap<Key, Value, Compare>& b)
+{
+  impl::keep_first unused;
+  return impl::combine_pairs<true, false, false>(a, b, unused);
+}
+
+template <typename Key, typename Value, typename Compare>
+split_flatmap<Key, Value, Compare> set_difference(const split_flatmap<Key, Value, Compare>& a, const split_flatmap<Key, Value, Compare>& b)
+{
+  impl::keep_first unused;
+  return impl::combine_columns<true, false, false>(a, b, unused);
+}
+
+// Turns an unordered map into a sorted one by taking over its storage and
+// sorting it in place, without reallocating. The keys are unique already,
+// so nothing is merged. The storage is only taken over once the comparator
+// has ordered the keys, so if it throws, map is left as it was.
+template <typename Compare = std::less<>, typename Key, typename Value>
+flatmap<Key, Value, Compare> freeze(unordered_flatmap<Key, Value>&& map)
+{
+  flatmap<Key, Value, Compare> rv;
+  auto& from = impl::storage_access::values(map);
+  auto const& comp = impl::storage_access::compare(rv);
+  auto const key_compare = [&comp](const auto& lh, const auto& rh) { return comp(lh.first, rh.first);};
+  auto order = impl::sort_order<false>(from.size(), from.data(), key_compare);
+  auto& values = impl::storage_access::values(rv);
+  values = std::move(from);
+  impl::permute_columns(order, values.data());
+  return rv;
+}
+
+template <typename Compare = std::less<>, typename Key, typename Value>
+split_flatmap<Key, Value, Compare> freeze(unordered_split_flatmap<Key, Value>&& map)
+{
+  split_flatmap<Key, Value, Compare> rv;
+  auto& from = impl::storage_access::columns(map);
+  auto order = impl::sort_order<false>(from.size(), from.keys(), impl::storage_access::compare(rv));
+  auto& columns = impl::storage_access::columns(rv);
+  columns = std::move(from);
+  impl::permute_columns(order, columns.keys(), columns.values());
+  return rv;
+}
+
+// As freeze, but from a copy of map.
+template <typename Compare = std::less<>, typename Key, typename Value>
+flatmap<Key, Value, Compare> to_sorted(const unordered_flatmap<Key, Value>& map)
+{
+  return freeze<Compare>(unordered_flatmap<Key, Value>(map));
+}
+
+template <typename Compare = std::less<>, typename Key, typename Value>
+split_flatmap<Key, Value, Compare> to_sorted(const unordered_split_flatmap<Key, Value>& map)
+{
+  return freeze<Compare>(unordered_split_flatmap<Key, Value>(map));
+}
+
+// Turns a sorted map back into an unordered one by taking over its
+// storage, in O(1).
+template <typename Key, typename Value, typename Compare>
+unordered_flatmap<Key, Value> thaw(flatmap<Key, Value, Compare>&& map) noexcept
+{
+  unordered_flatmap<Key, Value> rv;
+  impl::storage_access::values(rv) = std::move(impl::storage_access::values(map));
+  return rv;
+}
+
+template <typename Key, typename Value, typename Compare>
+unordered_split_flatmap<Key, Value> thaw(split_flatmap<Key, Value, Compare>&& map) noexcept
+{
+  unordered_split_flatmap<Key, Value> rv;
+  impl::storage_access::columns(rv) = std::move(impl::storage_access::columns(map));
+  return rv;
+}
 
 #endif //FLATMAP_FLATMAP_HPP
@@ -1,287 +1,2074 @@
 #include <benchmark/benchmark.h>
 #include "flatmap.hpp"
+#include "flatmap_serialization.hpp"
+#include "logged_flatmap.hpp"
+#include "slot_flatmap.hpp"
+#include "chunked_flatmap.hpp"
+#include "lazy_erase_flatmap.hpp"
+#include "flatmap_parallel.hpp"
 #include <map>
 #include <unordered_map>
 #include <memory>
-#include <fstream>
+#include <unordered_set>
 #include <random>
+#include <iterator>
+#include <cstdio>
+#include <cstdlib>
+#include <streambuf>
+#include <istream>
+#include <ostream>
+#include <cerrno>
+#include <cstring>
+#include <cmath>
+#include <array>
+#include <chrono>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <optional>
+#include <thread>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 namespace
 {
-std::random_device rd;
-std::mt19937_64    gen(rd());
+// Everything random is derived from seed, set with --seed=N on the command
+// line, so that runs are the same on every machine and across commits.
+uint64_t        seed = 5489U;
+std::mt19937_64 gen(seed);
 
-double buff[256*1024/sizeof(double)];
-double cool_cache()
+// An independent engine for each data set and workload.
+std::mt19937_64 data_generator(uint64_t stream)
 {
-  return std::accumulate(std::begin(buff), std::end(buff), 0.0);
+  std::seed_seq seq{ static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32), static_cast<uint32_t>(stream)};
+  return std::mt19937_64(seq);
 }
-std::vector<int> populate_integers()
+
+// The state of the caches at the start of each timed batch, set with
+// --cache=warm|l2_cold|llc_cold. Warm leaves them as the previous
+// iteration left them.
+enum class cache_mode { warm, l2_cold, llc_cold };
+cache_mode cache = cache_mode::l2_cold;
+
+// The size of the largest data or unified cache at level, 0 if unknown.
+size_t data_cache_size(int level)
+{
+  size_t rv = 0;
+  for (auto& c : benchmark::CPUInfo::Get().caches)
+  {
+    if (c.type != "Instruction" && c.level == level) rv = std::max(rv, static_cast<size_t>(c.size));
+  }
+  return rv;
+}
+
+size_t last_level_cache_size()
+{
+  int level = 0;
+  for (auto& c : benchmark::CPUInfo::Get().caches)
+  {
+    if (c.type != "Instruction") level = std::max(level, c.level);
+  }
+  return data_cache_size(level);
+}
+
+// A buffer of twice the size of the cache level to make cold.
+size_t eviction_bytes()
+{
+  auto const l2 = data_cache_size(2);
+  auto const llc = last_level_cache_size();
+  return 2 * (cache == cache_mode::l2_cold ? (l2 ? l2 : size_t{1} << 20) : (llc ? llc : size_t{32} << 20));
+}
+
+// Makes the caches cold by loading one byte per cache line of the eviction
+// buffer, which in the last level case also evicts the TLB entries for the
+// benchmark data.
+void prepare_caches()
+{
+  if (cache == cache_mode::warm) return;
+  static const std::vector<unsigned char> buffer(eviction_bytes(), 1);
+  unsigned sum = 0;
+  for (size_t i = 0; i < buffer.size(); i += 64)
+  {
+    sum += buffer[i];
+  }
+  benchmark::DoNotOptimize(sum);
+}
+
+// Preparing cold caches is untimed, and a small batch can take much less
+// time than the eviction, so the library would run it for a very long
+// time to reach its minimum measured time. In the cold modes the number of
+// iterations is instead fixed, to stream about 16 GiB through the caches.
+std::vector<benchmark::internal::Benchmark*>& registered()
+{
+  static std::vector<benchmark::internal::Benchmark*> rv;
+  return rv;
+}
+
+void limit_cold_iterations()
+{
+  if (cache == cache_mode::warm) return;
+  auto const iterations = std::clamp<benchmark::IterationCount>((size_t{16} << 30) / eviction_bytes(), 10, 10000);
+  for (auto b : registered())
+  {
+    b->Iterations(iterations);
+  }
+}
+
+// Sizes run up to FLATMAP_BENCHMARK_MAX_ELEMENTS, default 2<<13, in powers
+// of two plus the element counts that fill each data cache level. Lookups
+// in the unordered flatmaps scan linearly, and inserts and erases in the
+// sorted ones shift, so those are held to smaller sizes.
+size_t max_elements()
+{
+  static const size_t rv = [] {
+    auto const env = std::getenv("FLATMAP_BENCHMARK_MAX_ELEMENTS");
+    return env ? std::max<size_t>(2, std::strtoull(env, nullptr, 0)) : size_t{2<<13};
+  }();
+  return rv;
+}
+constexpr size_t linear_max_elements = 2<<13;
+constexpr size_t shifting_max_elements = 2<<15;
+// Populate and erase run the maps that do not shift the whole map to at
+// least a million elements, where the cost of shifting would dominate.
+constexpr size_t populate_max_elements = size_t{1} << 20;
+
+template <typename Container>
+constexpr bool scans_linearly = false;
+template <typename K, typename V>
+constexpr bool scans_linearly<unordered_flatmap<K, V>> = true;
+template <typename K, typename V>
+constexpr bool scans_linearly<unordered_split_flatmap<K, V>> = true;
+
+template <typename Container>
+constexpr bool shifts_on_insert = scans_linearly<Container>;
+template <typename K, typename V, typename C>
+constexpr bool shifts_on_insert<flatmap<K, V, C>> = true;
+template <typename K, typename V, typename C>
+constexpr bool shifts_on_insert<split_flatmap<K, V, C>> = true;
+template <typename K, typename V, typename C>
+constexpr bool shifts_on_insert<slot_flatmap<K, V, C>> = true;
+
+void add_sizes(benchmark::internal::Benchmark* b, size_t element_size, size_t limit)
+{
+  std::vector<size_t> sizes;
+  for (size_t n = 2; n <= limit; n *= 2)
+  {
+    sizes.push_back(n);
+  }
+  for (auto& level : benchmark::CPUInfo::Get().caches)
+  {
+    if (level.type == "Instruction") continue;
+    auto const n = static_cast<size_t>(level.size) / element_size;
+    if (n >= 2 && n <= limit) sizes.push_back(n);
+  }
+  std::sort(std::begin(sizes), std::end(sizes));
+  sizes.erase(std::unique(std::begin(sizes), std::end(sizes)), std::end(sizes));
+  for (auto n : sizes)
+  {
+    b->Arg(static_cast<int64_t>(n));
+  }
+  b->UseManualTime();
+  registered().push_back(b);
+}
+
+template <typename Container>
+void sizes(benchmark::internal::Benchmark* b)
+{
+  auto const limit = scans_linearly<Container> ? std::min(max_elements(), linear_max_elements) : max_elements();
+  add_sizes(b, sizeof(typename Container::value_type), limit);
+}
+
+template <typename Container>
+void threaded_sizes(benchmark::internal::Benchmark* b)
+{
+  sizes<Container>(b);
+  auto const max_threads = static_cast<int>(std::max(1U, std::thread::hardware_concurrency()));
+  for (int t = 1; t < max_threads; t *= 2)
+  {
+    b->Threads(t);
+  }
+  b->Threads(max_threads);
+}
+
+template <typename Container>
+void insert_sizes(benchmark::internal::Benchmark* b)
+{
+  auto const limit = scans_linearly<Container> ? std::min(max_elements(), linear_max_elements)
+                   : shifts_on_insert<Container> ? std::min(max_elements(), shifting_max_elements)
+                   : max_elements();
+  add_sizes(b, sizeof(typename Container::value_type), limit);
+}
+
+template <typename Container>
+void populate_sizes(benchmark::internal::Benchmark* b)
+{
+  auto const limit = scans_linearly<Container> ? std::min(max_elements(), linear_max_elements)
+                   : shifts_on_insert<Container> ? std::min(max_elements(), shifting_max_elements)
+                   : std::max(max_elements(), populate_max_elements);
+  add_sizes(b, sizeof(typename Container::value_type), limit);
+}
+
+// Bulk builds do not shift, so they run to the populate sizes for every
+// container.
+template <typename Container>
+void bulk_sizes(benchmark::internal::Benchmark* b)
+{
+  add_sizes(b, sizeof(typename Container::value_type), std::max(max_elements(), populate_max_elements));
+}
+
+// Optional hardware counters, enabled by setting FLATMAP_BENCHMARK_PERF_COUNTERS.
+// Each event is opened on its own, so events that the kernel or the PMU
+// refuses are left out, and the rest are scaled for multiplexing. Counting
+// runs only inside a counted_region, and is reported per element.
+class perf_counters
+{
+public:
+  static perf_counters& get()
+  {
+    static perf_counters instance;
+    return instance;
+  }
+  void enable(bool on);
+  void report(benchmark::State& state, double operations);
+private:
+  perf_counters();
+  ~perf_counters();
+
+  struct event
+  {
+    const char* name;
+    int         fd;
+  };
+  std::vector<event> m_events;
+};
+
+#if defined(__linux__)
+perf_counters::perf_counters()
+{
+  if (!std::getenv("FLATMAP_BENCHMARK_PERF_COUNTERS")) return;
+  auto const cache_miss = [](uint64_t which) {
+    return which | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  };
+  struct { const char* name; uint32_t type; uint64_t config; } const wanted[] = {
+    { "cycles",        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions",  PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "L1D_misses",    PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D) },
+    { "LLC_misses",    PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_LL) },
+    { "branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { "dTLB_misses",   PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_DTLB) },
+  };
+  for (auto& w : wanted)
+  {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = w.type;
+    attr.config = w.config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    auto const fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+    if (fd >= 0)
+    {
+      m_events.push_back({ w.name, fd });
+    }
+  }
+  if (m_events.empty())
+  {
+    std::fprintf(stderr, "perf_event_open failed (%s), hardware counters are not reported\n", std::strerror(errno));
+  }
+}
+
+perf_counters::~perf_counters()
+{
+  for (auto& e : m_events)
+  {
+    ::close(e.fd);
+  }
+}
+
+void perf_counters::enable(bool on)
+{
+  for (auto& e : m_events)
+  {
+    ::ioctl(e.fd, on ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, 0);
+  }
+}
+
+void perf_counters::report(benchmark::State& state, double operations)
+{
+  for (auto& e : m_events)
+  {
+    uint64_t values[3] = {};
+    if (::read(e.fd, values, sizeof(values)) == sizeof(values) && values[2] != 0 && operations > 0)
+    {
+      auto const scaled = static_cast<double>(values[0]) * static_cast<double>(values[1]) / static_cast<double>(values[2]);
+      state.counters[e.name] = scaled / operations;
+    }
+    ::ioctl(e.fd, PERF_EVENT_IOC_RESET, 0);
+  }
+}
+#else
+perf_counters::perf_counters() = default;
+perf_counters::~perf_counters() = default;
+void perf_counters::enable(bool) {}
+void perf_counters::report(benchmark::State&, double) {}
+#endif
+
+// Optional allocation counting, enabled by setting FLATMAP_BENCHMARK_ALLOCATIONS.
+// The global operator new and delete then keep the size of each block in
+// a header, to track live bytes. Allocations, bytes allocated and the peak
+// of live bytes above the level at the start of a counted_region are
+// counted, and reported per element, except for the peak.
+class allocation_counters
+{
+public:
+  static constexpr size_t header_size = alignof(std::max_align_t);
+
+  static bool enabled() noexcept
+  {
+    static const bool rv = std::getenv("FLATMAP_BENCHMARK_ALLOCATIONS") != nullptr;
+    return rv;
+  }
+  static void allocated(size_t size) noexcept
+  {
+    auto const live = m_live.fetch_add(size, std::memory_order_relaxed) + size;
+    if (!m_counting.load(std::memory_order_relaxed)) return;
+    m_allocations.fetch_add(1, std::memory_order_relaxed);
+    m_bytes.fetch_add(size, std::memory_order_relaxed);
+    auto const above = live - m_baseline.load(std::memory_order_relaxed);
+    auto peak = m_peak.load(std::memory_order_relaxed);
+    while (above > peak && !m_peak.compare_exchange_weak(peak, above, std::memory_order_relaxed))
+    {
+    }
+  }
+  static void deallocated(size_t size) noexcept
+  {
+    m_live.fetch_sub(size, std::memory_order_relaxed);
+  }
+  static void enable(bool on) noexcept
+  {
+    if (on) m_baseline.store(m_live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    m_counting.store(on, std::memory_order_relaxed);
+  }
+  static void report(benchmark::State& state, double operations)
+  {
+    if (!enabled() || operations <= 0) return;
+    state.counters["allocs_per_element"] = static_cast<double>(m_allocations.exchange(0)) / operations;
+    state.counters["bytes_per_element"] = static_cast<double>(m_bytes.exchange(0)) / operations;
+    state.counters["peak_bytes"] = static_cast<double>(m_peak.exchange(0));
+  }
+private:
+  static inline std::atomic<size_t>   m_live{0};
+  static inline std::atomic<size_t>   m_baseline{0};
+  static inline std::atomic<bool>     m_counting{false};
+  static inline std::atomic<uint64_t> m_allocations{0};
+  static inline std::atomic<uint64_t> m_bytes{0};
+  static inline std::atomic<size_t>   m_peak{0};
+};
+
+// Hardware and allocation counters count only inside a counted_region,
+// which covers the timed part of an iteration.
+class counted_region
+{
+public:
+  counted_region()
+  {
+    perf_counters::get().enable(true);
+    allocation_counters::enable(true);
+  }
+  counted_region(const counted_region&) = delete;
+  counted_region& operator=(const counted_region&) = delete;
+  ~counted_region()
+  {
+    allocation_counters::enable(false);
+    perf_counters::get().enable(false);
+  }
+};
+
+// The timed part of one iteration. The caches are prepared first, and the
+// time until destruction is reported with SetIterationTime, so that cache
+// preparation and untimed setup stay out of the measurement without the
+// overhead of PauseTiming and ResumeTiming. The benchmarks run with
+// UseManualTime. Only thread 0 toggles the counters, which are process
+// wide for allocations and follow the main thread for perf events.
+class timed_batch
+{
+  using clock = std::chrono::steady_clock;
+public:
+  explicit timed_batch(benchmark::State& state) : m_state(state)
+  {
+    prepare_caches();
+    if (state.thread_index() == 0) m_counting.emplace();
+    m_start = clock::now();
+  }
+  timed_batch(const timed_batch&) = delete;
+  timed_batch& operator=(const timed_batch&) = delete;
+  ~timed_batch()
+  {
+    auto const elapsed = std::chrono::duration<double>(clock::now() - m_start);
+    m_counting.reset();
+    m_state.SetIterationTime(elapsed.count());
+  }
+private:
+  benchmark::State&             m_state;
+  std::optional<counted_region> m_counting;
+  clock::time_point             m_start;
+};
+
+// Pins the calling thread to the index'th of the CPUs it may run on,
+// modulo their number, and restores its affinity on destruction, since
+// thread 0 is the main thread.
+class core_pin
+{
+public:
+#if defined(__linux__)
+  explicit core_pin(int index)
+  {
+    m_pinned = ::pthread_getaffinity_np(::pthread_self(), sizeof(m_saved), &m_saved) == 0 && CPU_COUNT(&m_saved) > 0;
+    if (!m_pinned) return;
+    auto n = index % CPU_COUNT(&m_saved);
+    int cpu = 0;
+    while (!CPU_ISSET(cpu, &m_saved) || n-- > 0)
+    {
+      ++cpu;
+    }
+    cpu_set_t one;
+    CPU_ZERO(&one);
+    CPU_SET(cpu, &one);
+    ::pthread_setaffinity_np(::pthread_self(), sizeof(one), &one);
+  }
+  ~core_pin()
+  {
+    if (m_pinned) ::pthread_setaffinity_np(::pthread_self(), sizeof(m_saved), &m_saved);
+  }
+#else
+  explicit core_pin(int) {}
+#endif
+  core_pin(const core_pin&) = delete;
+  core_pin& operator=(const core_pin&) = delete;
+private:
+#if defined(__linux__)
+  cpu_set_t m_saved;
+  bool      m_pinned;
+#endif
+};
+
+// Reported as time per element, the inverse of a rate over state.range(0)
+// elements per iteration, along with any hardware and allocation counters.
+// With several threads the rates add up, and the hardware counters, which
+// count the calling thread, are those of thread 0.
+void report_per_element(benchmark::State& state)
+{
+  state.counters["time_per_element"] = benchmark::Counter(static_cast<double>(state.range(0)),
+                                                          benchmark::Counter::kIsIterationInvariantRate |
+                                                          benchmark::Counter::kInvert);
+  if (state.thread_index() != 0) return;
+  auto const operations = static_cast<double>(state.iterations() * state.range(0));
+  perf_counters::get().report(state, operations);
+  allocation_counters::report(state, operations * state.threads());
+}
+
+// The data sets hold twice the largest size, so that BM_lookup_fail has as
+// many keys that are not in the map as there are keys in it, and enough
+// keys for the largest populate.
+size_t data_set_size()
+{
+  return std::max({size_t{100000}, 2 * max_elements(), populate_max_elements});
+}
+
+template <typename Container, typename Src>
+void fill(Container& c, const Src& src, size_t num_elems)
+{
+  for (size_t i = 0; i != num_elems; ++i)
+  {
+    c.insert(std::make_pair(src[i], typename Container::value_type::second_type{}));
+  }
+}
+
+// The sorted flat maps are filled in key order, so that setup appends
+// instead of shifting, and stays n log n at millions of elements.
+template <typename Container, typename Src, typename Compare>
+void fill_in_order(Container& c, const Src& src, size_t num_elems, Compare comp)
+{
+  std::vector<typename Src::value_type> keys(src.begin(), std::next(src.begin(), num_elems));
+  std::sort(std::begin(keys), std::end(keys), comp);
+  for (auto& key : keys)
+  {
+    c.insert(std::make_pair(key, typename Container::value_type::second_type{}));
+  }
+}
+
+template <typename K, typename V, typename C, typename Src>
+void fill(flatmap<K, V, C>& c, const Src& src, size_t num_elems)
+{
+  fill_in_order(c, src, num_elems, C{});
+}
+
+template <typename K, typename V, typename C, typename Src>
+void fill(split_flatmap<K, V, C>& c, const Src& src, size_t num_elems)
+{
+  fill_in_order(c, src, num_elems, C{});
+}
+
+template <typename K, typename V, typename C, typename Src>
+void fill(slot_flatmap<K, V, C>& c, const Src& src, size_t num_elems)
+{
+  fill_in_order(c, src, num_elems, C{});
+}
+
+template <typename K, typename V, typename C, size_t N, typename Src>
+void fill(chunked_flatmap<K, V, C, N>& c, const Src& src, size_t num_elems)
+{
+  fill_in_order(c, src, num_elems, C{});
+}
+
+template <typename K, typename V, typename C, typename Src>
+void fill(lazy_erase_flatmap<flatmap<K, V, C>>& c, const Src& src, size_t num_elems)
+{
+  fill_in_order(c, src, num_elems, C{});
+}
+
+template <typename K, typename V, typename C, typename Src>
+void fill(lazy_erase_flatmap<split_flatmap<K, V, C>>& c, const Src& src, size_t num_elems)
+{
+  fill_in_order(c, src, num_elems, C{});
+}
+
+// Values of N bytes, for the cost of moving large values, which a
+// std::string does not show.
+template <size_t N>
+struct payload
+{
+  char bytes[N];
+};
+
+// Ranks 1..n with P(k) proportional to 1/k^skew, sampled by rejection
+// inversion (Hormann and Derflinger), in constant space. A skew of 0 is
+// uniform.
+class zipf_distribution
+{
+public:
+  zipf_distribution(uint64_t n, double skew)
+    : m_n(n)
+    , m_skew(skew)
+    , m_h_x1(h_integral(1.5) - 1.0)
+    , m_h_n(h_integral(static_cast<double>(n) + 0.5))
+    , m_s(2.0 - h_integral_inverse(h_integral(2.5) - h(2.0)))
+  {
+  }
+  template <typename Generator>
+  uint64_t operator()(Generator& g) const
+  {
+    std::uniform_real_distribution<double> uniform;
+    for (;;)
+    {
+      auto const u = m_h_n + uniform(g) * (m_h_x1 - m_h_n);
+      auto const x = h_integral_inverse(u);
+      auto const k = std::clamp<uint64_t>(static_cast<uint64_t>(x + 0.5), 1, m_n);
+      if (static_cast<double>(k) - x <= m_s || u >= h_integral(static_cast<double>(k) + 0.5) - h(static_cast<double>(k)))
+      {
+        return k;
+      }
+    }
+  }
+private:
+  double h(double x) const { return std::exp(-m_skew * std::log(x));}
+  double h_integral(double x) const
+  {
+    auto const log_x = std::log(x);
+    return expm1_over_x((1.0 - m_skew) * log_x) * log_x;
+  }
+  double h_integral_inverse(double x) const
+  {
+    auto const t = std::max(-1.0, x * (1.0 - m_skew));
+    return std::exp(log1p_over_x(t) * x);
+  }
+  static double log1p_over_x(double x)
+  {
+    return std::abs(x) > 1e-8 ? std::log1p(x) / x : 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+  }
+  static double expm1_over_x(double x)
+  {
+    return std::abs(x) > 1e-8 ? std::expm1(x) / x : 1.0 + x * 0.5 * (1.0 + x / 3.0 * (1.0 + 0.25 * x));
+  }
+
+  uint64_t m_n;
+  double   m_skew;
+  double   m_h_x1;
+  double   m_h_n;
+  double   m_s;
+};
+
+// Percentages of reads and upserts, with erases making up the rest, and
+// the Zipf skew of the keys they touch.
+struct workload
+{
+  unsigned read_percent;
+  unsigned insert_percent;
+  double   skew;
+};
+const workload read_mostly{ 95, 3, 0.99 };
+const workload write_heavy{ 50, 25, 0.99 };
+
+enum class op_kind : uint8_t { read, insert, erase };
+
+// Operations on keys src[0..2*num_elems), where the map starts out with
+// the first half. Zipf rank k picks src[k-1], and since src is shuffled
+// the hot keys are spread over the key space.
+std::vector<std::pair<op_kind, size_t>> make_operations(const workload& w, size_t num_elems)
+{
+  auto rng = data_generator(4);
+  zipf_distribution keys(2 * num_elems, w.skew);
+  std::uniform_int_distribution<unsigned> percent(0, 99);
+  std::vector<std::pair<op_kind, size_t>> rv;
+  rv.reserve(num_elems);
+  for (size_t i = 0; i != num_elems; ++i)
+  {
+    auto const p = percent(rng);
+    auto const kind = p < w.read_percent ? op_kind::read
+                    : p < w.read_percent + w.insert_percent ? op_kind::insert
+                    : op_kind::erase;
+    rv.emplace_back(kind, keys(rng) - 1);
+  }
+  return rv;
+}
+
+// splitmix64, to derive names from ids without the state of an engine.
+uint64_t mix(uint64_t x)
+{
+  x += 0x9e3779b97f4a7c15U;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9U;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebU;
+  return x ^ (x >> 31);
+}
+
+// A pronounceable lower case word of min_length..max_length letters.
+std::string make_word(uint64_t id, size_t min_length, size_t max_length)
+{
+  static const char consonants[] = "bcdfghjklmnprstvwxz";
+  static const char vowels[] = "aeiouy";
+  auto h = mix(id);
+  auto length = min_length + h % (max_length - min_length + 1);
+  std::string rv;
+  rv.reserve(length);
+  for (size_t i = 0; i != length; ++i)
+  {
+    h = mix(h);
+    rv += i % 2 ? vowels[h % (sizeof(vowels) - 1)] : consonants[h % (sizeof(consonants) - 1)];
+  }
+  return rv;
+}
+
+template <typename Generator>
+std::vector<std::string> generate_unique(Generator next)
+{
+  auto const n = data_set_size();
+  std::vector<std::string> rv;
+  std::unordered_set<std::string> seen;
+  rv.reserve(n);
+  seen.reserve(n);
+  while (rv.size() != n)
+  {
+    auto s = next();
+    if (seen.insert(s).second)
+    {
+      rv.push_back(std::move(s));
+    }
+  }
+  return rv;
+}
+
+const char* const extensions[] = { ".cpp", ".hpp", ".txt", ".json", ".log", ".so", "" };
+
+// Paths in an implicit directory tree, where every directory has the same
+// children and they are picked with Zipf skew, so that popular prefixes
+// are shared by many paths. Depth is 1 + binomial(12, 0.35), and leaves
+// are files with an extension.
+std::vector<std::string> generate_paths()
+{
+  static const char* const roots[] = { "/usr", "/home", "/var", "/opt", "/srv", "/tmp" };
+  auto rng = data_generator(1);
+  zipf_distribution child(64, 1.0);
+  std::binomial_distribution<unsigned> depth(12, 0.35);
+  std::uniform_int_distribution<size_t> root(0, std::size(roots) - 1);
+  std::uniform_int_distribution<size_t> extension(0, std::size(extensions) - 1);
+  return generate_unique([&] {
+    auto const r = root(rng);
+    std::string rv = roots[r];
+    auto node = mix(seed + r);
+    for (auto d = depth(rng) + 1; d--;)
+    {
+      node = mix(node + child(rng));
+      rv += '/';
+      rv += make_word(node, 2, 10);
+    }
+    rv += '/';
+    rv += make_word(rng(), 3, 14);
+    rv += extensions[extension(rng)];
+    return rv;
+  });
+}
+
+// File names, mostly short enough for the small string buffer.
+std::vector<std::string> generate_names()
+{
+  auto rng = data_generator(2);
+  std::uniform_int_distribution<size_t> extension(0, std::size(extensions) - 1);
+  return generate_unique([&] {
+    return make_word(rng(), 2, 10) + extensions[extension(rng)];
+  });
+}
+
+// Random (version 4) UUIDs, 36 characters each.
+std::vector<std::string> generate_uuids()
+{
+  auto rng = data_generator(3);
+  return generate_unique([&] {
+    auto const hi = (rng() & ~uint64_t{0xf000}) | 0x4000;
+    auto const lo = (rng() & ~(uint64_t{0xc} << 60)) | (uint64_t{0x8} << 60);
+    char buf[37];
+    std::snprintf(buf, sizeof(buf), "%08x-%04x-%04x-%04x-%012llx",
+                  static_cast<unsigned>(hi >> 32), static_cast<unsigned>(hi >> 16 & 0xffff),
+                  static_cast<unsigned>(hi & 0xffff), static_cast<unsigned>(lo >> 48),
+                  static_cast<unsigned long long>(lo & 0xffffffffffffU));
+    return std::string(buf, 36);
+  });
+}
+
+std::vector<int> generate_integers()
 {
   std::vector<int> rv;
-  std::generate_n(std::back_inserter(rv), 100000, [n=0]()mutable { return n++;});
-  std::shuffle(std::begin(rv), std::end(rv), gen);
+  std::generate_n(std::back_inserter(rv), data_set_size(), [n=0]()mutable { return n++;});
+  std::shuffle(std::begin(rv), std::end(rv), data_generator(0));
+  return rv;
+}
+
+const std::vector<std::string> &paths()
+{
+  static auto rv = generate_paths();
+  return rv;
+}
+
+const std::vector<std::string> &names()
+{
+  static auto rv = generate_names();
+  return rv;
+}
+
+const std::vector<std::string> &uuids()
+{
+  static auto rv = generate_uuids();
+  return rv;
+}
+
+const std::vector<int>& integers()
+{
+  static auto rv = generate_integers();
+  return rv;
+}
+
+// Log-linear buckets in the style of HdrHistogram. Values below
+// 2*sub_buckets are exact, and above that each power of two is split in
+// sub_buckets buckets, so a percentile is at most 1/sub_buckets high.
+class latency_histogram
+{
+public:
+  static constexpr unsigned sub_bucket_bits = 5;
+  static constexpr uint64_t sub_buckets = uint64_t{1} << sub_bucket_bits;
+
+  void record(uint64_t value) noexcept
+  {
+    ++m_counts[bucket(value)];
+    ++m_total;
+    m_max = std::max(m_max, value);
+  }
+  uint64_t percentile(double p) const noexcept
+  {
+    auto const rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p / 100.0 * static_cast<double>(m_total))));
+    uint64_t seen = 0;
+    for (size_t i = 0; i != m_counts.size(); ++i)
+    {
+      seen += m_counts[i];
+      if (seen >= rank) return std::min(highest_equivalent(i), m_max);
+    }
+    return m_max;
+  }
+  uint64_t max() const noexcept { return m_max;}
+private:
+  static size_t bucket(uint64_t value) noexcept
+  {
+    if (value < sub_buckets) return value;
+    auto const shift = 63U - static_cast<unsigned>(__builtin_clzll(value)) - sub_bucket_bits;
+    return (shift + 1) * sub_buckets + ((value >> shift) - sub_buckets);
+  }
+  static uint64_t highest_equivalent(size_t idx) noexcept
+  {
+    if (idx < 2 * sub_buckets) return idx;
+    auto const shift = idx / sub_buckets - 1;
+    auto const lowest = (idx % sub_buckets + sub_buckets) << shift;
+    return lowest + (uint64_t{1} << shift) - 1;
+  }
+
+  std::array<uint64_t, (64 - sub_bucket_bits) * sub_buckets> m_counts{};
+  uint64_t m_total = 0;
+  uint64_t m_max = 0;
+};
+
+class memory_buffer : public std::streambuf
+{
+public:
+  void rewind_for_write() { setp(m_data.data(), m_data.data() + m_data.size());}
+  void rewind_for_read() { setg(m_data.data(), m_data.data(), pptr());}
+  size_t size() const { return static_cast<size_t>(pptr() - pbase());}
+protected:
+  int_type overflow(int_type c) override
+  {
+    auto const used = size();
+    m_data.resize(std::max<size_t>(4096, m_data.size() * 2));
+    setp(m_data.data(), m_data.data() + m_data.size());
+    pbump(static_cast<int>(used));
+    if (c != traits_type::eof())
+    {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
+  }
+private:
+  std::vector<char> m_data;
+};
+
+const char checkpoint_file[] = "flatmap_benchmark_checkpoint.bin";
+const char log_file[] = "flatmap_benchmark_log.bin";
+
+template <typename Key>
+std::unique_ptr<logged_flatmap<Key, std::string>> make_logged(size_t group_commit_bytes, bool sync)
+{
+  std::remove(checkpoint_file);
+  std::remove(log_file);
+  return std::make_unique<logged_flatmap<Key, std::string>>(checkpoint_file, log_file,
+                                                            logged_flatmap_options{group_commit_bytes, sync});
+}
+
+template <typename K, typename V, typename C>
+void commit(flatmap<K, V, C>&) {}
+
+template <typename K, typename V, typename C>
+void commit(logged_flatmap<K, V, C>& c) { c.commit();}
+
+template <typename T>
+auto consume(const T& t, const std::string& s)
+{
+  return &t + s.length();
+}
+
+template <typename Src>
+auto make_intervals(const Src& src, size_t num_elems)
+{
+  using key = typename Src::value_type;
+  std::vector<key> keys(src.begin(), std::next(src.begin(), num_elems));
+  std::sort(std::begin(keys), std::end(keys));
+  std::vector<std::pair<key, key>> rv;
+  for (size_t i = 0; i + 1 < keys.size(); i += 8)
+  {
+    rv.emplace_back(keys[i], keys[std::min(i + 4, keys.size() - 1)]);
+  }
+  return rv;
+}
+
+std::vector<std::string> make_prefixes(const std::vector<std::string>& src, size_t num_elems)
+{
+  std::vector<std::string> rv;
+  for (size_t i = 0; i < num_elems; i += std::max<size_t>(1, num_elems / 64))
+  {
+    auto const& s = src[i];
+    auto const slash = s.rfind('/');
+    rv.push_back(s.substr(0, slash == std::string::npos ? std::min<size_t>(2, s.size()) : slash + 1));
+  }
+  return rv;
+}
+
+template <typename Container>
+auto prefix_range(const Container& c, std::string_view prefix)
+{
+  return c.prefix_range(prefix);
+}
+
+template <typename V>
+auto prefix_range(const std::map<std::string, V, std::less<>>& c, std::string_view prefix)
+{
+  auto b = c.lower_bound(prefix);
+  auto e = std::find_if(b, c.end(), [prefix](auto& x) { return x.first.compare(0, prefix.size(), prefix) != 0;});
+  return impl::range_view<decltype(b)>(b, e);
+}
+
+}
+void* operator new(size_t size)
+{
+  auto const counted = allocation_counters::enabled();
+  auto const extra = counted ? allocation_counters::header_size : 0;
+  auto p = static_cast<char*>(std::malloc(size + extra ? size + extra : 1));
+  if (!p) throw std::bad_alloc();
+  if (!counted) return p;
+  *reinterpret_cast<size_t*>(p) = size;
+  allocation_counters::allocated(size);
+  return p + extra;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+  try
+  {
+    return operator new(size);
+  }
+  catch (const std::bad_alloc&)
+  {
+    return nullptr;
+  }
+}
+
+void* operator new[](size_t size) { return operator new(size);}
+void* operator new[](size_t size, const std::nothrow_t& nt) noexcept { return operator new(size, nt);}
+
+void operator delete(void* ptr) noexcept
+{
+  if (!ptr) return;
+  auto p = static_cast<char*>(ptr);
+  if (allocation_counters::enabled())
+  {
+    p -= allocation_counters::header_size;
+    allocation_counters::deallocated(*reinterpret_cast<size_t*>(p));
+  }
+  std::free(p);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { operator delete(ptr);}
+void operator delete(void* ptr, size_t) noexcept { operator delete(ptr);}
+void operator delete[](void* ptr) noexcept { operator delete(ptr);}
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { operator delete(ptr);}
+void operator delete[](void* ptr, size_t) noexcept { operator delete(ptr);}
+
+// Over-aligned allocations, as made for the columns of the split maps, put
+// the size just below the returned pointer, in a header of the alignment.
+void* operator new(size_t size, std::align_val_t al)
+{
+  auto const align = static_cast<size_t>(al);
+  auto const counted = allocation_counters::enabled();
+  auto const extra = counted ? align : 0;
+  auto const bytes = (size + extra + align - 1) / align * align;
+  auto p = static_cast<char*>(std::aligned_alloc(align, bytes ? bytes : align));
+  if (!p) throw std::bad_alloc();
+  if (!counted) return p;
+  *reinterpret_cast<size_t*>(p + extra - sizeof(size_t)) = size;
+  allocation_counters::allocated(size);
+  return p + extra;
+}
+
+void* operator new(size_t size, std::align_val_t al, const std::nothrow_t&) noexcept
+{
+  try
+  {
+    return operator new(size, al);
+  }
+  catch (const std::bad_alloc&)
+  {
+    return nullptr;
+  }
+}
+
+void* operator new[](size_t size, std::align_val_t al) { return operator new(size, al);}
+void* operator new[](size_t size, std::align_val_t al, const std::nothrow_t& nt) noexcept { return operator new(size, al, nt);}
+
+void operator delete(void* ptr, std::align_val_t al) noexcept
+{
+  if (!ptr) return;
+  auto p = static_cast<char*>(ptr);
+  if (allocation_counters::enabled())
+  {
+    allocation_counters::deallocated(*reinterpret_cast<size_t*>(p - sizeof(size_t)));
+    p -= static_cast<size_t>(al);
+  }
+  std::free(p);
+}
+
+void operator delete(void* ptr, std::align_val_t al, const std::nothrow_t&) noexcept { operator delete(ptr, al);}
+void operator delete(void* ptr, size_t, std::align_val_t al) noexcept { operator delete(ptr, al);}
+void operator delete[](void* ptr, std::align_val_t al) noexcept { operator delete(ptr, al);}
+void operator delete[](void* ptr, std::align_val_t al, const std::nothrow_t&) noexcept { operator delete(ptr, al);}
+void operator delete[](void* ptr, size_t, std::align_val_t al) noexcept { operator delete(ptr, al);}
+
+template <typename Container, typename Src>
+bool BM_populate(benchmark::State& state, Container c, const Src& src)
+{
+  auto e = src.end();
+  auto b = src.begin();
+  bool rv = false;
+  Container work;
+  while (state.KeepRunning())
+  {
+    // Move assigned, since copy assigning a vector keeps the capacity it
+    // grew to in the previous iteration.
+    work = Container(c);
+    timed_batch batch(state);
+    auto i = b;
+    auto size = state.range(0);
+    while (size--)
+    {
+      auto const inserted = work.insert(std::make_pair(*i, typename Container::value_type::second_type())).second;
+      benchmark::DoNotOptimize(rv = rv || inserted);
+      if (++i == e) i = b;
+    }
+  }
+  report_per_element(state);
+  return rv;
+}
+
+template <typename Container, typename Src>
+size_t BM_lookup_found(benchmark::State& state, Container c, const Src& src)
+{
+  const auto num_elems = state.range(0);
+  fill(c, src, num_elems);
+  size_t rv = 0;
+  while (state.KeepRunning())
+  {
+    timed_batch batch(state);
+    auto const max = state.range(0);
+    for (size_t i = 0; i != max; ++i)
+    {
+      auto const found = c.count(src[i]);
+      benchmark::DoNotOptimize(rv += found);
+    }
+  }
+  report_per_element(state);
   return rv;
 }
-std::vector<std::string> populate_from_file(const char *filename)
+
+template <typename Container, typename Src>
+size_t BM_lookup_fail(benchmark::State& state, Container c, const Src& src)
 {
-  std::vector<std::string> rv;
-  std::ifstream            in(filename);
-  std::string              s;
-  while (std::getline(in, s))
+  const auto num_elems = state.range(0);
+  fill(c, src, num_elems);
+  size_t rv = 0;
+  while (state.KeepRunning())
   {
-    rv.push_back(s);
+    timed_batch batch(state);
+    for (size_t i = 0; i != num_elems; ++i)
+    {
+      auto const found = c.count(src[num_elems + i]);
+      benchmark::DoNotOptimize(rv += found);
+    }
   }
-
-  std::shuffle(std::begin(rv), std::end(rv), gen);
+  report_per_element(state);
   return rv;
 }
-const std::vector<std::string> &paths()
+
+template <typename Container, typename Src>
+size_t BM_erase(benchmark::State& state, Container c, const Src& src)
 {
-  static auto rv = populate_from_file("full_paths");
+  std::vector<typename Src::value_type> values(src.begin(), std::next(src.begin(), state.range(0)));
+  fill(c, values, values.size());
+  size_t rv = 0;
+  while (state.KeepRunning())
+  {
+    auto copy = c;
+    std::shuffle(std::begin(values), std::end(values), gen);
+    timed_batch batch(state);
+    for (auto& v : values)
+    {
+      auto n = copy.erase(v);
+      benchmark::DoNotOptimize(rv += n);
+    }
+  }
+  report_per_element(state);
   return rv;
 }
 
-const std::vector<std::string> &names()
+// Erasing by predicate, one element at a time for the std containers, and
+// with one compaction pass for the flat maps.
+template <typename Container, typename Pred>
+size_t prune(Container& c, Pred pred)
 {
-  static auto rv = populate_from_file("individual_names");
+  size_t rv = 0;
+  for (auto i = c.begin(); i != c.end();)
+  {
+    if (pred(*i)) { i = c.erase(i); ++rv;}
+    else ++i;
+  }
   return rv;
 }
 
-const std::vector<int>& integers()
+template <typename Key, typename Value, typename Pred>
+size_t prune(unordered_flatmap<Key, Value>& c, Pred pred) { return erase_if(c, pred);}
+
+template <typename Key, typename Value, typename Compare, typename Pred>
+size_t prune(flatmap<Key, Value, Compare>& c, Pred pred) { return erase_if(c, pred);}
+
+template <typename Key, typename Value, typename Pred>
+size_t prune(unordered_split_flatmap<Key, Value>& c, Pred pred) { return erase_if(c, pred);}
+
+template <typename Key, typename Value, typename Compare, typename Pred>
+size_t prune(split_flatmap<Key, Value, Compare>& c, Pred pred) { return erase_if(c, pred);}
+
+// Erases every other element, in key order where the map keeps one.
+template <typename Container, typename Src>
+size_t BM_erase_if(benchmark::State& state, Container c, const Src& src)
 {
-  static auto rv = populate_integers();
+  const auto num_elems = state.range(0);
+  fill(c, src, num_elems);
+  size_t rv = 0;
+  while (state.KeepRunning())
+  {
+    auto copy = c;
+    timed_batch batch(state);
+    size_t n = 0;
+    auto const removed = prune(copy, [&n](const auto&) { return n++ % 2 == 0;});
+    benchmark::DoNotOptimize(rv += removed);
+  }
+  report_per_element(state);
   return rv;
 }
 
-template <typename T>
-auto consume(const T& t, const std::string& s)
+template <typename Container>
+void merge_into(Container& c, Container& other) { c.merge(other);}
+
+template <typename K, typename V, typename C>
+void merge_into(flatmap<K, V, C>& c, flatmap<K, V, C>& other) { c.merge(std::move(other));}
+
+template <typename K, typename V, typename C>
+void merge_into(split_flatmap<K, V, C>& c, split_flatmap<K, V, C>& other) { c.merge(std::move(other));}
+
+// Merges a map of 1/ratio the size, of which half the keys are already in
+// the target, either with merge or by inserting the elements one by one.
+template <typename Container, typename Src>
+size_t BM_merge(benchmark::State& state, Container c, const Src& src, size_t ratio, bool by_insert)
 {
-  return &t + s.length();
+  const auto num_elems = static_cast<size_t>(state.range(0));
+  fill(c, src, num_elems);
+  auto const num_other = std::max(num_elems / ratio, size_t{1});
+  std::vector<typename Src::value_type> keys(std::next(src.begin(), num_elems - num_other / 2),
+                                             std::next(src.begin(), num_elems - num_other / 2 + num_other));
+  Container other;
+  fill(other, keys, num_other);
+  size_t rv = 0;
+  while (state.KeepRunning())
+  {
+    auto copy = c;
+    auto other_copy = other;
+    timed_batch batch(state);
+    if (by_insert)
+    {
+      for (auto&& x : other_copy)
+      {
+        copy.insert(x);
+      }
+    }
+    else
+    {
+      merge_into(copy, other_copy);
+    }
+    benchmark::DoNotOptimize(rv += copy.size());
+  }
+  report_per_element(state);
+  return rv;
 }
 
+template <typename Container, typename Iterator>
+void insert_batch(Container& c, Iterator b, Iterator e) { c.insert(b, e);}
+
+template <typename K, typename V, typename C, typename Iterator>
+void insert_batch(flatmap<K, V, C>& c, Iterator b, Iterator e) { c.insert_many(b, e);}
+
+template <typename K, typename V, typename C, typename Iterator>
+void insert_batch(split_flatmap<K, V, C>& c, Iterator b, Iterator e) { c.insert_many(b, e);}
+
+// As BM_populate, but inserting batch_size elements at a time.
+template <typename Container, typename Src>
+size_t BM_populate_batched(benchmark::State& state, Container c, const Src& src, size_t batch_size)
+{
+  const auto num_elems = static_cast<size_t>(state.range(0));
+  std::vector<std::pair<typename Src::value_type, typename Container::value_type::second_type>> elements;
+  elements.reserve(num_elems);
+  for (size_t i = 0; i != num_elems; ++i)
+  {
+    elements.emplace_back(src[i], typename Container::value_type::second_type());
+  }
+  Container work;
+  while (state.KeepRunning())
+  {
+    work = Container(c);
+    timed_batch batch(state);
+    for (size_t i = 0; i < num_elems; i += batch_size)
+    {
+      insert_batch(work, elements.begin() + i, elements.begin() + std::min(i + batch_size, num_elems));
+    }
+    benchmark::DoNotOptimize(work.size());
+  }
+  report_per_element(state);
+  return work.size();
 }
+
+// Builds a map from one unsorted shard per thread with parallel_build.
 template <typename Container, typename Src>
-bool BM_populate(benchmark::State& state, Container c, const Src& src)
+size_t BM_parallel_build(benchmark::State& state, Container c, const Src& src, unsigned threads)
 {
-  auto e = src.end();
-  auto b = src.begin();
-  bool rv = false;
+  using pair = std::pair<typename Src::value_type, typename Container::value_type::second_type>;
+  const auto num_elems = static_cast<size_t>(state.range(0));
+  size_t rv = 0;
   while (state.KeepRunning())
   {
-    state.PauseTiming();
-    benchmark::DoNotOptimize(cool_cache());
-    state.ResumeTiming();
-    auto i = b;
-    auto size = state.range(0);
-    while (size--)
+    std::vector<std::vector<pair>> shards(threads);
+    for (size_t i = 0; i != num_elems; ++i)
     {
-      auto const inserted = c.insert(std::make_pair(*i, std::string())).second;
-      benchmark::DoNotOptimize(rv = rv || inserted);
-      if (++i == e) i = b;
+      shards[i % threads].emplace_back(src[i], typename pair::second_type());
     }
+    auto work = c;
+    timed_batch batch(state);
+    parallel_build(work, std::move(shards), parallel_build_options{threads});
+    benchmark::DoNotOptimize(rv += work.size());
   }
+  report_per_element(state);
   return rv;
 }
 
+// Sorts a filled unordered map with freeze, to compare with building the
+// sorted map directly.
 template <typename Container, typename Src>
-size_t BM_lookup_found(benchmark::State& state, Container c, const Src& src)
+size_t BM_freeze(benchmark::State& state, Container c, const Src& src)
 {
-  const auto num_elems = state.range(0);
+  const auto num_elems = static_cast<size_t>(state.range(0));
   for (size_t i = 0; i != num_elems; ++i)
   {
-    c.insert(std::make_pair(src[i], std::string{}));
+    c.insert({src[i], typename Container::value_type::second_type()});
+  }
+  decltype(freeze(std::move(c))) frozen;
+  while (state.KeepRunning())
+  {
+    frozen.clear();
+    auto work = c;
+    timed_batch batch(state);
+    frozen = freeze(std::move(work));
+    benchmark::DoNotOptimize(frozen.size());
   }
+  report_per_element(state);
+  return frozen.size();
+}
+
+template <typename Container, typename Src>
+size_t BM_mixed(benchmark::State& state, Container c, const Src& src, workload w)
+{
+  const auto num_elems = state.range(0);
+  fill(c, src, num_elems);
+  auto const operations = make_operations(w, num_elems);
   size_t rv = 0;
   while (state.KeepRunning())
   {
-    state.PauseTiming();
-    benchmark::DoNotOptimize(cool_cache());
-    state.ResumeTiming();
-    auto const max = state.range(0);
-    for (size_t i = 0; i != max; ++i)
+    timed_batch batch(state);
+    for (auto& [ kind, idx ] : operations)
     {
-      auto const found = c.count(src[i]);
-      benchmark::DoNotOptimize(rv += found);
+      auto const& key = src[idx];
+      switch (kind)
+      {
+      case op_kind::read:
+        benchmark::DoNotOptimize(rv += c.count(key));
+        break;
+      case op_kind::insert:
+        benchmark::DoNotOptimize(rv += c.insert_or_assign(key, std::string{}).second);
+        break;
+      case op_kind::erase:
+        benchmark::DoNotOptimize(rv += c.erase(key));
+        break;
+      }
     }
   }
+  report_per_element(state);
   return rv;
 }
 
+// Times every operation on its own with steady_clock, which includes the
+// clock overhead of some tens of ns, and reports percentiles of the last
+// run rather than the mean.
 template <typename Container, typename Src>
-size_t BM_lookup_fail(benchmark::State& state, Container c, const Src& src)
+size_t BM_latency(benchmark::State& state, Container c, const Src& src, op_kind kind)
 {
-  const auto num_elems = state.range(0);
-  for (size_t i = 0; i != num_elems; ++i)
+  using clock = std::chrono::steady_clock;
+  const auto num_elems = static_cast<size_t>(state.range(0));
+  if (kind != op_kind::insert)
   {
-    c.insert(std::make_pair(src[i], std::string{}));
+    fill(c, src, num_elems);
   }
+  latency_histogram histogram;
+  Container work;
   size_t rv = 0;
   while (state.KeepRunning())
   {
-    state.PauseTiming();
-    benchmark::DoNotOptimize(cool_cache());
-    state.ResumeTiming();
+    if (kind != op_kind::read)
+    {
+      work = c;
+    }
+    auto& target = kind == op_kind::read ? c : work;
+    timed_batch batch(state);
     for (size_t i = 0; i != num_elems; ++i)
     {
-      auto const found = c.count(src[num_elems + i]);
-      benchmark::DoNotOptimize(rv += found);
+      auto const& key = src[i];
+      auto const start = clock::now();
+      switch (kind)
+      {
+      case op_kind::read:
+        benchmark::DoNotOptimize(rv += target.count(key));
+        break;
+      case op_kind::insert:
+        benchmark::DoNotOptimize(rv += target.insert(std::make_pair(key, std::string{})).second);
+        break;
+      case op_kind::erase:
+        benchmark::DoNotOptimize(rv += target.erase(key));
+        break;
+      }
+      auto const elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start);
+      histogram.record(static_cast<uint64_t>(elapsed.count()));
     }
   }
+  state.counters["p50_ns"] = static_cast<double>(histogram.percentile(50.0));
+  state.counters["p99_ns"] = static_cast<double>(histogram.percentile(99.0));
+  state.counters["p99.9_ns"] = static_cast<double>(histogram.percentile(99.9));
+  state.counters["max_ns"] = static_cast<double>(histogram.max());
+  report_per_element(state);
   return rv;
 }
 
+enum class key_sharing { shared, disjoint };
+
+// Lookups from several threads in one map, built by thread 0 before the
+// threads start their loops. Each thread pins itself to a core. With
+// shared keys every thread looks up all keys, from a different offset,
+// and with disjoint keys each thread looks up its own slice over and over.
+// Misses are looked up from the second half of src.
 template <typename Container, typename Src>
-size_t BM_erase(benchmark::State& state, Container c, const Src& src)
+size_t BM_threaded_lookup(benchmark::State& state, Container, const Src& src, bool hits, key_sharing sharing)
 {
-  std::vector<typename Src::value_type> values(src.begin(), std::next(src.begin(), state.range(0)));
-  for (auto& v : values)
+  static Container map;
+  core_pin pin(state.thread_index());
+  const auto num_elems = static_cast<size_t>(state.range(0));
+  if (state.thread_index() == 0)
   {
-    c.insert(std::make_pair(v, std::string{}));
+    map = Container{};
+    fill(map, src, num_elems);
   }
+  auto const threads = static_cast<size_t>(state.threads());
+  auto const thread = static_cast<size_t>(state.thread_index());
+  auto const first = hits ? 0 : num_elems;
+  auto const slice = sharing == key_sharing::disjoint ? std::max<size_t>(1, num_elems / threads) : num_elems;
+  auto const offset = sharing == key_sharing::disjoint ? std::min(thread * slice, num_elems - slice)
+                                                       : thread * num_elems / threads;
+  const Container& c = map;
   size_t rv = 0;
   while (state.KeepRunning())
   {
-    state.PauseTiming();
-    auto copy = c;
-    std::shuffle(std::begin(values), std::end(values), gen);
-    state.PauseTiming();
-    benchmark::DoNotOptimize(cool_cache());
-    state.ResumeTiming();
-    state.ResumeTiming();
-    for (auto& v : values)
+    timed_batch batch(state);
+    for (size_t i = 0; i != num_elems; ++i)
     {
-      auto n = copy.erase(v);
-      benchmark::DoNotOptimize(rv += n);
+      auto const idx = sharing == key_sharing::disjoint ? offset + i % slice : (offset + i) % num_elems;
+      auto const found = c.count(src[first + idx]);
+      benchmark::DoNotOptimize(rv += found);
     }
   }
+  report_per_element(state);
   return rv;
 }
 
 template <typename Container, typename Src>
 void BM_iterate(benchmark::State& state, Container c, const Src& src)
 {
-  for (size_t i = 0; i != state.range(0); ++i)
-  {
-    c.insert(std::make_pair(src[i], std::string()));
-  }
+  fill(c, src, state.range(0));
   while (state.KeepRunning())
   {
-    state.PauseTiming();
-    benchmark::DoNotOptimize(cool_cache());
-    state.ResumeTiming();
+    timed_batch batch(state);
     for (auto&& elem : c)
     {
       benchmark::DoNotOptimize(consume(elem.first, elem.second));
     }
   }
+  report_per_element(state);
+}
+
+template <typename Container, typename Src>
+void BM_range_lookup(benchmark::State& state, Container c, const Src& src)
+{
+  fill(c, src, state.range(0));
+  auto const intervals = make_intervals(src, state.range(0));
+  while (state.KeepRunning())
+  {
+    timed_batch batch(state);
+    for (auto& [lo, hi] : intervals)
+    {
+      for (auto i = c.lower_bound(lo), e = c.lower_bound(hi); i != e; ++i)
+      {
+        benchmark::DoNotOptimize(consume(i->first, i->second));
+      }
+    }
+  }
+  report_per_element(state);
+}
+
+template <typename Container, typename Src>
+void BM_range_scan(benchmark::State& state, Container c, const Src& src)
+{
+  fill(c, src, state.range(0));
+  auto const intervals = make_intervals(src, state.range(0));
+  while (state.KeepRunning())
+  {
+    timed_batch batch(state);
+    c.scan_ranges(std::begin(intervals), std::end(intervals), [](auto r) {
+      for (auto&& elem : r)
+      {
+        benchmark::DoNotOptimize(consume(elem.first, elem.second));
+      }
+    });
+  }
+  report_per_element(state);
+}
+
+template <typename Container, typename Src>
+void BM_prefix_range(benchmark::State& state, Container c, const Src& src)
+{
+  fill(c, src, state.range(0));
+  auto const prefixes = make_prefixes(src, state.range(0));
+  while (state.KeepRunning())
+  {
+    timed_batch batch(state);
+    for (auto& prefix : prefixes)
+    {
+      for (auto&& elem : prefix_range(c, prefix))
+      {
+        benchmark::DoNotOptimize(consume(elem.first, elem.second));
+      }
+    }
+  }
+  report_per_element(state);
+}
+
+template <typename Container, typename Src>
+void BM_save(benchmark::State& state, Container c, const Src& src)
+{
+  fill(c, src, state.range(0));
+  memory_buffer buffer;
+  std::ostream os(&buffer);
+  while (state.KeepRunning())
+  {
+    buffer.rewind_for_write();
+    timed_batch batch(state);
+    save(os, c);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * buffer.size()));
+  report_per_element(state);
+}
+
+template <typename Container, typename Src>
+void BM_load(benchmark::State& state, Container c, const Src& src)
+{
+  fill(c, src, state.range(0));
+  memory_buffer buffer;
+  std::ostream os(&buffer);
+  std::istream is(&buffer);
+  buffer.rewind_for_write();
+  save(os, c);
+  Container loaded;
+  while (state.KeepRunning())
+  {
+    buffer.rewind_for_read();
+    timed_batch batch(state);
+    load(is, loaded);
+    benchmark::DoNotOptimize(loaded);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * buffer.size()));
+  report_per_element(state);
+}
+
+template <typename Factory, typename Src>
+bool BM_store_populate(benchmark::State& state, Factory make_store, const Src& src)
+{
+  bool rv = false;
+  while (state.KeepRunning())
+  {
+    auto c = make_store();
+    {
+      timed_batch batch(state);
+      auto i = src.begin();
+      auto size = state.range(0);
+      while (size--)
+      {
+        auto const inserted = c->insert(std::make_pair(*i, std::string())).second;
+        benchmark::DoNotOptimize(rv = rv || inserted);
+        if (++i == src.end()) i = src.begin();
+      }
+      commit(*c);
+    }
+  }
+  std::remove(checkpoint_file);
+  std::remove(log_file);
+  report_per_element(state);
+  return rv;
 }
 
-BENCHMARK_CAPTURE(BM_iterate, int_std_map, std::map<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_iterate, int_std_unordered_map, std::unordered_map<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_iterate, int_unordered_flatmap, unordered_flatmap<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_iterate, int_flatmap, flatmap<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_iterate, int_unordered_split_flatmap, unordered_split_flatmap<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_iterate, int_split_flatmap, split_flatmap<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-
-BENCHMARK_CAPTURE(BM_iterate, long_string_std_map, std::map<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_iterate, long_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_iterate, long_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_iterate, long_string_flatmap, flatmap<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_iterate, long_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_iterate, long_string_split_flatmap, split_flatmap<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-
-BENCHMARK_CAPTURE(BM_iterate, short_string_std_map, std::map<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_iterate, short_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_iterate, short_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_iterate, short_string_flatmap, flatmap<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_iterate, short_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_iterate, short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-
-
-BENCHMARK_CAPTURE(BM_erase, int_std_map, std::map<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_erase, int_std_unordered_map, std::unordered_map<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_erase, int_unordered_flatmap, unordered_flatmap<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_erase, int_flatmap, flatmap<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_erase, int_unordered_split_flatmap, unordered_split_flatmap<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_erase, int_split_flatmap, split_flatmap<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-
-BENCHMARK_CAPTURE(BM_erase, long_string_std_map, std::map<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_erase, long_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_erase, long_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_erase, long_string_flatmap, flatmap<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_erase, long_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_erase, long_string_split_flatmap, split_flatmap<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-
-BENCHMARK_CAPTURE(BM_erase, short_string_std_map, std::map<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_erase, short_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_erase, short_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_erase, short_string_flatmap, flatmap<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_erase, short_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_erase, short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
+BENCHMARK_CAPTURE(BM_iterate, int_std_map, std::map<int, std::string>{}, integers())->Apply(sizes<std::map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_iterate, int_std_unordered_map, std::unordered_map<int, std::string>{}, integers())->Apply(sizes<std::unordered_map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_iterate, int_unordered_flatmap, unordered_flatmap<int, std::string>{}, integers())->Apply(sizes<unordered_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_iterate, int_flatmap, flatmap<int, std::string>{}, integers())->Apply(sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_iterate, int_unordered_split_flatmap, unordered_split_flatmap<int, std::string>{}, integers())->Apply(sizes<unordered_split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_iterate, int_split_flatmap, split_flatmap<int, std::string>{}, integers())->Apply(sizes<split_flatmap<int, std::string>>);
+
+BENCHMARK_CAPTURE(BM_iterate, long_string_std_map, std::map<std::string, std::string>{}, paths())->Apply(sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_iterate, long_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, paths())->Apply(sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_iterate, long_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, paths())->Apply(sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_iterate, long_string_flatmap, flatmap<std::string, std::string>{}, paths())->Apply(sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_iterate, long_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, paths())->Apply(sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_iterate, long_string_split_flatmap, split_flatmap<std::string, std::string>{}, paths())->Apply(sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_iterate, short_string_std_map, std::map<std::string, std::string>{}, names())->Apply(sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_iterate, short_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, names())->Apply(sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_iterate, short_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, names())->Apply(sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_iterate, short_string_flatmap, flatmap<std::string, std::string>{}, names())->Apply(sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_iterate, short_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, names())->Apply(sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_iterate, short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names())->Apply(sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_iterate, uuid_std_map, std::map<std::string, std::string>{}, uuids())->Apply(sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_iterate, uuid_std_unordered_map, std::unordered_map<std::string, std::string>{}, uuids())->Apply(sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_iterate, uuid_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, uuids())->Apply(sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_iterate, uuid_flatmap, flatmap<std::string, std::string>{}, uuids())->Apply(sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_iterate, uuid_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, uuids())->Apply(sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_iterate, uuid_split_flatmap, split_flatmap<std::string, std::string>{}, uuids())->Apply(sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_range_lookup, int_std_map, std::map<int, std::string>{}, integers())->Apply(sizes<std::map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_range_lookup, int_flatmap, flatmap<int, std::string>{}, integers())->Apply(sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_range_lookup, int_split_flatmap, split_flatmap<int, std::string>{}, integers())->Apply(sizes<split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_range_scan, int_flatmap, flatmap<int, std::string>{}, integers())->Apply(sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_range_scan, int_split_flatmap, split_flatmap<int, std::string>{}, integers())->Apply(sizes<split_flatmap<int, std::string>>);
+
+BENCHMARK_CAPTURE(BM_range_lookup, long_string_std_map, std::map<std::string, std::string>{}, paths())->Apply(sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_range_lookup, long_string_flatmap, flatmap<std::string, std::string>{}, paths())->Apply(sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_range_lookup, long_string_split_flatmap, split_flatmap<std::string, std::string>{}, paths())->Apply(sizes<split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_range_scan, long_string_flatmap, flatmap<std::string, std::string>{}, paths())->Apply(sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_range_scan, long_string_split_flatmap, split_flatmap<std::string, std::string>{}, paths())->Apply(sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_range_lookup, short_string_std_map, std::map<std::string, std::string>{}, names())->Apply(sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_range_lookup, short_string_flatmap, flatmap<std::string, std::string>{}, names())->Apply(sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_range_lookup, short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names())->Apply(sizes<split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_range_scan, short_string_flatmap, flatmap<std::string, std::string>{}, names())->Apply(sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_range_scan, short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names())->Apply(sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_prefix_range, long_string_std_map, std::map<std::string, std::string, std::less<>>{}, paths())->Apply(sizes<std::map<std::string, std::string, std::less<>>>);
+BENCHMARK_CAPTURE(BM_prefix_range, long_string_flatmap, flatmap<std::string, std::string>{}, paths())->Apply(sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_prefix_range, long_string_split_flatmap, split_flatmap<std::string, std::string>{}, paths())->Apply(sizes<split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_prefix_range, short_string_std_map, std::map<std::string, std::string, std::less<>>{}, names())->Apply(sizes<std::map<std::string, std::string, std::less<>>>);
+BENCHMARK_CAPTURE(BM_prefix_range, short_string_flatmap, flatmap<std::string, std::string>{}, names())->Apply(sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_prefix_range, short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names())->Apply(sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_save, int_unordered_flatmap, unordered_flatmap<int, std::string>{}, integers())->Apply(sizes<unordered_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_save, int_flatmap, flatmap<int, std::string>{}, integers())->Apply(sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_save, int_unordered_split_flatmap, unordered_split_flatmap<int, std::string>{}, integers())->Apply(sizes<unordered_split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_save, int_split_flatmap, split_flatmap<int, std::string>{}, integers())->Apply(sizes<split_flatmap<int, std::string>>);
+
+BENCHMARK_CAPTURE(BM_save, long_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, paths())->Apply(sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_save, long_string_flatmap, flatmap<std::string, std::string>{}, paths())->Apply(sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_save, long_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, paths())->Apply(sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_save, long_string_split_flatmap, split_flatmap<std::string, std::string>{}, paths())->Apply(sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_save, short_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, names())->Apply(sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_save, short_string_flatmap, flatmap<std::string, std::string>{}, names())->Apply(sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_save, short_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, names())->Apply(sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_save, short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names())->Apply(sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_load, int_unordered_flatmap, unordered_flatmap<int, std::string>{}, integers())->Apply(sizes<unordered_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_load, int_flatmap, flatmap<int, std::string>{}, integers())->Apply(sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_load, int_unordered_split_flatmap, unordered_split_flatmap<int, std::string>{}, integers())->Apply(sizes<unordered_split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_load, int_split_flatmap, split_flatmap<int, std::string>{}, integers())->Apply(sizes<split_flatmap<int, std::string>>);
+
+BENCHMARK_CAPTURE(BM_load, long_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, paths())->Apply(sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_load, long_string_flatmap, flatmap<std::string, std::string>{}, paths())->Apply(sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_load, long_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, paths())->Apply(sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_load, long_string_split_flatmap, split_flatmap<std::string, std::string>{}, paths())->Apply(sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_load, short_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, names())->Apply(sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_load, short_string_flatmap, flatmap<std::string, std::string>{}, names())->Apply(sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_load, short_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, names())->Apply(sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_load, short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names())->Apply(sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_store_populate, int_flatmap, [] { return std::make_unique<flatmap<int, std::string>>(); }, integers())->Apply(insert_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_store_populate, int_logged_flatmap_group_0, [] { return make_logged<int>(0, false); }, integers())->Apply(insert_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_store_populate, int_logged_flatmap_group_4k, [] { return make_logged<int>(4096, false); }, integers())->Apply(insert_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_store_populate, int_logged_flatmap_group_64k, [] { return make_logged<int>(64 * 1024, false); }, integers())->Apply(insert_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_store_populate, int_logged_flatmap_group_64k_sync, [] { return make_logged<int>(64 * 1024, true); }, integers())->Apply(insert_sizes<flatmap<int, std::string>>);
+
+BENCHMARK_CAPTURE(BM_store_populate, short_string_flatmap, [] { return std::make_unique<flatmap<std::string, std::string>>(); }, names())->Apply(insert_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_store_populate, short_string_logged_flatmap_group_0, [] { return make_logged<std::string>(0, false); }, names())->Apply(insert_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_store_populate, short_string_logged_flatmap_group_4k, [] { return make_logged<std::string>(4096, false); }, names())->Apply(insert_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_store_populate, short_string_logged_flatmap_group_64k, [] { return make_logged<std::string>(64 * 1024, false); }, names())->Apply(insert_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_store_populate, short_string_logged_flatmap_group_64k_sync, [] { return make_logged<std::string>(64 * 1024, true); }, names())->Apply(insert_sizes<flatmap<std::string, std::string>>);
+
+
+BENCHMARK_CAPTURE(BM_erase, int_std_map, std::map<int, std::string>{}, integers())->Apply(populate_sizes<std::map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, int_std_unordered_map, std::unordered_map<int, std::string>{}, integers())->Apply(populate_sizes<std::unordered_map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, int_unordered_flatmap, unordered_flatmap<int, std::string>{}, integers())->Apply(populate_sizes<unordered_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, int_flatmap, flatmap<int, std::string>{}, integers())->Apply(populate_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, int_unordered_split_flatmap, unordered_split_flatmap<int, std::string>{}, integers())->Apply(populate_sizes<unordered_split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, int_split_flatmap, split_flatmap<int, std::string>{}, integers())->Apply(populate_sizes<split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, int_chunked_flatmap, chunked_flatmap<int, std::string>{}, integers())->Apply(populate_sizes<chunked_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, int_lazy_erase_flatmap, lazy_erase_flatmap<flatmap<int, std::string>>{}, integers())->Apply(populate_sizes<lazy_erase_flatmap<flatmap<int, std::string>>>);
+BENCHMARK_CAPTURE(BM_erase, int_lazy_erase_split_flatmap, lazy_erase_flatmap<split_flatmap<int, std::string>>{}, integers())->Apply(populate_sizes<lazy_erase_flatmap<split_flatmap<int, std::string>>>);
+
+BENCHMARK_CAPTURE(BM_erase, long_string_std_map, std::map<std::string, std::string>{}, paths())->Apply(populate_sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, long_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, paths())->Apply(populate_sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, long_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, paths())->Apply(populate_sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, long_string_flatmap, flatmap<std::string, std::string>{}, paths())->Apply(populate_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, long_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, paths())->Apply(populate_sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, long_string_split_flatmap, split_flatmap<std::string, std::string>{}, paths())->Apply(populate_sizes<split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, long_string_chunked_flatmap, chunked_flatmap<std::string, std::string>{}, paths())->Apply(populate_sizes<chunked_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, long_string_lazy_erase_flatmap, lazy_erase_flatmap<flatmap<std::string, std::string>>{}, paths())->Apply(populate_sizes<lazy_erase_flatmap<flatmap<std::string, std::string>>>);
+BENCHMARK_CAPTURE(BM_erase, long_string_lazy_erase_split_flatmap, lazy_erase_flatmap<split_flatmap<std::string, std::string>>{}, paths())->Apply(populate_sizes<lazy_erase_flatmap<split_flatmap<std::string, std::string>>>);
+
+BENCHMARK_CAPTURE(BM_erase, short_string_std_map, std::map<std::string, std::string>{}, names())->Apply(populate_sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, short_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, names())->Apply(populate_sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, short_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, names())->Apply(populate_sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, short_string_flatmap, flatmap<std::string, std::string>{}, names())->Apply(populate_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, short_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, names())->Apply(populate_sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names())->Apply(populate_sizes<split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, short_string_chunked_flatmap, chunked_flatmap<std::string, std::string>{}, names())->Apply(populate_sizes<chunked_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, short_string_lazy_erase_flatmap, lazy_erase_flatmap<flatmap<std::string, std::string>>{}, names())->Apply(populate_sizes<lazy_erase_flatmap<flatmap<std::string, std::string>>>);
+BENCHMARK_CAPTURE(BM_erase, short_string_lazy_erase_split_flatmap, lazy_erase_flatmap<split_flatmap<std::string, std::string>>{}, names())->Apply(populate_sizes<lazy_erase_flatmap<split_flatmap<std::string, std::string>>>);
+
+BENCHMARK_CAPTURE(BM_erase, uuid_std_map, std::map<std::string, std::string>{}, uuids())->Apply(populate_sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, uuid_std_unordered_map, std::unordered_map<std::string, std::string>{}, uuids())->Apply(populate_sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, uuid_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, uuids())->Apply(populate_sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, uuid_flatmap, flatmap<std::string, std::string>{}, uuids())->Apply(populate_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, uuid_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, uuids())->Apply(populate_sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, uuid_split_flatmap, split_flatmap<std::string, std::string>{}, uuids())->Apply(populate_sizes<split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, uuid_chunked_flatmap, chunked_flatmap<std::string, std::string>{}, uuids())->Apply(populate_sizes<chunked_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase, uuid_lazy_erase_flatmap, lazy_erase_flatmap<flatmap<std::string, std::string>>{}, uuids())->Apply(populate_sizes<lazy_erase_flatmap<flatmap<std::string, std::string>>>);
+BENCHMARK_CAPTURE(BM_erase, uuid_lazy_erase_split_flatmap, lazy_erase_flatmap<split_flatmap<std::string, std::string>>{}, uuids())->Apply(populate_sizes<lazy_erase_flatmap<split_flatmap<std::string, std::string>>>);
+
+BENCHMARK_CAPTURE(BM_erase_if, int_std_map, std::map<int, std::string>{}, integers())->Apply(populate_sizes<std::map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_erase_if, int_unordered_flatmap, unordered_flatmap<int, std::string>{}, integers())->Apply(populate_sizes<unordered_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_erase_if, int_flatmap, flatmap<int, std::string>{}, integers())->Apply(populate_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_erase_if, int_unordered_split_flatmap, unordered_split_flatmap<int, std::string>{}, integers())->Apply(populate_sizes<unordered_split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_erase_if, int_split_flatmap, split_flatmap<int, std::string>{}, integers())->Apply(populate_sizes<split_flatmap<int, std::string>>);
+
+BENCHMARK_CAPTURE(BM_erase_if, short_string_std_map, std::map<std::string, std::string>{}, names())->Apply(populate_sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase_if, short_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, names())->Apply(populate_sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase_if, short_string_flatmap, flatmap<std::string, std::string>{}, names())->Apply(populate_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase_if, short_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, names())->Apply(populate_sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_erase_if, short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names())->Apply(populate_sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_merge, int_std_map_1_1, std::map<int, std::string>{}, integers(), 1, false)->Apply(sizes<std::map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_merge, int_flatmap_insert_1_1, flatmap<int, std::string>{}, integers(), 1, true)->Apply(insert_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_merge, int_flatmap_1_1, flatmap<int, std::string>{}, integers(), 1, false)->Apply(sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_merge, int_split_flatmap_insert_1_1, split_flatmap<int, std::string>{}, integers(), 1, true)->Apply(insert_sizes<split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_merge, int_split_flatmap_1_1, split_flatmap<int, std::string>{}, integers(), 1, false)->Apply(sizes<split_flatmap<int, std::string>>);
+
+BENCHMARK_CAPTURE(BM_merge, int_std_map_1_64, std::map<int, std::string>{}, integers(), 64, false)->Apply(sizes<std::map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_merge, int_flatmap_insert_1_64, flatmap<int, std::string>{}, integers(), 64, true)->Apply(insert_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_merge, int_flatmap_1_64, flatmap<int, std::string>{}, integers(), 64, false)->Apply(sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_merge, int_split_flatmap_insert_1_64, split_flatmap<int, std::string>{}, integers(), 64, true)->Apply(insert_sizes<split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_merge, int_split_flatmap_1_64, split_flatmap<int, std::string>{}, integers(), 64, false)->Apply(sizes<split_flatmap<int, std::string>>);
+
+BENCHMARK_CAPTURE(BM_merge, short_string_std_map_1_1, std::map<std::string, std::string>{}, names(), 1, false)->Apply(sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_merge, short_string_flatmap_insert_1_1, flatmap<std::string, std::string>{}, names(), 1, true)->Apply(insert_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_merge, short_string_flatmap_1_1, flatmap<std::string, std::string>{}, names(), 1, false)->Apply(sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_merge, short_string_split_flatmap_insert_1_1, split_flatmap<std::string, std::string>{}, names(), 1, true)->Apply(insert_sizes<split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_merge, short_string_split_flatmap_1_1, split_flatmap<std::string, std::string>{}, names(), 1, false)->Apply(sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_merge, short_string_std_map_1_64, std::map<std::string, std::string>{}, names(), 64, false)->Apply(sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_merge, short_string_flatmap_insert_1_64, flatmap<std::string, std::string>{}, names(), 64, true)->Apply(insert_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_merge, short_string_flatmap_1_64, flatmap<std::string, std::string>{}, names(), 64, false)->Apply(sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_merge, short_string_split_flatmap_insert_1_64, split_flatmap<std::string, std::string>{}, names(), 64, true)->Apply(insert_sizes<split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_merge, short_string_split_flatmap_1_64, split_flatmap<std::string, std::string>{}, names(), 64, false)->Apply(sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_populate_batched, int_std_map_batch_16, std::map<int, std::string>{}, integers(), 16)->Apply(populate_sizes<std::map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_populate_batched, int_flatmap_batch_16, flatmap<int, std::string>{}, integers(), 16)->Apply(populate_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_populate_batched, int_split_flatmap_batch_16, split_flatmap<int, std::string>{}, integers(), 16)->Apply(populate_sizes<split_flatmap<int, std::string>>);
+
+BENCHMARK_CAPTURE(BM_populate_batched, int_std_map_batch_1024, std::map<int, std::string>{}, integers(), 1024)->Apply(populate_sizes<std::map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_populate_batched, int_flatmap_batch_1024, flatmap<int, std::string>{}, integers(), 1024)->Apply(populate_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_populate_batched, int_split_flatmap_batch_1024, split_flatmap<int, std::string>{}, integers(), 1024)->Apply(populate_sizes<split_flatmap<int, std::string>>);
+
+BENCHMARK_CAPTURE(BM_populate_batched, int_std_map_batch_65536, std::map<int, std::string>{}, integers(), 65536)->Apply(populate_sizes<std::map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_populate_batched, int_flatmap_batch_65536, flatmap<int, std::string>{}, integers(), 65536)->Apply(populate_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_populate_batched, int_split_flatmap_batch_65536, split_flatmap<int, std::string>{}, integers(), 65536)->Apply(populate_sizes<split_flatmap<int, std::string>>);
+
+BENCHMARK_CAPTURE(BM_populate_batched, short_string_std_map_batch_16, std::map<std::string, std::string>{}, names(), 16)->Apply(populate_sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate_batched, short_string_flatmap_batch_16, flatmap<std::string, std::string>{}, names(), 16)->Apply(populate_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate_batched, short_string_split_flatmap_batch_16, split_flatmap<std::string, std::string>{}, names(), 16)->Apply(populate_sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_populate_batched, short_string_std_map_batch_1024, std::map<std::string, std::string>{}, names(), 1024)->Apply(populate_sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate_batched, short_string_flatmap_batch_1024, flatmap<std::string, std::string>{}, names(), 1024)->Apply(populate_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate_batched, short_string_split_flatmap_batch_1024, split_flatmap<std::string, std::string>{}, names(), 1024)->Apply(populate_sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_populate_batched, short_string_std_map_batch_65536, std::map<std::string, std::string>{}, names(), 65536)->Apply(populate_sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate_batched, short_string_flatmap_batch_65536, flatmap<std::string, std::string>{}, names(), 65536)->Apply(populate_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate_batched, short_string_split_flatmap_batch_65536, split_flatmap<std::string, std::string>{}, names(), 65536)->Apply(populate_sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_parallel_build, int_flatmap_threads_1, flatmap<int, std::string>{}, integers(), 1)->Apply(bulk_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_parallel_build, int_flatmap_threads_2, flatmap<int, std::string>{}, integers(), 2)->Apply(bulk_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_parallel_build, int_flatmap_threads_4, flatmap<int, std::string>{}, integers(), 4)->Apply(bulk_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_parallel_build, int_flatmap_threads_8, flatmap<int, std::string>{}, integers(), 8)->Apply(bulk_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_populate_batched, int_flatmap_one_batch, flatmap<int, std::string>{}, integers(), size_t{1} << 30)->Apply(bulk_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_parallel_build, int_split_flatmap_threads_1, split_flatmap<int, std::string>{}, integers(), 1)->Apply(bulk_sizes<split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_parallel_build, int_split_flatmap_threads_2, split_flatmap<int, std::string>{}, integers(), 2)->Apply(bulk_sizes<split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_parallel_build, int_split_flatmap_threads_4, split_flatmap<int, std::string>{}, integers(), 4)->Apply(bulk_sizes<split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_parallel_build, int_split_flatmap_threads_8, split_flatmap<int, std::string>{}, integers(), 8)->Apply(bulk_sizes<split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_populate_batched, int_split_flatmap_one_batch, split_flatmap<int, std::string>{}, integers(), size_t{1} << 30)->Apply(bulk_sizes<split_flatmap<int, std::string>>);
+
+BENCHMARK_CAPTURE(BM_parallel_build, short_string_flatmap_threads_1, flatmap<std::string, std::string>{}, names(), 1)->Apply(bulk_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_parallel_build, short_string_flatmap_threads_2, flatmap<std::string, std::string>{}, names(), 2)->Apply(bulk_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_parallel_build, short_string_flatmap_threads_4, flatmap<std::string, std::string>{}, names(), 4)->Apply(bulk_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_parallel_build, short_string_flatmap_threads_8, flatmap<std::string, std::string>{}, names(), 8)->Apply(bulk_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate_batched, short_string_flatmap_one_batch, flatmap<std::string, std::string>{}, names(), size_t{1} << 30)->Apply(bulk_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_parallel_build, short_string_split_flatmap_threads_1, split_flatmap<std::string, std::string>{}, names(), 1)->Apply(bulk_sizes<split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_parallel_build, short_string_split_flatmap_threads_2, split_flatmap<std::string, std::string>{}, names(), 2)->Apply(bulk_sizes<split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_parallel_build, short_string_split_flatmap_threads_4, split_flatmap<std::string, std::string>{}, names(), 4)->Apply(bulk_sizes<split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_parallel_build, short_string_split_flatmap_threads_8, split_flatmap<std::string, std::string>{}, names(), 8)->Apply(bulk_sizes<split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate_batched, short_string_split_flatmap_one_batch, split_flatmap<std::string, std::string>{}, names(), size_t{1} << 30)->Apply(bulk_sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_freeze, int_unordered_flatmap, unordered_flatmap<int, std::string>{}, integers())->Apply(populate_sizes<unordered_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_freeze, int_unordered_split_flatmap, unordered_split_flatmap<int, std::string>{}, integers())->Apply(populate_sizes<unordered_split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_freeze, short_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, names())->Apply(populate_sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_freeze, short_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, names())->Apply(populate_sizes<unordered_split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_mixed, read_mostly_int_std_map, std::map<int, std::string>{}, integers(), read_mostly)->Apply(insert_sizes<std::map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, read_mostly_int_std_unordered_map, std::unordered_map<int, std::string>{}, integers(), read_mostly)->Apply(insert_sizes<std::unordered_map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, read_mostly_int_unordered_flatmap, unordered_flatmap<int, std::string>{}, integers(), read_mostly)->Apply(insert_sizes<unordered_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, read_mostly_int_flatmap, flatmap<int, std::string>{}, integers(), read_mostly)->Apply(insert_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, read_mostly_int_unordered_split_flatmap, unordered_split_flatmap<int, std::string>{}, integers(), read_mostly)->Apply(insert_sizes<unordered_split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, read_mostly_int_split_flatmap, split_flatmap<int, std::string>{}, integers(), read_mostly)->Apply(insert_sizes<split_flatmap<int, std::string>>);
+
+BENCHMARK_CAPTURE(BM_mixed, read_mostly_long_string_std_map, std::map<std::string, std::string>{}, paths(), read_mostly)->Apply(insert_sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, read_mostly_long_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, paths(), read_mostly)->Apply(insert_sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, read_mostly_long_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, paths(), read_mostly)->Apply(insert_sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, read_mostly_long_string_flatmap, flatmap<std::string, std::string>{}, paths(), read_mostly)->Apply(insert_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, read_mostly_long_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, paths(), read_mostly)->Apply(insert_sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, read_mostly_long_string_split_flatmap, split_flatmap<std::string, std::string>{}, paths(), read_mostly)->Apply(insert_sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_mixed, read_mostly_short_string_std_map, std::map<std::string, std::string>{}, names(), read_mostly)->Apply(insert_sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, read_mostly_short_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, names(), read_mostly)->Apply(insert_sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, read_mostly_short_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, names(), read_mostly)->Apply(insert_sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, read_mostly_short_string_flatmap, flatmap<std::string, std::string>{}, names(), read_mostly)->Apply(insert_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, read_mostly_short_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, names(), read_mostly)->Apply(insert_sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, read_mostly_short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names(), read_mostly)->Apply(insert_sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_mixed, write_heavy_int_std_map, std::map<int, std::string>{}, integers(), write_heavy)->Apply(insert_sizes<std::map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, write_heavy_int_std_unordered_map, std::unordered_map<int, std::string>{}, integers(), write_heavy)->Apply(insert_sizes<std::unordered_map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, write_heavy_int_unordered_flatmap, unordered_flatmap<int, std::string>{}, integers(), write_heavy)->Apply(insert_sizes<unordered_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, write_heavy_int_flatmap, flatmap<int, std::string>{}, integers(), write_heavy)->Apply(insert_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, write_heavy_int_unordered_split_flatmap, unordered_split_flatmap<int, std::string>{}, integers(), write_heavy)->Apply(insert_sizes<unordered_split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, write_heavy_int_split_flatmap, split_flatmap<int, std::string>{}, integers(), write_heavy)->Apply(insert_sizes<split_flatmap<int, std::string>>);
+
+BENCHMARK_CAPTURE(BM_mixed, write_heavy_long_string_std_map, std::map<std::string, std::string>{}, paths(), write_heavy)->Apply(insert_sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, write_heavy_long_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, paths(), write_heavy)->Apply(insert_sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, write_heavy_long_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, paths(), write_heavy)->Apply(insert_sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, write_heavy_long_string_flatmap, flatmap<std::string, std::string>{}, paths(), write_heavy)->Apply(insert_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, write_heavy_long_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, paths(), write_heavy)->Apply(insert_sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, write_heavy_long_string_split_flatmap, split_flatmap<std::string, std::string>{}, paths(), write_heavy)->Apply(insert_sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_mixed, write_heavy_short_string_std_map, std::map<std::string, std::string>{}, names(), write_heavy)->Apply(insert_sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, write_heavy_short_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, names(), write_heavy)->Apply(insert_sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, write_heavy_short_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, names(), write_heavy)->Apply(insert_sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, write_heavy_short_string_flatmap, flatmap<std::string, std::string>{}, names(), write_heavy)->Apply(insert_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, write_heavy_short_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, names(), write_heavy)->Apply(insert_sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_mixed, write_heavy_short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names(), write_heavy)->Apply(insert_sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_latency, insert_int_std_map, std::map<int, std::string>{}, integers(), op_kind::insert)->Apply(insert_sizes<std::map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, insert_int_std_unordered_map, std::unordered_map<int, std::string>{}, integers(), op_kind::insert)->Apply(insert_sizes<std::unordered_map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, insert_int_unordered_flatmap, unordered_flatmap<int, std::string>{}, integers(), op_kind::insert)->Apply(insert_sizes<unordered_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, insert_int_flatmap, flatmap<int, std::string>{}, integers(), op_kind::insert)->Apply(insert_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, insert_int_unordered_split_flatmap, unordered_split_flatmap<int, std::string>{}, integers(), op_kind::insert)->Apply(insert_sizes<unordered_split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, insert_int_split_flatmap, split_flatmap<int, std::string>{}, integers(), op_kind::insert)->Apply(insert_sizes<split_flatmap<int, std::string>>);
+
+BENCHMARK_CAPTURE(BM_latency, insert_long_string_std_map, std::map<std::string, std::string>{}, paths(), op_kind::insert)->Apply(insert_sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, insert_long_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, paths(), op_kind::insert)->Apply(insert_sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, insert_long_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, paths(), op_kind::insert)->Apply(insert_sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, insert_long_string_flatmap, flatmap<std::string, std::string>{}, paths(), op_kind::insert)->Apply(insert_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, insert_long_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, paths(), op_kind::insert)->Apply(insert_sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, insert_long_string_split_flatmap, split_flatmap<std::string, std::string>{}, paths(), op_kind::insert)->Apply(insert_sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_latency, insert_short_string_std_map, std::map<std::string, std::string>{}, names(), op_kind::insert)->Apply(insert_sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, insert_short_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, names(), op_kind::insert)->Apply(insert_sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, insert_short_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, names(), op_kind::insert)->Apply(insert_sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, insert_short_string_flatmap, flatmap<std::string, std::string>{}, names(), op_kind::insert)->Apply(insert_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, insert_short_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, names(), op_kind::insert)->Apply(insert_sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, insert_short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names(), op_kind::insert)->Apply(insert_sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_latency, read_int_std_map, std::map<int, std::string>{}, integers(), op_kind::read)->Apply(sizes<std::map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, read_int_std_unordered_map, std::unordered_map<int, std::string>{}, integers(), op_kind::read)->Apply(sizes<std::unordered_map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, read_int_unordered_flatmap, unordered_flatmap<int, std::string>{}, integers(), op_kind::read)->Apply(sizes<unordered_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, read_int_flatmap, flatmap<int, std::string>{}, integers(), op_kind::read)->Apply(sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, read_int_unordered_split_flatmap, unordered_split_flatmap<int, std::string>{}, integers(), op_kind::read)->Apply(sizes<unordered_split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, read_int_split_flatmap, split_flatmap<int, std::string>{}, integers(), op_kind::read)->Apply(sizes<split_flatmap<int, std::string>>);
+
+BENCHMARK_CAPTURE(BM_latency, read_long_string_std_map, std::map<std::string, std::string>{}, paths(), op_kind::read)->Apply(sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, read_long_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, paths(), op_kind::read)->Apply(sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, read_long_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, paths(), op_kind::read)->Apply(sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, read_long_string_flatmap, flatmap<std::string, std::string>{}, paths(), op_kind::read)->Apply(sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, read_long_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, paths(), op_kind::read)->Apply(sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, read_long_string_split_flatmap, split_flatmap<std::string, std::string>{}, paths(), op_kind::read)->Apply(sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_latency, read_short_string_std_map, std::map<std::string, std::string>{}, names(), op_kind::read)->Apply(sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, read_short_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, names(), op_kind::read)->Apply(sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, read_short_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, names(), op_kind::read)->Apply(sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, read_short_string_flatmap, flatmap<std::string, std::string>{}, names(), op_kind::read)->Apply(sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, read_short_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, names(), op_kind::read)->Apply(sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, read_short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names(), op_kind::read)->Apply(sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_latency, erase_int_std_map, std::map<int, std::string>{}, integers(), op_kind::erase)->Apply(insert_sizes<std::map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, erase_int_std_unordered_map, std::unordered_map<int, std::string>{}, integers(), op_kind::erase)->Apply(insert_sizes<std::unordered_map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, erase_int_unordered_flatmap, unordered_flatmap<int, std::string>{}, integers(), op_kind::erase)->Apply(insert_sizes<unordered_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, erase_int_flatmap, flatmap<int, std::string>{}, integers(), op_kind::erase)->Apply(insert_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, erase_int_unordered_split_flatmap, unordered_split_flatmap<int, std::string>{}, integers(), op_kind::erase)->Apply(insert_sizes<unordered_split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, erase_int_split_flatmap, split_flatmap<int, std::string>{}, integers(), op_kind::erase)->Apply(insert_sizes<split_flatmap<int, std::string>>);
+
+BENCHMARK_CAPTURE(BM_latency, erase_long_string_std_map, std::map<std::string, std::string>{}, paths(), op_kind::erase)->Apply(insert_sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, erase_long_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, paths(), op_kind::erase)->Apply(insert_sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, erase_long_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, paths(), op_kind::erase)->Apply(insert_sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, erase_long_string_flatmap, flatmap<std::string, std::string>{}, paths(), op_kind::erase)->Apply(insert_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, erase_long_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, paths(), op_kind::erase)->Apply(insert_sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, erase_long_string_split_flatmap, split_flatmap<std::string, std::string>{}, paths(), op_kind::erase)->Apply(insert_sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_latency, erase_short_string_std_map, std::map<std::string, std::string>{}, names(), op_kind::erase)->Apply(insert_sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, erase_short_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, names(), op_kind::erase)->Apply(insert_sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, erase_short_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, names(), op_kind::erase)->Apply(insert_sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, erase_short_string_flatmap, flatmap<std::string, std::string>{}, names(), op_kind::erase)->Apply(insert_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, erase_short_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, names(), op_kind::erase)->Apply(insert_sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_latency, erase_short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names(), op_kind::erase)->Apply(insert_sizes<split_flatmap<std::string, std::string>>);
 
 ///
 
-BENCHMARK_CAPTURE(BM_lookup_found, int_std_map, std::map<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_found, int_std_unordered_map, std::unordered_map<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_found, int_unordered_flatmap, unordered_flatmap<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_found, int_flatmap, flatmap<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_found, int_unordered_split_flatmap, unordered_split_flatmap<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_found, int_split_flatmap, split_flatmap<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-
-BENCHMARK_CAPTURE(BM_lookup_found, long_string_std_map, std::map<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_found, long_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_found, long_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_found, long_string_flatmap, flatmap<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_found, long_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_found, long_string_split_flatmap, split_flatmap<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-
-BENCHMARK_CAPTURE(BM_lookup_found, short_string_std_map, std::map<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_found, short_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_found, short_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_found, short_string_flatmap, flatmap<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_found, short_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_found, short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-
-BENCHMARK_CAPTURE(BM_lookup_fail, int_std_map, std::map<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_fail, int_std_unordered_map, std::unordered_map<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_fail, int_unordered_flatmap, unordered_flatmap<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_fail, int_flatmap, flatmap<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_fail, int_unordered_split_flatmap, unordered_split_flatmap<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_fail, int_split_flatmap, split_flatmap<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-
-BENCHMARK_CAPTURE(BM_lookup_fail, long_string_std_map, std::map<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_fail, long_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_fail, long_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_fail, long_string_flatmap, flatmap<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_fail, long_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_fail, long_string_split_flatmap, split_flatmap<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-
-BENCHMARK_CAPTURE(BM_lookup_fail, short_string_std_map, std::map<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_fail, short_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_fail, short_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_fail, short_string_flatmap, flatmap<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_fail, short_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_lookup_fail, short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-
-BENCHMARK_CAPTURE(BM_populate, int_std_map, std::map<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_populate, int_std_unordered_map, std::unordered_map<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_populate, int_unordered_flatmap, unordered_flatmap<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_populate, int_flatmap, flatmap<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_populate, int_unordered_split_flatmap, unordered_split_flatmap<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_populate, int_split_flatmap, split_flatmap<int, std::string>{}, integers())->RangeMultiplier(2)->Range(2, 2<<13);
-
-BENCHMARK_CAPTURE(BM_populate, long_string_std_map, std::map<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_populate, long_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_populate, long_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_populate, long_string_flatmap, flatmap<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_populate, long_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_populate, long_string_split_flatmap, split_flatmap<std::string, std::string>{}, paths())->RangeMultiplier(2)->Range(2, 2<<13);
-
-BENCHMARK_CAPTURE(BM_populate, short_string_std_map, std::map<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_populate, short_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_populate, short_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_populate, short_string_flatmap, flatmap<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_populate, short_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-BENCHMARK_CAPTURE(BM_populate, short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names())->RangeMultiplier(2)->Range(2, 2<<13);
-
-BENCHMARK_MAIN();
+BENCHMARK_CAPTURE(BM_lookup_found, int_std_map, std::map<int, std::string>{}, integers())->Apply(sizes<std::map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_found, int_std_unordered_map, std::unordered_map<int, std::string>{}, integers())->Apply(sizes<std::unordered_map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_found, int_unordered_flatmap, unordered_flatmap<int, std::string>{}, integers())->Apply(sizes<unordered_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_found, int_flatmap, flatmap<int, std::string>{}, integers())->Apply(sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_found, int_unordered_split_flatmap, unordered_split_flatmap<int, std::string>{}, integers())->Apply(sizes<unordered_split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_found, int_split_flatmap, split_flatmap<int, std::string>{}, integers())->Apply(sizes<split_flatmap<int, std::string>>);
+
+BENCHMARK_CAPTURE(BM_lookup_found, long_string_std_map, std::map<std::string, std::string>{}, paths())->Apply(sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_found, long_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, paths())->Apply(sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_found, long_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, paths())->Apply(sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_found, long_string_flatmap, flatmap<std::string, std::string>{}, paths())->Apply(sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_found, long_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, paths())->Apply(sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_found, long_string_split_flatmap, split_flatmap<std::string, std::string>{}, paths())->Apply(sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_lookup_found, short_string_std_map, std::map<std::string, std::string>{}, names())->Apply(sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_found, short_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, names())->Apply(sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_found, short_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, names())->Apply(sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_found, short_string_flatmap, flatmap<std::string, std::string>{}, names())->Apply(sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_found, short_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, names())->Apply(sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_found, short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names())->Apply(sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_lookup_found, uuid_std_map, std::map<std::string, std::string>{}, uuids())->Apply(sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_found, uuid_std_unordered_map, std::unordered_map<std::string, std::string>{}, uuids())->Apply(sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_found, uuid_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, uuids())->Apply(sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_found, uuid_flatmap, flatmap<std::string, std::string>{}, uuids())->Apply(sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_found, uuid_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, uuids())->Apply(sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_found, uuid_split_flatmap, split_flatmap<std::string, std::string>{}, uuids())->Apply(sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_lookup_fail, int_std_map, std::map<int, std::string>{}, integers())->Apply(sizes<std::map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_fail, int_std_unordered_map, std::unordered_map<int, std::string>{}, integers())->Apply(sizes<std::unordered_map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_fail, int_unordered_flatmap, unordered_flatmap<int, std::string>{}, integers())->Apply(sizes<unordered_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_fail, int_flatmap, flatmap<int, std::string>{}, integers())->Apply(sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_fail, int_unordered_split_flatmap, unordered_split_flatmap<int, std::string>{}, integers())->Apply(sizes<unordered_split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_fail, int_split_flatmap, split_flatmap<int, std::string>{}, integers())->Apply(sizes<split_flatmap<int, std::string>>);
+
+BENCHMARK_CAPTURE(BM_lookup_fail, long_string_std_map, std::map<std::string, std::string>{}, paths())->Apply(sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_fail, long_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, paths())->Apply(sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_fail, long_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, paths())->Apply(sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_fail, long_string_flatmap, flatmap<std::string, std::string>{}, paths())->Apply(sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_fail, long_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, paths())->Apply(sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_fail, long_string_split_flatmap, split_flatmap<std::string, std::string>{}, paths())->Apply(sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_lookup_fail, short_string_std_map, std::map<std::string, std::string>{}, names())->Apply(sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_fail, short_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, names())->Apply(sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_fail, short_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, names())->Apply(sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_fail, short_string_flatmap, flatmap<std::string, std::string>{}, names())->Apply(sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_fail, short_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, names())->Apply(sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_fail, short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names())->Apply(sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_lookup_fail, uuid_std_map, std::map<std::string, std::string>{}, uuids())->Apply(sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_fail, uuid_std_unordered_map, std::unordered_map<std::string, std::string>{}, uuids())->Apply(sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_fail, uuid_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, uuids())->Apply(sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_fail, uuid_flatmap, flatmap<std::string, std::string>{}, uuids())->Apply(sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_fail, uuid_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, uuids())->Apply(sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_lookup_fail, uuid_split_flatmap, split_flatmap<std::string, std::string>{}, uuids())->Apply(sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_threaded_lookup, found_shared_int_std_map, std::map<int, std::string>{}, integers(), true, key_sharing::shared)->Apply(threaded_sizes<std::map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, found_shared_int_std_unordered_map, std::unordered_map<int, std::string>{}, integers(), true, key_sharing::shared)->Apply(threaded_sizes<std::unordered_map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, found_shared_int_unordered_flatmap, unordered_flatmap<int, std::string>{}, integers(), true, key_sharing::shared)->Apply(threaded_sizes<unordered_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, found_shared_int_flatmap, flatmap<int, std::string>{}, integers(), true, key_sharing::shared)->Apply(threaded_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, found_shared_int_unordered_split_flatmap, unordered_split_flatmap<int, std::string>{}, integers(), true, key_sharing::shared)->Apply(threaded_sizes<unordered_split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, found_shared_int_split_flatmap, split_flatmap<int, std::string>{}, integers(), true, key_sharing::shared)->Apply(threaded_sizes<split_flatmap<int, std::string>>);
+
+BENCHMARK_CAPTURE(BM_threaded_lookup, found_shared_short_string_std_map, std::map<std::string, std::string>{}, names(), true, key_sharing::shared)->Apply(threaded_sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, found_shared_short_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, names(), true, key_sharing::shared)->Apply(threaded_sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, found_shared_short_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, names(), true, key_sharing::shared)->Apply(threaded_sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, found_shared_short_string_flatmap, flatmap<std::string, std::string>{}, names(), true, key_sharing::shared)->Apply(threaded_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, found_shared_short_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, names(), true, key_sharing::shared)->Apply(threaded_sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, found_shared_short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names(), true, key_sharing::shared)->Apply(threaded_sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_threaded_lookup, found_disjoint_int_std_map, std::map<int, std::string>{}, integers(), true, key_sharing::disjoint)->Apply(threaded_sizes<std::map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, found_disjoint_int_std_unordered_map, std::unordered_map<int, std::string>{}, integers(), true, key_sharing::disjoint)->Apply(threaded_sizes<std::unordered_map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, found_disjoint_int_unordered_flatmap, unordered_flatmap<int, std::string>{}, integers(), true, key_sharing::disjoint)->Apply(threaded_sizes<unordered_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, found_disjoint_int_flatmap, flatmap<int, std::string>{}, integers(), true, key_sharing::disjoint)->Apply(threaded_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, found_disjoint_int_unordered_split_flatmap, unordered_split_flatmap<int, std::string>{}, integers(), true, key_sharing::disjoint)->Apply(threaded_sizes<unordered_split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, found_disjoint_int_split_flatmap, split_flatmap<int, std::string>{}, integers(), true, key_sharing::disjoint)->Apply(threaded_sizes<split_flatmap<int, std::string>>);
+
+BENCHMARK_CAPTURE(BM_threaded_lookup, found_disjoint_short_string_std_map, std::map<std::string, std::string>{}, names(), true, key_sharing::disjoint)->Apply(threaded_sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, found_disjoint_short_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, names(), true, key_sharing::disjoint)->Apply(threaded_sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, found_disjoint_short_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, names(), true, key_sharing::disjoint)->Apply(threaded_sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, found_disjoint_short_string_flatmap, flatmap<std::string, std::string>{}, names(), true, key_sharing::disjoint)->Apply(threaded_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, found_disjoint_short_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, names(), true, key_sharing::disjoint)->Apply(threaded_sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, found_disjoint_short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names(), true, key_sharing::disjoint)->Apply(threaded_sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_threaded_lookup, fail_shared_int_std_map, std::map<int, std::string>{}, integers(), false, key_sharing::shared)->Apply(threaded_sizes<std::map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, fail_shared_int_std_unordered_map, std::unordered_map<int, std::string>{}, integers(), false, key_sharing::shared)->Apply(threaded_sizes<std::unordered_map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, fail_shared_int_unordered_flatmap, unordered_flatmap<int, std::string>{}, integers(), false, key_sharing::shared)->Apply(threaded_sizes<unordered_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, fail_shared_int_flatmap, flatmap<int, std::string>{}, integers(), false, key_sharing::shared)->Apply(threaded_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, fail_shared_int_unordered_split_flatmap, unordered_split_flatmap<int, std::string>{}, integers(), false, key_sharing::shared)->Apply(threaded_sizes<unordered_split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, fail_shared_int_split_flatmap, split_flatmap<int, std::string>{}, integers(), false, key_sharing::shared)->Apply(threaded_sizes<split_flatmap<int, std::string>>);
+
+BENCHMARK_CAPTURE(BM_threaded_lookup, fail_shared_short_string_std_map, std::map<std::string, std::string>{}, names(), false, key_sharing::shared)->Apply(threaded_sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, fail_shared_short_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, names(), false, key_sharing::shared)->Apply(threaded_sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, fail_shared_short_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, names(), false, key_sharing::shared)->Apply(threaded_sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, fail_shared_short_string_flatmap, flatmap<std::string, std::string>{}, names(), false, key_sharing::shared)->Apply(threaded_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, fail_shared_short_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, names(), false, key_sharing::shared)->Apply(threaded_sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, fail_shared_short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names(), false, key_sharing::shared)->Apply(threaded_sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_threaded_lookup, fail_disjoint_int_std_map, std::map<int, std::string>{}, integers(), false, key_sharing::disjoint)->Apply(threaded_sizes<std::map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, fail_disjoint_int_std_unordered_map, std::unordered_map<int, std::string>{}, integers(), false, key_sharing::disjoint)->Apply(threaded_sizes<std::unordered_map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, fail_disjoint_int_unordered_flatmap, unordered_flatmap<int, std::string>{}, integers(), false, key_sharing::disjoint)->Apply(threaded_sizes<unordered_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, fail_disjoint_int_flatmap, flatmap<int, std::string>{}, integers(), false, key_sharing::disjoint)->Apply(threaded_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, fail_disjoint_int_unordered_split_flatmap, unordered_split_flatmap<int, std::string>{}, integers(), false, key_sharing::disjoint)->Apply(threaded_sizes<unordered_split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, fail_disjoint_int_split_flatmap, split_flatmap<int, std::string>{}, integers(), false, key_sharing::disjoint)->Apply(threaded_sizes<split_flatmap<int, std::string>>);
+
+BENCHMARK_CAPTURE(BM_threaded_lookup, fail_disjoint_short_string_std_map, std::map<std::string, std::string>{}, names(), false, key_sharing::disjoint)->Apply(threaded_sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, fail_disjoint_short_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, names(), false, key_sharing::disjoint)->Apply(threaded_sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, fail_disjoint_short_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, names(), false, key_sharing::disjoint)->Apply(threaded_sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, fail_disjoint_short_string_flatmap, flatmap<std::string, std::string>{}, names(), false, key_sharing::disjoint)->Apply(threaded_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, fail_disjoint_short_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, names(), false, key_sharing::disjoint)->Apply(threaded_sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_threaded_lookup, fail_disjoint_short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names(), false, key_sharing::disjoint)->Apply(threaded_sizes<split_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_populate, int_std_map, std::map<int, std::string>{}, integers())->Apply(populate_sizes<std::map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_populate, int_std_unordered_map, std::unordered_map<int, std::string>{}, integers())->Apply(populate_sizes<std::unordered_map<int, std::string>>);
+BENCHMARK_CAPTURE(BM_populate, int_unordered_flatmap, unordered_flatmap<int, std::string>{}, integers())->Apply(populate_sizes<unordered_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_populate, int_flatmap, flatmap<int, std::string>{}, integers())->Apply(populate_sizes<flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_populate, int_unordered_split_flatmap, unordered_split_flatmap<int, std::string>{}, integers())->Apply(populate_sizes<unordered_split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_populate, int_split_flatmap, split_flatmap<int, std::string>{}, integers())->Apply(populate_sizes<split_flatmap<int, std::string>>);
+BENCHMARK_CAPTURE(BM_populate, int_chunked_flatmap, chunked_flatmap<int, std::string>{}, integers())->Apply(populate_sizes<chunked_flatmap<int, std::string>>);
+
+BENCHMARK_CAPTURE(BM_populate, long_string_std_map, std::map<std::string, std::string>{}, paths())->Apply(populate_sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate, long_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, paths())->Apply(populate_sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate, long_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, paths())->Apply(populate_sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate, long_string_flatmap, flatmap<std::string, std::string>{}, paths())->Apply(populate_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate, long_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, paths())->Apply(populate_sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate, long_string_split_flatmap, split_flatmap<std::string, std::string>{}, paths())->Apply(populate_sizes<split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate, long_string_chunked_flatmap, chunked_flatmap<std::string, std::string>{}, paths())->Apply(populate_sizes<chunked_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_populate, short_string_std_map, std::map<std::string, std::string>{}, names())->Apply(populate_sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate, short_string_std_unordered_map, std::unordered_map<std::string, std::string>{}, names())->Apply(populate_sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate, short_string_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, names())->Apply(populate_sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate, short_string_flatmap, flatmap<std::string, std::string>{}, names())->Apply(populate_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate, short_string_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, names())->Apply(populate_sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate, short_string_split_flatmap, split_flatmap<std::string, std::string>{}, names())->Apply(populate_sizes<split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate, short_string_chunked_flatmap, chunked_flatmap<std::string, std::string>{}, names())->Apply(populate_sizes<chunked_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_populate, uuid_std_map, std::map<std::string, std::string>{}, uuids())->Apply(populate_sizes<std::map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate, uuid_std_unordered_map, std::unordered_map<std::string, std::string>{}, uuids())->Apply(populate_sizes<std::unordered_map<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate, uuid_unordered_flatmap, unordered_flatmap<std::string, std::string>{}, uuids())->Apply(populate_sizes<unordered_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate, uuid_flatmap, flatmap<std::string, std::string>{}, uuids())->Apply(populate_sizes<flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate, uuid_unordered_split_flatmap, unordered_split_flatmap<std::string, std::string>{}, uuids())->Apply(populate_sizes<unordered_split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate, uuid_split_flatmap, split_flatmap<std::string, std::string>{}, uuids())->Apply(populate_sizes<split_flatmap<std::string, std::string>>);
+BENCHMARK_CAPTURE(BM_populate, uuid_chunked_flatmap, chunked_flatmap<std::string, std::string>{}, uuids())->Apply(populate_sizes<chunked_flatmap<std::string, std::string>>);
+
+BENCHMARK_CAPTURE(BM_populate, int_payload64_std_map, std::map<int, payload<64>>{}, integers())->Apply(populate_sizes<std::map<int, payload<64>>>);
+BENCHMARK_CAPTURE(BM_populate, int_payload64_flatmap, flatmap<int, payload<64>>{}, integers())->Apply(populate_sizes<flatmap<int, payload<64>>>);
+BENCHMARK_CAPTURE(BM_populate, int_payload64_split_flatmap, split_flatmap<int, payload<64>>{}, integers())->Apply(populate_sizes<split_flatmap<int, payload<64>>>);
+BENCHMARK_CAPTURE(BM_populate, int_payload64_slot_flatmap, slot_flatmap<int, payload<64>>{}, integers())->Apply(populate_sizes<slot_flatmap<int, payload<64>>>);
+
+BENCHMARK_CAPTURE(BM_populate, int_payload256_std_map, std::map<int, payload<256>>{}, integers())->Apply(populate_sizes<std::map<int, payload<256>>>);
+BENCHMARK_CAPTURE(BM_populate, int_payload256_flatmap, flatmap<int, payload<256>>{}, integers())->Apply(populate_sizes<flatmap<int, payload<256>>>);
+BENCHMARK_CAPTURE(BM_populate, int_payload256_split_flatmap, split_flatmap<int, payload<256>>{}, integers())->Apply(populate_sizes<split_flatmap<int, payload<256>>>);
+BENCHMARK_CAPTURE(BM_populate, int_payload256_slot_flatmap, slot_flatmap<int, payload<256>>{}, integers())->Apply(populate_sizes<slot_flatmap<int, payload<256>>>);
+
+BENCHMARK_CAPTURE(BM_erase, int_payload64_std_map, std::map<int, payload<64>>{}, integers())->Apply(populate_sizes<std::map<int, payload<64>>>);
+BENCHMARK_CAPTURE(BM_erase, int_payload64_flatmap, flatmap<int, payload<64>>{}, integers())->Apply(populate_sizes<flatmap<int, payload<64>>>);
+BENCHMARK_CAPTURE(BM_erase, int_payload64_split_flatmap, split_flatmap<int, payload<64>>{}, integers())->Apply(populate_sizes<split_flatmap<int, payload<64>>>);
+BENCHMARK_CAPTURE(BM_erase, int_payload64_slot_flatmap, slot_flatmap<int, payload<64>>{}, integers())->Apply(populate_sizes<slot_flatmap<int, payload<64>>>);
+
+BENCHMARK_CAPTURE(BM_erase, int_payload256_std_map, std::map<int, payload<256>>{}, integers())->Apply(populate_sizes<std::map<int, payload<256>>>);
+BENCHMARK_CAPTURE(BM_erase, int_payload256_flatmap, flatmap<int, payload<256>>{}, integers())->Apply(populate_sizes<flatmap<int, payload<256>>>);
+BENCHMARK_CAPTURE(BM_erase, int_payload256_split_flatmap, split_flatmap<int, payload<256>>{}, integers())->Apply(populate_sizes<split_flatmap<int, payload<256>>>);
+BENCHMARK_CAPTURE(BM_erase, int_payload256_slot_flatmap, slot_flatmap<int, payload<256>>{}, integers())->Apply(populate_sizes<slot_flatmap<int, payload<256>>>);
+
+// --seed=N, --cache=mode and --isa=level are taken out of the arguments
+// before the benchmark library parses them, and recorded in the context of
+// the report. --isa=scalar|sse4.2|avx2|avx512 forces the simd kernels the
+// maps scan integer keys with, to compare them on one machine.
+int main(int argc, char** argv)
+{
+  static const std::pair<std::string_view, cache_mode> cache_modes[] = {
+    { "warm", cache_mode::warm }, { "l2_cold", cache_mode::l2_cold }, { "llc_cold", cache_mode::llc_cold }
+  };
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string_view const arg = argv[i];
+    if (arg.substr(0, 7) == "--seed=")
+    {
+      seed = std::strtoull(argv[i] + 7, nullptr, 0);
+    }
+    else if (arg.substr(0, 8) == "--cache=")
+    {
+      auto const m = std::find_if(std::begin(cache_modes), std::end(cache_modes),
+                                  [name = arg.substr(8)](auto& mode) { return mode.first == name;});
+      if (m == std::end(cache_modes))
+      {
+        std::fprintf(stderr, "%s: unknown cache mode, use warm, l2_cold or llc_cold\n", argv[i]);
+        return 1;
+      }
+      cache = m->second;
+    }
+    else if (arg.substr(0, 6) == "--isa=")
+    {
+      static const simd::isa levels[] = { simd::isa::scalar, simd::isa::sse4_2, simd::isa::avx2, simd::isa::avx512 };
+      auto const l = std::find_if(std::begin(levels), std::end(levels),
+                                  [name = arg.substr(6)](auto level) { return simd::name(level) == name;});
+      if (l == std::end(levels))
+      {
+        std::fprintf(stderr, "%s: unknown instruction set, use scalar, sse4.2, avx2 or avx512\n", argv[i]);
+        return 1;
+      }
+      if (simd::force(*l) != *l)
+      {
+        std::fprintf(stderr, "%s: not supported by this CPU\n", argv[i]);
+        return 1;
+      }
+    }
+    else
+    {
+      continue;
+    }
+    std::copy(argv + i + 1, argv + argc, argv + i);
+    --argc;
+    --i;
+  }
+  gen.seed(seed);
+  benchmark::AddCustomContext("seed", std::to_string(seed));
+  auto const mode = std::find_if(std::begin(cache_modes), std::end(cache_modes),
+                                 [](auto& m) { return m.second == cache;});
+  benchmark::AddCustomContext("cache", std::string(mode->first));
+  benchmark::AddCustomContext("isa", simd::name(simd::active()));
+  limit_cold_iterations();
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+}
@@ -0,0 +1,287 @@
+#ifndef FLATMAP_FLATMAP_PARALLEL_HPP
+#define FLATMAP_FLATMAP_PARALLEL_HPP
+
+#include "flatmap.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Builds a flatmap or split_flatmap from shards of unsorted pairs, such as
+// the outputs of worker threads, on several threads:
+//
+//   1. each shard is sorted, one shard per task
+//   2. splitter keys sampled from the sorted shards cut the key space into
+//      partitions of about equal size
+//   3. each partition counts its distinct keys, which gives where in the
+//      map its elements go
+//   4. each partition k-way merges its slices of the shards straight into
+//      the reserved columns of the map
+//
+// Elements are moved out of the shards once, into the map. When a key is
+// in several shards, or several times in one, its value is
+// resolve(value so far, next value) in shard order, keeping the first by
+// default. The partitions share one resolve and call it from their own
+// threads at the same time, so it must be safe to call concurrently.
+
+struct parallel_build_options
+{
+  // Threads to use, where 0 means std::thread::hardware_concurrency().
+  unsigned threads = 0;
+  // Partitions per thread. More partitions even out the work between the
+  // threads, at the cost of more splitter searches.
+  unsigned partitions_per_thread = 4;
+};
+
+namespace impl
+{
+  // Runs f(0) ... f(n - 1) on up to threads threads, and rethrows the first
+  // exception thrown once all have finished.
+  template <typename F>
+  void parallel_for(std::size_t n, unsigned threads, F&& f)
+  {
+    std::atomic<std::size_t> next{0};
+    std::exception_ptr error;
+    std::atomic_flag failed = ATOMIC_FLAG_INIT;
+    auto const work = [&]() noexcept {
+      for (std::size_t i; (i = next++) < n;)
+      {
+        try
+        {
+          f(i);
+        }
+        catch (...)
+        {
+          if (!failed.test_and_set()) error = std::current_exception();
+        }
+      }
+    };
+    std::vector<std::thread> workers;
+    auto const extra = std::min<std::size_t>(threads, n) - (n != 0);
+    workers.reserve(extra);
+    try
+    {
+      for (std::size_t t = 0; t != extra; ++t)
+      {
+        workers.emplace_back(work);
+      }
+    }
+    catch (...)
+    {
+      // Too few threads only makes it slower.
+    }
+    work();
+    for (auto& w : workers)
+    {
+      w.join();
+    }
+    if (error) std::rethrow_exception(error);
+  }
+
+  // Where the partitions write: the pairs of a flatmap, or the columns of
+  // a split_flatmap.
+  template <typename Key, typename Value>
+  struct pair_sink
+  {
+    std::pair<Key, Value>* out;
+    void construct(std::size_t i, Key&& k, Value&& v) noexcept { ::new(out + i) std::pair<Key, Value>(std::move(k), std::move(v));}
+    const Key& key(std::size_t i) const noexcept { return out[i].first;}
+    Value& value(std::size_t i) const noexcept { return out[i].second;}
+    void destroy(std::size_t b, std::size_t e) noexcept { std::destroy(out + b, out + e);}
+  };
+
+  template <typename Key, typename Value>
+  struct column_sink
+  {
+    Key* keys;
+    Value* values;
+    void construct(std::size_t i, Key&& k, Value&& v) noexcept
+    {
+      ::new(keys + i) Key(std::move(k));
+      ::new(values + i) Value(std::move(v));
+    }
+    const Key& key(std::size_t i) const noexcept { return keys[i];}
+    Value& value(std::size_t i) const noexcept { return values[i];}
+    void destroy(std::size_t b, std::size_t e) noexcept
+    {
+      std::destroy(keys + b, keys + e);
+      std::destroy(values + b, values + e);
+    }
+  };
+
+  // The slices of the shards that one partition merges.
+  template <typename Pair>
+  struct merge_cursor
+  {
+    Pair* cur;
+    Pair* end;
+    std::size_t shard;
+  };
+
+  // Calls f with each element of the slices in key order, and for equal
+  // keys in shard order.
+  template <typename Pair, typename Compare, typename F>
+  void kway_merge(std::vector<merge_cursor<Pair>> cursors, const Compare& comp, F&& f)
+  {
+    // A max heap on this order keeps the smallest key of the lowest shard
+    // on top.
+    auto const after = [&comp](const merge_cursor<Pair>& lh, const merge_cursor<Pair>& rh) {
+      if (comp(rh.cur->first, lh.cur->first)) return true;
+      return !comp(lh.cur->first, rh.cur->first) && lh.shard > rh.shard;
+    };
+    cursors.erase(std::remove_if(cursors.begin(), cursors.end(), [](auto& c) { return c.cur == c.end;}), cursors.end());
+    std::make_heap(cursors.begin(), cursors.end(), after);
+    while (!cursors.empty())
+    {
+      std::pop_heap(cursors.begin(), cursors.end(), after);
+      auto& c = cursors.back();
+      f(*c.cur);
+      if (++c.cur == c.end) cursors.pop_back();
+      else std::push_heap(cursors.begin(), cursors.end(), after);
+    }
+  }
+
+  template <typename Key, typename Value>
+  pair_sink<Key, Value> sink_of(relocating_vector<std::pair<Key, Value>>& values) noexcept { return { values.data()};}
+
+  template <typename Key, typename Value>
+  column_sink<Key, Value> sink_of(split_columns<Key, Value>& columns) noexcept { return { columns.keys(), columns.values()};}
+
+  template <typename Key, typename Value, typename Compare, typename Storage, typename Resolve>
+  void parallel_build(Storage& storage,
+                      std::vector<std::vector<std::pair<Key, Value>>>& shards,
+                      const Compare& comp,
+                      parallel_build_options opts,
+                      Resolve& resolve)
+  {
+    using pair = std::pair<Key, Value>;
+    storage.clear();
+    auto const threads = std::max(1U, opts.threads ? opts.threads : std::thread::hardware_concurrency());
+    auto const key_compare = [&comp](const pair& lh, const pair& rh) { return comp(lh.first, rh.first);};
+
+    parallel_for(shards.size(), threads, [&](std::size_t s) {
+      auto& shard = shards[s];
+      if (!std::is_sorted(shard.begin(), shard.end(), key_compare))
+      {
+        std::stable_sort(shard.begin(), shard.end(), key_compare);
+      }
+    });
+
+    std::size_t total = 0;
+    for (auto& shard : shards) total += shard.size();
+    auto const parts = std::max<std::size_t>(1, std::min<std::size_t>(std::size_t{threads} * std::max(1U, opts.partitions_per_thread), total / 1024));
+    std::vector<const Key*> samples;
+    for (auto& shard : shards)
+    {
+      auto const n = std::min(shard.size(), 8 * parts);
+      for (std::size_t i = 0; i != n; ++i)
+      {
+        samples.push_back(&shard[(2 * i + 1) * shard.size() / (2 * n)].first);
+      }
+    }
+    std::sort(samples.begin(), samples.end(), [&comp](const Key* lh, const Key* rh) { return comp(*lh, *rh);});
+
+    // bounds[p * shards + s] is where partition p starts in shard s. A key
+    // and all its copies fall in one partition, since partitions start at
+    // the lower bound of their splitter.
+    auto const num_shards = shards.size();
+    std::vector<pair*> bounds((parts + 1) * num_shards);
+    for (std::size_t s = 0; s != num_shards; ++s)
+    {
+      auto const data = shards[s].data();
+      bounds[s] = data;
+      bounds[parts * num_shards + s] = data + shards[s].size();
+      for (std::size_t p = 1; p != parts; ++p)
+      {
+        auto const& splitter = *samples[p * samples.size() / parts];
+        bounds[p * num_shards + s] = std::lower_bound(bounds[(p - 1) * num_shards + s], data + shards[s].size(), splitter,
+                                                      [&comp](const pair& lh, const Key& rh) { return comp(lh.first, rh);});
+      }
+    }
+    auto const cursors = [&](std::size_t p) {
+      std::vector<merge_cursor<pair>> rv;
+      rv.reserve(num_shards);
+      for (std::size_t s = 0; s != num_shards; ++s)
+      {
+        rv.push_back({ bounds[p * num_shards + s], bounds[(p + 1) * num_shards + s], s });
+      }
+      return rv;
+    };
+
+    std::vector<std::size_t> offsets(parts + 1);
+    parallel_for(parts, threads, [&](std::size_t p) {
+      std::size_t n = 0;
+      const Key* prev = nullptr;
+      kway_merge(cursors(p), comp, [&](const pair& x) {
+        if (!prev || comp(*prev, x.first)) ++n;
+        prev = &x.first;
+      });
+      offsets[p + 1] = n;
+    });
+    for (std::size_t p = 0; p != parts; ++p) offsets[p + 1] += offsets[p];
+
+    storage.reserve(offsets[parts]);
+    auto sink = sink_of(storage);
+    std::vector<char> done(parts);
+    try
+    {
+      parallel_for(parts, threads, [&](std::size_t p) {
+        auto i = offsets[p];
+        try
+        {
+          kway_merge(cursors(p), comp, [&](pair& x) {
+            if (i != offsets[p] && !comp(sink.key(i - 1), x.first))
+            {
+              sink.value(i - 1) = resolve(std::move(sink.value(i - 1)), std::move(x.second));
+            }
+            else
+            {
+              sink.construct(i++, std::move(x.first), std::move(x.second));
+            }
+          });
+        }
+        catch (...)
+        {
+          sink.destroy(offsets[p], i);
+          throw;
+        }
+        done[p] = 1;
+      });
+    }
+    catch (...)
+    {
+      for (std::size_t p = 0; p != parts; ++p)
+      {
+        if (done[p]) sink.destroy(offsets[p], offsets[p + 1]);
+      }
+      throw;
+    }
+    storage.append_constructed(offsets[parts]);
+    shards.clear();
+  }
+}
+
+// Replaces the contents of map with the elements of shards. shards is
+// taken by value: pass it with std::move to build without copying the
+// pairs, or as an lvalue to keep the caller's shards intact.
+template <typename Key, typename Value, typename Compare, typename Resolve = impl::keep_first>
+void parallel_build(flatmap<Key, Value, Compare>& map,
+                    std::vector<std::vector<std::pair<Key, Value>>> shards,
+                    parallel_build_options opts = {},
+                    Resolve resolve = {})
+{
+  impl::parallel_build<Key, Value>(impl::storage_access::values(map), shards, impl::storage_access::compare(map), opts, resolve);
+}
+
+template <typename Key, typename Value, typename Compare, typename Resolve = impl::keep_first>
+void parallel_build(split_flatmap<Key, Value, Compare>& map,
+                    std::vector<std::vector<std::pair<Key, Value>>> shards,
+                    parallel_build_options opts = {},
+                    Resolve resolve = {})
+{
+  impl::parallel_build<Key, Value>(impl::storage_access::columns(map), shards, impl::storage_access::compare(map), opts, resolve);
+}
+
+#endif //FLATMAP_FLATMAP_PARALLEL_HPP
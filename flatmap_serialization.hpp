@@ -0,0 +1,468 @@
+#ifndef FLATMAP_FLATMAP_SERIALIZATION_HPP
+#define FLATMAP_FLATMAP_SERIALIZATION_HPP
+
+#include "flatmap.hpp"
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Streaming binary format shared by all four containers:
+//
+//   header { magic, version, count, key column tag, value column tag }
+//   key column
+//   value column
+//
+// Each column is encoded by a column_codec, which is specialized for
+// trivially copyable types (raw bytes in native byte order) and for
+// std::basic_string (all lengths, then all characters). Specialize
+// column_codec for other types. Since the format is the same for all
+// containers, a map saved from one can be loaded into another.
+//
+// Counts and lengths in a stream are not trusted. Loading grows the
+// containers and strings in bounded steps as the data actually arrives, so
+// a truncated or hostile stream fails with an exception instead of forcing
+// a huge allocation. A codec reading the key column may therefore see the
+// container grow between elements, and must not keep references to
+// elements it has already read. Loading into a sorted container keeps the
+// first of repeated keys.
+
+namespace serialization
+{
+  struct column_tag
+  {
+    std::uint8_t  codec;
+    std::uint32_t element_size;
+  };
+
+  struct identity
+  {
+    template <typename T>
+    constexpr T& operator()(T& t) const noexcept { return t;}
+  };
+
+  template <typename T, typename = void>
+  struct column_codec;
+
+  namespace detail
+  {
+    static constexpr char magic[4] = { 'F', 'L', 'M', 'S' };
+    static constexpr std::uint32_t version = 1;
+    static constexpr std::size_t chunk_size = 4096;
+
+    template <typename T>
+    void write_raw(std::ostream& os, const T& t)
+    {
+      os.write(reinterpret_cast<const char*>(&t), sizeof(T));
+    }
+
+    template <typename T>
+    T read_raw(std::istream& is)
+    {
+      T t;
+      is.read(reinterpret_cast<char*>(&t), sizeof(T));
+      return t;
+    }
+
+    inline void check(std::ios& s)
+    {
+      if (!s)
+      {
+        throw std::runtime_error("flatmap serialization stream failure");
+      }
+    }
+
+    // How many elements or characters to read before the stream has
+    // shown that more are there.
+    static constexpr std::size_t min_growth = 1024;
+
+    // An iterator over the first column of a container that grows the
+    // container to cover an element when it is first dereferenced, to at
+    // most count elements and at most twice the elements read so far.
+    template <typename Storage, typename At>
+    class growing_iterator
+    {
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = std::remove_reference_t<decltype(std::declval<At>()(std::declval<Storage&>(), std::size_t{}))>;
+      using difference_type = std::ptrdiff_t;
+      using pointer = value_type*;
+      using reference = value_type&;
+
+      growing_iterator(Storage& s_, std::size_t idx_, std::size_t count_, At at_) : s{&s_}, idx{idx_}, count{count_}, at{at_} {}
+      reference operator*() const
+      {
+        if (idx >= s->size())
+        {
+          s->resize(std::min(count, std::max({ idx + 1, 2 * s->size(), min_growth })));
+        }
+        return at(*s, idx);
+      }
+      growing_iterator& operator++() noexcept { ++idx; return *this;}
+      growing_iterator operator++(int) noexcept { auto rv = *this; ++idx; return rv;}
+      bool operator==(const growing_iterator& rh) const noexcept { return idx == rh.idx;}
+      bool operator!=(const growing_iterator& rh) const noexcept { return idx != rh.idx;}
+    private:
+      Storage*    s;
+      std::size_t idx;
+      std::size_t count;
+      At          at;
+    };
+
+    // Reads the first column of count elements into the empty storage,
+    // where at(storage, i) is the element i of the column. Trivially
+    // copyable columns are read in geometrically growing chunks, and
+    // others through a growing_iterator.
+    template <typename T, typename Storage, typename At, typename Proj>
+    void read_first_column(std::istream& is, Storage& storage, std::size_t count, At at, Proj proj)
+    {
+      if constexpr (std::is_trivially_copyable<T>{})
+      {
+        for (std::size_t done = 0; done != count;)
+        {
+          auto const next = std::min(count, std::max(2 * done, min_growth));
+          storage.resize(next);
+          column_codec<T>::read(is, &at(storage, 0) + done, &at(storage, 0) + next, proj);
+          done = next;
+        }
+      }
+      else
+      {
+        column_codec<T>::read(is, growing_iterator<Storage, At>(storage, 0, count, at),
+                              growing_iterator<Storage, At>(storage, count, count, at), proj);
+        storage.resize(count);
+      }
+    }
+
+    template <typename Iterator, typename T>
+    using is_contiguous = std::integral_constant<bool,
+                                                 std::is_same<Iterator, T*>{} ||
+                                                 std::is_same<Iterator, const T*>{} ||
+                                                 std::is_same<Iterator, typename std::vector<T>::iterator>{} ||
+                                                 std::is_same<Iterator, typename std::vector<T>::const_iterator>{}>;
+  }
+
+  template <typename T>
+  struct column_codec<T, std::enable_if_t<std::is_trivially_copyable<T>{}>>
+  {
+    static constexpr column_tag tag{ 1, sizeof(T) };
+
+    template <typename Iterator, typename Proj>
+    static void write(std::ostream& os, Iterator b, Iterator e, Proj proj)
+    {
+      if (b == e) return;
+      if constexpr (std::is_same<Proj, identity>{} && detail::is_contiguous<Iterator, T>{})
+      {
+        os.write(reinterpret_cast<const char*>(std::addressof(*b)),
+                 static_cast<std::streamsize>(std::distance(b, e) * sizeof(T)));
+      }
+      else
+      {
+        constexpr std::size_t per_chunk = std::max<std::size_t>(1, detail::chunk_size / sizeof(T));
+        alignas(T) char buffer[per_chunk * sizeof(T)];
+        std::size_t n = 0;
+        for (; b != e; ++b)
+        {
+          const T& t = proj(*b);
+          std::memcpy(buffer + n * sizeof(T), std::addressof(t), sizeof(T));
+          if (++n == per_chunk)
+          {
+            os.write(buffer, sizeof(buffer));
+            n = 0;
+          }
+        }
+        os.write(buffer, static_cast<std::streamsize>(n * sizeof(T)));
+      }
+    }
+
+    template <typename Iterator, typename Proj>
+    static void read(std::istream& is, Iterator b, Iterator e, Proj proj)
+    {
+      if (b == e) return;
+      if constexpr (std::is_same<Proj, identity>{} && detail::is_contiguous<Iterator, T>{})
+      {
+        is.read(reinterpret_cast<char*>(std::addressof(*b)),
+                static_cast<std::streamsize>(std::distance(b, e) * sizeof(T)));
+        detail::check(is);
+      }
+      else
+      {
+        constexpr std::size_t per_chunk = std::max<std::size_t>(1, detail::chunk_size / sizeof(T));
+        alignas(T) char buffer[per_chunk * sizeof(T)];
+        while (b != e)
+        {
+          std::size_t n = 0;
+          auto chunk_end = b;
+          while (chunk_end != e && n != per_chunk)
+          {
+            ++chunk_end;
+            ++n;
+          }
+          is.read(buffer, static_cast<std::streamsize>(n * sizeof(T)));
+          detail::check(is);
+          for (auto p = buffer; b != chunk_end; ++b, p += sizeof(T))
+          {
+            std::memcpy(std::addressof(proj(*b)), p, sizeof(T));
+          }
+        }
+      }
+    }
+  };
+
+  template <typename C, typename Traits, typename Allocator>
+  struct column_codec<std::basic_string<C, Traits, Allocator>>
+  {
+    static_assert(std::is_trivially_copyable<C>{});
+    static constexpr column_tag tag{ 2, sizeof(C) };
+
+    template <typename Iterator, typename Proj>
+    static void write(std::ostream& os, Iterator b, Iterator e, Proj proj)
+    {
+      column_codec<std::uint64_t>::write(os, b, e,
+                                         [&proj](auto&& x) { return std::uint64_t(proj(x).size());});
+      for (; b != e; ++b)
+      {
+        auto& s = proj(*b);
+        os.write(reinterpret_cast<const char*>(s.data()), static_cast<std::streamsize>(s.size() * sizeof(C)));
+      }
+    }
+
+    // The lengths come before all characters. Each length is parked in
+    // the characters of its string, which fits in the small string buffer
+    // and so allocates nothing, and the string then grows in bounded steps
+    // as its characters arrive.
+    template <typename Iterator, typename Proj>
+    static void read(std::istream& is, Iterator b, Iterator e, Proj proj)
+    {
+      constexpr std::size_t per_chunk = detail::chunk_size / sizeof(std::uint64_t);
+      constexpr std::size_t parked_size = (sizeof(std::uint64_t) + sizeof(C) - 1) / sizeof(C);
+      std::uint64_t lengths[per_chunk];
+      for (auto i = b; i != e;)
+      {
+        std::size_t n = 0;
+        auto chunk_end = i;
+        while (chunk_end != e && n != per_chunk)
+        {
+          ++chunk_end;
+          ++n;
+        }
+        is.read(reinterpret_cast<char*>(lengths), static_cast<std::streamsize>(n * sizeof(std::uint64_t)));
+        detail::check(is);
+        for (auto l = lengths; i != chunk_end; ++i, ++l)
+        {
+          auto& s = proj(*i);
+          s.resize(parked_size);
+          std::memcpy(s.data(), l, sizeof(*l));
+        }
+      }
+      for (; b != e; ++b)
+      {
+        auto& s = proj(*b);
+        std::uint64_t length;
+        std::memcpy(&length, s.data(), sizeof(length));
+        s.clear();
+        while (s.size() != length)
+        {
+          auto const old = s.size();
+          auto const n = static_cast<std::size_t>(std::min<std::uint64_t>(length - old, std::max(old, detail::min_growth)));
+          s.resize(old + n);
+          is.read(reinterpret_cast<char*>(s.data() + old), static_cast<std::streamsize>(n * sizeof(C)));
+          detail::check(is);
+        }
+      }
+    }
+  };
+
+  namespace detail
+  {
+    template <typename Key, typename Value>
+    void write_header(std::ostream& os, std::uint64_t count)
+    {
+      os.write(magic, sizeof(magic));
+      write_raw(os, version);
+      write_raw(os, count);
+      write_raw(os, column_codec<Key>::tag.codec);
+      write_raw(os, column_codec<Key>::tag.element_size);
+      write_raw(os, column_codec<Value>::tag.codec);
+      write_raw(os, column_codec<Value>::tag.element_size);
+    }
+
+    template <typename Key, typename Value>
+    std::uint64_t read_header(std::istream& is)
+    {
+      char m[sizeof(magic)];
+      is.read(m, sizeof(m));
+      auto const v = read_raw<std::uint32_t>(is);
+      auto const count = read_raw<std::uint64_t>(is);
+      auto const key_codec = read_raw<std::uint8_t>(is);
+      auto const key_size = read_raw<std::uint32_t>(is);
+      auto const value_codec = read_raw<std::uint8_t>(is);
+      auto const value_size = read_raw<std::uint32_t>(is);
+      check(is);
+      if (std::memcmp(m, magic, sizeof(magic)) != 0 || v != version)
+      {
+        throw std::runtime_error("not a flatmap stream, or unsupported version");
+      }
+      if (key_codec != column_codec<Key>::tag.codec || key_size != column_codec<Key>::tag.element_size ||
+          value_codec != column_codec<Value>::tag.codec || value_size != column_codec<Value>::tag.element_size)
+      {
+        throw std::runtime_error("flatmap stream key or value type mismatch");
+      }
+      return count;
+    }
+
+    template <typename Key, typename Value, typename Storage>
+    void save_pairs(std::ostream& os, const Storage& values)
+    {
+      write_header<Key, Value>(os, values.size());
+      column_codec<Key>::write(os, values.begin(), values.end(), [](auto& p) -> auto& { return p.first;});
+      column_codec<Value>::write(os, values.begin(), values.end(), [](auto& p) -> auto& { return p.second;});
+      check(os);
+    }
+
+    template <typename Key, typename Value, typename Storage>
+    void load_pairs(std::istream& is, Storage& values)
+    {
+      values.clear();
+      auto const count = read_header<Key, Value>(is);
+      try
+      {
+        read_first_column<Key>(is, values, count,
+                               [](Storage& v, std::size_t i) -> auto& { return v[i];},
+                               [](auto& p) -> auto& { return p.first;});
+        column_codec<Value>::read(is, values.begin(), values.end(), [](auto& p) -> auto& { return p.second;});
+      }
+      catch (...)
+      {
+        values.clear();
+        throw;
+      }
+    }
+
+    template <typename Key, typename Value, typename Columns>
+    void save_columns(std::ostream& os, const Columns& columns)
+    {
+      auto const count = columns.size();
+      write_header<Key, Value>(os, count);
+      column_codec<Key>::write(os, columns.keys(), columns.keys() + count, identity{});
+      column_codec<Value>::write(os, columns.values(), columns.values() + count, identity{});
+      check(os);
+    }
+
+    template <typename Key, typename Value, typename Columns>
+    void load_columns(std::istream& is, Columns& columns)
+    {
+      columns.clear();
+      auto const count = read_header<Key, Value>(is);
+      try
+      {
+        read_first_column<Key>(is, columns, count,
+                               [](Columns& c, std::size_t i) -> Key& { return c.keys()[i];},
+                               identity{});
+        column_codec<Value>::read(is, columns.values(), columns.values() + count, identity{});
+      }
+      catch (...)
+      {
+        columns.clear();
+        throw;
+      }
+    }
+
+    // Removes all but the first of each run of equal keys from sorted
+    // columns.
+    template <typename Columns, typename Compare>
+    void unique_columns(Columns& columns, const Compare& comp)
+    {
+      auto const keys = columns.keys();
+      auto const values = columns.values();
+      std::size_t kept = 0;
+      for (std::size_t i = 0; i != columns.size(); ++i)
+      {
+        if (kept != 0 && !comp(keys[kept - 1], keys[i])) continue;
+        if (kept != i)
+        {
+          impl::move_assign(keys[kept], keys[i]);
+          impl::move_assign(values[kept], values[i]);
+        }
+        ++kept;
+      }
+      columns.erase(kept, columns.size());
+    }
+
+    // A stream written from an unordered container, or with another
+    // comparator, must be sorted after loading into a sorted container,
+    // and a damaged or crafted one may repeat keys. Streams from a
+    // matching sorted container only pay for the check.
+    template <typename Columns, typename Compare>
+    void sort_unique_columns(Columns& columns, const Compare& comp)
+    {
+      auto const keys = columns.keys();
+      auto const not_ascending = [&comp](const auto& lh, const auto& rh) { return !comp(lh, rh);};
+      if (std::adjacent_find(keys, keys + columns.size(), not_ascending) == keys + columns.size()) return;
+      impl::sort_columns<true>(columns.size(), keys, comp, keys, columns.values());
+      unique_columns(columns, comp);
+    }
+  }
+}
+
+template <typename Key, typename Value>
+void save(std::ostream& os, const unordered_flatmap<Key, Value>& map)
+{
+  serialization::detail::save_pairs<Key, Value>(os, impl::storage_access::values(map));
+}
+
+template <typename Key, typename Value>
+void load(std::istream& is, unordered_flatmap<Key, Value>& map)
+{
+  serialization::detail::load_pairs<Key, Value>(is, impl::storage_access::values(map));
+}
+
+template <typename Key, typename Value, typename Compare>
+void save(std::ostream& os, const flatmap<Key, Value, Compare>& map)
+{
+  serialization::detail::save_pairs<Key, Value>(os, impl::storage_access::values(map));
+}
+
+template <typename Key, typename Value, typename Compare>
+void load(std::istream& is, flatmap<Key, Value, Compare>& map)
+{
+  auto& values = impl::storage_access::values(map);
+  serialization::detail::load_pairs<Key, Value>(is, values);
+  auto& comp = impl::storage_access::compare(map);
+  auto key_compare = [&comp](auto& lh, auto& rh) { return comp(lh.first, rh.first);};
+  auto not_ascending = [&comp](auto& lh, auto& rh) { return !comp(lh.first, rh.first);};
+  if (std::adjacent_find(values.begin(), values.end(), not_ascending) == values.end()) return;
+  impl::sort_columns<true>(values.size(), values.data(), key_compare, values.data());
+  values.erase(std::unique(values.begin(), values.end(), not_ascending), values.end());
+}
+
+template <typename Key, typename Value>
+void save(std::ostream& os, const unordered_split_flatmap<Key, Value>& map)
+{
+  serialization::detail::save_columns<Key, Value>(os, impl::storage_access::columns(map));
+}
+
+template <typename Key, typename Value>
+void load(std::istream& is, unordered_split_flatmap<Key, Value>& map)
+{
+  serialization::detail::load_columns<Key, Value>(is, impl::storage_access::columns(map));
+}
+
+template <typename Key, typename Value, typename Compare>
+void save(std::ostream& os, const split_flatmap<Key, Value, Compare>& map)
+{
+  serialization::detail::save_columns<Key, Value>(os, impl::storage_access::columns(map));
+}
+
+template <typename Key, typename Value, typename Compare>
+void load(std::istream& is, split_flatmap<Key, Value, Compare>& map)
+{
+  auto& columns = impl::storage_access::columns(map);
+  serialization::detail::load_columns<Key, Value>(is, columns);
+  serialization::detail::sort_unique_columns(columns, impl::storage_access::compare(map));
+}
+
+#endif //FLATMAP_FLATMAP_SERIALIZATION_HPP
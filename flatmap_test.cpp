@@ -1,9 +1,31 @@
 #include "flatmap.hpp"
+#include "mapped_flatmap.hpp"
+#include "flatmap_serialization.hpp"
+#include "logged_flatmap.hpp"
+#include "slot_flatmap.hpp"
+#include "chunked_flatmap.hpp"
+#include "lazy_erase_flatmap.hpp"
+#include "flatmap_parallel.hpp"
 #define CATCH_CONFIG_MAIN
 #include <catch.hpp>
 #include <memory>
 #include <string>
 #include <utility>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cstdlib>
+#include <new>
+#include <string_view>
+#include <cstdint>
+#include <stdexcept>
+#include <map>
+#include <random>
+#include <algorithm>
+#include <iterator>
+#include <atomic>
+#include <numeric>
 
 using namespace std::string_literals;
 
@@ -15,8 +37,43 @@ namespace {
 
   template <typename T>
   void as_const(T&& t) = delete;
+
+  // Atomic, since parallel_build allocates on several threads.
+  std::atomic<std::size_t> allocations{0};
+
+  // The number of heap allocations made by f, to lock in that an
+  // operation does not allocate.
+  template <typename F>
+  std::size_t allocations_during(F&& f)
+  {
+    std::size_t const before = allocations;
+    std::forward<F>(f)();
+    return allocations - before;
+  }
+}
+
+void* operator new(std::size_t size)
+{
+  ++allocations;
+  if (auto p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
 }
 
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+  ++allocations;
+  return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size) { return operator new(size);}
+void* operator new[](std::size_t size, const std::nothrow_t& nt) noexcept { return operator new(size, nt);}
+void operator delete(void* p) noexcept { std::free(p);}
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p);}
+void operator delete(void* p, std::size_t) noexcept { std::free(p);}
+void operator delete[](void* p) noexcept { std::free(p);}
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p);}
+void operator delete[](void* p, std::size_t) noexcept { std::free(p);}
+
 TEST_CASE("a default constructed unordered_flatmap is empty")
 {
   unordered_flatmap<int, std::unique_ptr<int>> map;
@@ -911,6 +968,259 @@ TEST_CASE("a flatmap is constructible from iterators of compatible types")
   REQUIRE(map["two"] == 2);
   REQUIRE(map["three"] == 3);
 }
+
+TEST_CASE("lower_bound and upper_bound on a flatmap find the first element not less than and greater than a key")
+{
+  flatmap<int, int> map{{1, -1}, {3, -3}, {5, -5}};
+  REQUIRE(map.lower_bound(0)->first == 1);
+  REQUIRE(map.lower_bound(3)->first == 3);
+  REQUIRE(map.lower_bound(4)->first == 5);
+  REQUIRE(map.lower_bound(6) == map.end());
+  REQUIRE(map.upper_bound(3)->first == 5);
+  REQUIRE(as_const(map).upper_bound(2)->first == 3);
+  REQUIRE(as_const(map).upper_bound(5) == map.cend());
+}
+
+TEST_CASE("equal_range on a flatmap returns a one element range for a known key and an empty range otherwise")
+{
+  flatmap<std::string, int> map{{"one", 1}, {"two", 2}, {"three", 3}};
+  {
+    auto [b, e] = map.equal_range("three");
+    REQUIRE(b->first == "three");
+    REQUIRE(++b == e);
+  }
+  {
+    auto [b, e] = as_const(map).equal_range("four");
+    REQUIRE(b == e);
+    REQUIRE(b->first == "one");
+  }
+}
+
+TEST_CASE("range on a flatmap with compatible keys visits the half open interval in sorted order")
+{
+  flatmap<std::string, int> map{{"a", 1}, {"b", 2}, {"c", 3}, {"d", 4}, {"e", 5}};
+  std::string keys;
+  for (auto&& x : map.range("b", "d"))
+  {
+    keys += x.first;
+  }
+  REQUIRE(keys == "bc");
+  REQUIRE(as_const(map).range("bb", "c").empty());
+  REQUIRE(map.range("d", "b").empty());
+}
+
+TEST_CASE("scan_ranges on a flatmap calls the function with the subrange of each sorted interval")
+{
+  flatmap<int, int> map;
+  for (int i = 0; i != 100; ++i)
+  {
+    map.insert({i * 2, i});
+  }
+  std::pair<int, int> intervals[] { {-5, 1}, {3, 9}, {7, 8}, {150, 160}, {197, 500}, {600, 700}};
+  std::vector<std::vector<int>> found;
+  as_const(map).scan_ranges(std::begin(intervals), std::end(intervals), [&](auto r) {
+    found.emplace_back();
+    for (auto&& x : r) found.back().push_back(x.first);
+  });
+  std::vector<std::vector<int>> expected{ {0}, {4, 6, 8}, {}, {150, 152, 154, 156, 158}, {198}, {}};
+  REQUIRE(found == expected);
+  map.scan_ranges(std::begin(intervals), std::end(intervals), [](auto r) {
+    for (auto&& x : r) x.second = -1;
+  });
+  REQUIRE(map[6] == -1);
+  REQUIRE(map[10] == 5);
+}
+
+TEST_CASE("prefix_range on a flatmap with string keys returns all elements starting with the prefix")
+{
+  flatmap<std::string, int> map{
+    {"/usr/bin/ls", 1},
+    {"/usr/lib", 2},
+    {"/usr/lib/libc.so", 3},
+    {"/usr/lib/x86_64/libm.so", 4},
+    {"/usr/lib0", 5},
+    {"/usr/libexec/cc1", 6},
+    {"/var/lib/dpkg", 7}
+  };
+  std::vector<int> found;
+  for (auto&& x : map.prefix_range("/usr/lib/"))
+  {
+    found.push_back(x.second);
+  }
+  REQUIRE(found == std::vector<int>{3, 4});
+  found.clear();
+  for (auto&& x : as_const(map).prefix_range("/usr/lib"))
+  {
+    found.push_back(x.second);
+  }
+  REQUIRE(found == std::vector<int>{2, 3, 4, 5, 6});
+  REQUIRE(map.prefix_range("/opt").empty());
+  REQUIRE(map.prefix_range("/z").empty());
+  REQUIRE(std::distance(map.prefix_range("").begin(), map.prefix_range("").end()) == 7);
+}
+
+namespace {
+  template <typename Map>
+  using prefix_range_t = decltype(std::declval<Map&>().prefix_range(std::string_view{}));
+
+  template <typename Map>
+  using has_prefix_range = std::experimental::is_detected<prefix_range_t, Map>;
+}
+
+TEST_CASE("prefix_range is only offered for string keys ordered by character")
+{
+  static_assert(has_prefix_range<flatmap<std::string, int>>{});
+  static_assert(has_prefix_range<split_flatmap<std::string_view, int>>{});
+  // std::less orders pointers by address, not by the characters.
+  static_assert(!type_traits::is_lexicographic<std::less<>, const char*>{});
+  static_assert(!has_prefix_range<flatmap<const char*, int>>{});
+  static_assert(!has_prefix_range<split_flatmap<const char*, int, std::less<const char*>>>{});
+  static_assert(!has_prefix_range<flatmap<std::string, int, std::greater<>>>{});
+}
+
+namespace {
+  struct counted_move
+  {
+    static inline std::size_t moves = 0;
+    counted_move(int v) : value(v) {}
+    counted_move(counted_move&& rh) noexcept : value(rh.value) { ++moves;}
+    counted_move& operator=(counted_move&& rh) noexcept { value = rh.value; ++moves; return *this;}
+    int value;
+  };
+  struct relocated_move : counted_move
+  {
+    using counted_move::counted_move;
+  };
+}
+
+template <>
+struct type_traits::is_trivially_relocatable<relocated_move> : std::true_type {};
+
+TEST_CASE("is_trivially_relocatable holds for trivially copyable types, smart pointers and specializations")
+{
+  static_assert(type_traits::is_trivially_relocatable<int>{});
+  static_assert(type_traits::is_trivially_relocatable<std::pair<int, double>>{});
+  static_assert(type_traits::is_trivially_relocatable<std::pair<std::unique_ptr<int>, std::shared_ptr<int>>>{});
+  static_assert(!type_traits::is_trivially_relocatable<counted_move>{});
+  static_assert(type_traits::is_trivially_relocatable<std::pair<int, relocated_move>>{});
+}
+
+TEST_CASE("a flatmap shifts trivially relocatable values without moving them one by one")
+{
+  auto const moves_inserting = [](auto map) {
+    counted_move::moves = 0;
+    for (int i = 64; i != 0; --i)
+    {
+      map.try_emplace(i, i);
+    }
+    int expected = 1;
+    for (auto& x : map)
+    {
+      REQUIRE(x.first == expected);
+      REQUIRE(x.second.value == expected++);
+    }
+    return counted_move::moves;
+  };
+  REQUIRE(moves_inserting(flatmap<int, counted_move>{}) > 64U * 63U / 2U);
+  REQUIRE(moves_inserting(flatmap<int, relocated_move>{}) <= 64U * 2U);
+}
+
+namespace {
+  // Move construction cannot throw, but move assignment may, as for a
+  // type with a user provided assignment.
+  struct assign_may_throw
+  {
+    assign_may_throw(int v) : value(v) {}
+    assign_may_throw(assign_may_throw&& rh) noexcept : value(rh.value) {}
+    assign_may_throw(const assign_may_throw&) = default;
+    assign_may_throw& operator=(const assign_may_throw&) = default;
+    assign_may_throw& operator=(assign_may_throw&& rh) { value = rh.value; return *this;}
+    int value;
+  };
+
+  template <typename Map>
+  void check_assign_may_throw()
+  {
+    static_assert(!std::is_nothrow_move_assignable<assign_may_throw>{});
+    Map map;
+    for (int i = 0; i != 20; ++i)
+    {
+      map.insert({(i * 7) % 20, assign_may_throw((i * 7) % 20)});
+    }
+    map.erase(3);
+    map.erase(std::next(map.begin(), 2), std::next(map.begin(), 5));
+    erase_if(map, [](auto&& x) { return x.second.value % 4 == 1;});
+    std::vector<std::pair<int, assign_may_throw>> more{{30, 30}, {-1, -1}};
+    map.insert_many(more.begin(), more.end());
+    std::vector<int> keys;
+    for (auto&& x : map)
+    {
+      REQUIRE(x.second.value == x.first);
+      keys.push_back(x.first);
+    }
+    REQUIRE(keys == std::vector<int>{-1, 0, 6, 7, 8, 10, 11, 12, 14, 15, 16, 18, 19, 30});
+  }
+}
+
+TEST_CASE("the maps only need move construction of keys and values not to throw")
+{
+  check_assign_may_throw<flatmap<int, assign_may_throw>>();
+  check_assign_may_throw<split_flatmap<int, assign_may_throw>>();
+  unordered_split_flatmap<int, assign_may_throw> unordered;
+  for (int i = 0; i != 10; ++i)
+  {
+    unordered.insert({i, i});
+  }
+  unordered.erase(4);
+  REQUIRE(unordered.size() == 9U);
+}
+
+TEST_CASE("tuned_lower_bound finds the same position searching linearly as bisecting")
+{
+  std::vector<int> const keys{1, 3, 3, 5, 8, 13, 21};
+  for (int t = 0; t != 23; ++t)
+  {
+    auto const linear = impl::tuned_lower_bound(keys.begin(), keys.end(), t, std::less<>{}, keys.size());
+    auto const bisect = impl::tuned_lower_bound(keys.begin(), keys.end(), t, std::less<>{}, 0);
+    REQUIRE(linear == std::lower_bound(keys.begin(), keys.end(), t));
+    REQUIRE(bisect == linear);
+  }
+  std::vector<int> const descending{21, 13, 8, 5, 3, 1};
+  auto const i = impl::tuned_lower_bound(descending.begin(), descending.end(), 4, std::greater<>{}, descending.size());
+  REQUIRE(*i == 3);
+}
+TEST_CASE("the simd kernels find the same positions at every supported instruction set")
+{
+  std::vector<std::int32_t> keys32;
+  std::vector<std::int64_t> keys64;
+  for (int i = 0; i != 70; ++i)
+  {
+    keys32.push_back(i * 3 - 50);
+    keys64.push_back((std::int64_t{i} << 33) - 7);
+  }
+  std::vector<std::uint32_t> const unsigned32(keys32.begin(), keys32.end());
+  auto const best = simd::detected();
+  for (int level = 0; level <= static_cast<int>(best); ++level)
+  {
+    REQUIRE(simd::force(static_cast<simd::isa>(level)) == static_cast<simd::isa>(level));
+    for (std::size_t n = 0; n != keys32.size(); ++n)
+    {
+      for (std::size_t k = 0; k != n + 1; ++k)
+      {
+        auto const t32 = k < n ? keys32[k] : std::int32_t{1000};
+        auto const t64 = k < n ? keys64[k] : -(std::int64_t{1} << 40);
+        auto const u32 = k < n ? unsigned32[k] : std::uint32_t{0x80000000};
+        REQUIRE(simd::find_equal(keys32.data(), n, t32) == k);
+        REQUIRE(simd::find_equal(keys64.data(), n, t64) == (k < n ? k : n));
+        REQUIRE(simd::find_equal(unsigned32.data(), n, u32) == k);
+        REQUIRE(simd::count_less(keys32.data(), n, t32) == k);
+        REQUIRE(simd::count_less(keys32.data(), n, t32 + 1) == std::min(k + 1, n));
+        REQUIRE(simd::count_less(keys64.data(), n, t64) == (k < n ? k : 0));
+      }
+    }
+  }
+  simd::force(best);
+}
 ////
 
 TEST_CASE("a default constructed split_flatmap is empty")
@@ -1266,3 +1576,1183 @@ TEST_CASE("a split_flatmap is constructible from iterators of compatible types")
   REQUIRE(map["two"] == 2);
   REQUIRE(map["three"] == 3);
 }
+
+TEST_CASE("lower_bound and upper_bound on a split_flatmap find the first element not less than and greater than a key")
+{
+  split_flatmap<int, int> map{{1, -1}, {3, -3}, {5, -5}};
+  REQUIRE(map.lower_bound(0)->first == 1);
+  REQUIRE(map.lower_bound(3)->first == 3);
+  REQUIRE(map.lower_bound(4)->first == 5);
+  REQUIRE(map.lower_bound(6) == map.end());
+  REQUIRE(map.upper_bound(3)->first == 5);
+  REQUIRE(as_const(map).upper_bound(2)->first == 3);
+  REQUIRE(as_const(map).upper_bound(5) == map.cend());
+}
+
+TEST_CASE("equal_range on a split_flatmap returns a one element range for a known key and an empty range otherwise")
+{
+  split_flatmap<std::string, int> map{{"one", 1}, {"two", 2}, {"three", 3}};
+  {
+    auto [b, e] = map.equal_range("three");
+    REQUIRE(b->first == "three");
+    REQUIRE(++b == e);
+  }
+  {
+    auto [b, e] = as_const(map).equal_range("four");
+    REQUIRE(b == e);
+    REQUIRE(b->first == "one");
+  }
+}
+
+TEST_CASE("range on a split_flatmap with compatible keys visits the half open interval in sorted order")
+{
+  split_flatmap<std::string, int> map{{"a", 1}, {"b", 2}, {"c", 3}, {"d", 4}, {"e", 5}};
+  std::string keys;
+  for (auto&& x : map.range("b", "d"))
+  {
+    keys += x.first;
+  }
+  REQUIRE(keys == "bc");
+  REQUIRE(as_const(map).range("bb", "c").empty());
+  REQUIRE(map.range("d", "b").empty());
+}
+
+TEST_CASE("scan_ranges on a split_flatmap calls the function with the subrange of each sorted interval")
+{
+  split_flatmap<int, int> map;
+  for (int i = 0; i != 100; ++i)
+  {
+    map.insert({i * 2, i});
+  }
+  std::pair<int, int> intervals[] { {-5, 1}, {3, 9}, {7, 8}, {150, 160}, {197, 500}, {600, 700}};
+  std::vector<std::vector<int>> found;
+  as_const(map).scan_ranges(std::begin(intervals), std::end(intervals), [&](auto r) {
+    found.emplace_back();
+    for (auto&& x : r) found.back().push_back(x.first);
+  });
+  std::vector<std::vector<int>> expected{ {0}, {4, 6, 8}, {}, {150, 152, 154, 156, 158}, {198}, {}};
+  REQUIRE(found == expected);
+  map.scan_ranges(std::begin(intervals), std::end(intervals), [](auto r) {
+    for (auto&& x : r) x.second = -1;
+  });
+  REQUIRE(map[6] == -1);
+  REQUIRE(map[10] == 5);
+}
+
+TEST_CASE("prefix_range on a split_flatmap with string keys returns all elements starting with the prefix")
+{
+  split_flatmap<std::string, int> map{
+    {"/usr/bin/ls", 1},
+    {"/usr/lib", 2},
+    {"/usr/lib/libc.so", 3},
+    {"/usr/lib/x86_64/libm.so", 4},
+    {"/usr/lib0", 5},
+    {"/usr/libexec/cc1", 6},
+    {"/var/lib/dpkg", 7}
+  };
+  std::vector<int> found;
+  for (auto&& x : map.prefix_range("/usr/lib/"))
+  {
+    found.push_back(x.second);
+  }
+  REQUIRE(found == std::vector<int>{3, 4});
+  found.clear();
+  for (auto&& x : as_const(map).prefix_range("/usr/lib"))
+  {
+    found.push_back(x.second);
+  }
+  REQUIRE(found == std::vector<int>{2, 3, 4, 5, 6});
+  REQUIRE(map.prefix_range("/opt").empty());
+  REQUIRE(map.prefix_range("/z").empty());
+  REQUIRE(std::distance(map.prefix_range("").begin(), map.prefix_range("").end()) == 7);
+}
+
+namespace {
+  struct throws_if_negative
+  {
+    throws_if_negative(int v) : value(v) { if (v < 0) throw std::invalid_argument("negative");}
+    int value;
+  };
+}
+
+TEST_CASE("a split_flatmap is unchanged when constructing an inserted value throws, with or without growing")
+{
+  split_flatmap<int, throws_if_negative> map;
+  map.try_emplace(1, 1);
+  map.try_emplace(3, 3);
+  REQUIRE_THROWS_AS(map.try_emplace(2, -2), std::invalid_argument);
+  map.try_emplace(5, 5);
+  REQUIRE_THROWS_AS(map.try_emplace(4, -4), std::invalid_argument);
+  std::vector<std::pair<int, int>> elements;
+  for (auto&& x : map)
+  {
+    elements.emplace_back(x.first, x.second.value);
+  }
+  REQUIRE(elements == std::vector<std::pair<int, int>>{{1, 1}, {3, 3}, {5, 5}});
+}
+
+TEST_CASE("the key and value columns of a split_flatmap each start on a cache line")
+{
+  split_flatmap<char, short> map{{'a', 1}, {'b', 2}, {'c', 3}};
+  auto const address = [](auto& x) { return reinterpret_cast<std::uintptr_t>(std::addressof(x));};
+  REQUIRE(address(map.begin()->first) % 64 == 0);
+  REQUIRE(address(map.begin()->second) % 64 == 0);
+  REQUIRE(address(std::next(map.begin())->first) == address(map.begin()->first) + 1);
+}
+
+////
+
+namespace {
+  struct record
+  {
+    std::uint64_t id;
+    double        weight;
+    char          tag[4];
+  };
+
+  struct temp_file
+  {
+    ~temp_file() { std::remove(name.c_str()); }
+    std::string name = "flatmap_test_image.bin";
+  };
+}
+
+TEST_CASE("a mapped_flatmap serves find, count and ordered iteration from an image of a split_flatmap")
+{
+  split_flatmap<std::uint64_t, record> map;
+  for (std::uint64_t i = 0; i != 1000; ++i)
+  {
+    auto key = (i * 7919) % 1000;
+    map.insert({key, record{key, double(key) / 2, {'r', 'e', 'c', '\0'}}});
+  }
+  temp_file file;
+  flatmap_image::write(file.name, map);
+  mapped_flatmap<std::uint64_t, record> mapped(file.name);
+  REQUIRE(mapped.size() == 1000U);
+  REQUIRE(!mapped.empty());
+  REQUIRE(mapped.count(17U) == 1U);
+  REQUIRE(mapped.count(1000U) == 0U);
+  auto i = mapped.find(500U);
+  REQUIRE(i != mapped.end());
+  REQUIRE(i->first == 500U);
+  REQUIRE(i->second.weight == 250.0);
+  REQUIRE(std::string(i->second.tag) == "rec");
+  REQUIRE(std::equal(mapped.begin(), mapped.end(), map.begin(), map.end(),
+                     [](auto&& lh, auto&& rh) { return lh.first == rh.first && lh.second.id == rh.second.id;}));
+}
+
+TEST_CASE("an empty flatmap round trips through an image")
+{
+  flatmap<int, int> map;
+  temp_file file;
+  flatmap_image::write(file.name, map);
+  mapped_flatmap<int, int> mapped(file.name);
+  REQUIRE(mapped.empty());
+  REQUIRE(mapped.begin() == mapped.end());
+  REQUIRE(mapped.find(1) == mapped.end());
+}
+
+TEST_CASE("a mapped_flatmap refuses an image with a different version or value type")
+{
+  flatmap<int, int> map{{1, 1}, {2, 2}};
+  temp_file file;
+  flatmap_image::write(file.name, map);
+  REQUIRE_THROWS(mapped_flatmap<int, double>(file.name));
+  {
+    std::fstream f(file.name, std::ios::binary | std::ios::in | std::ios::out);
+    std::uint32_t version = flatmap_image::version + 1;
+    f.seekp(offsetof(flatmap_image::header, version));
+    f.write(reinterpret_cast<const char*>(&version), sizeof(version));
+  }
+  REQUIRE_THROWS(mapped_flatmap<int, int>(file.name));
+  REQUIRE_THROWS(mapped_flatmap<int, int>("no_such_flatmap_image.bin"));
+}
+
+TEST_CASE("a mapped_flatmap refuses an image whose count makes the column offsets wrap around")
+{
+  flatmap<int, int> map{{1, 1}, {2, 2}, {3, 3}};
+  temp_file file;
+  flatmap_image::write(file.name, map);
+  {
+    // count * sizeof(int) wraps to the real column size, so every offset
+    // computed from the count matches the file.
+    std::fstream f(file.name, std::ios::binary | std::ios::in | std::ios::out);
+    std::uint64_t count = map.size() + (std::uint64_t{1} << 62);
+    f.seekp(offsetof(flatmap_image::header, count));
+    f.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  }
+  REQUIRE_THROWS_AS((mapped_flatmap<int, int>(file.name)), std::runtime_error);
+}
+
+////
+
+namespace {
+  template <typename A, typename B>
+  bool same_elements(const A& a, const B& b)
+  {
+    return std::equal(std::begin(a), std::end(a), std::begin(b), std::end(b),
+                      [](auto&& lh, auto&& rh) { return lh.first == rh.first && lh.second == rh.second;});
+  }
+}
+
+TEST_CASE("a flatmap with string keys and values round trips through save and load")
+{
+  flatmap<std::string, std::string> map{{"one", "1"}, {"two", ""}, {"three", std::string(1000, '3')}};
+  std::stringstream stream;
+  save(stream, map);
+  flatmap<std::string, std::string> loaded{{"four", "4"}};
+  load(stream, loaded);
+  REQUIRE(loaded.size() == 3U);
+  REQUIRE(same_elements(map, loaded));
+  REQUIRE(loaded.count("four") == 0U);
+}
+
+TEST_CASE("a split_flatmap with integer keys round trips through save and load")
+{
+  split_flatmap<int, double> map;
+  for (int i = 0; i != 5000; ++i)
+  {
+    map.insert({(i * 7919) % 5000, i / 2.0});
+  }
+  std::stringstream stream;
+  save(stream, map);
+  split_flatmap<int, double> loaded;
+  load(stream, loaded);
+  REQUIRE(loaded.size() == 5000U);
+  REQUIRE(same_elements(map, loaded));
+}
+
+TEST_CASE("unordered maps round trip through save and load preserving element order")
+{
+  unordered_flatmap<int, std::string> map{{3, "three"}, {1, "one"}, {2, "two"}};
+  unordered_split_flatmap<std::string, int> split_map{{"three", 3}, {"one", 1}, {"two", 2}};
+  std::stringstream stream;
+  save(stream, map);
+  save(stream, split_map);
+  unordered_flatmap<int, std::string> loaded;
+  unordered_split_flatmap<std::string, int> split_loaded;
+  load(stream, loaded);
+  load(stream, split_loaded);
+  REQUIRE(same_elements(map, loaded));
+  REQUIRE(same_elements(split_map, split_loaded));
+}
+
+TEST_CASE("loading a stream saved from an unordered map into a sorted map sorts the elements")
+{
+  unordered_split_flatmap<std::string, int> map{{"three", 3}, {"one", 1}, {"two", 2}};
+  std::stringstream stream;
+  save(stream, map);
+  save(stream, map);
+  flatmap<std::string, int> loaded;
+  split_flatmap<std::string, int, std::greater<>> split_loaded;
+  load(stream, loaded);
+  load(stream, split_loaded);
+  std::vector<std::pair<const std::string, int>> expected{{"one", 1}, {"three", 3}, {"two", 2}};
+  REQUIRE(same_elements(loaded, expected));
+  REQUIRE(same_elements(split_loaded, std::vector<std::pair<std::string, int>>(expected.rbegin(), expected.rend())));
+  REQUIRE(split_loaded["two"] == 2);
+}
+
+TEST_CASE("load from a stream with mismatching types or truncated data throws and leaves the map empty")
+{
+  flatmap<int, std::string> map{{1, "one"}, {2, "two"}};
+  std::stringstream stream;
+  save(stream, map);
+  auto const data = stream.str();
+  {
+    std::stringstream in(data);
+    flatmap<int, int> loaded;
+    REQUIRE_THROWS(load(in, loaded));
+  }
+  {
+    std::stringstream in(data.substr(0, data.size() - 2));
+    flatmap<int, std::string> loaded{{3, "three"}};
+    REQUIRE_THROWS(load(in, loaded));
+    REQUIRE(loaded.empty());
+  }
+}
+
+TEST_CASE("load refuses counts and lengths that the stream does not back with data, without allocating for them")
+{
+  auto const huge = std::uint64_t{1} << 40;
+  {
+    std::stringstream in;
+    serialization::detail::write_header<int, std::string>(in, huge);
+    serialization::detail::write_raw(in, 1);
+    flatmap<int, std::string> loaded;
+    REQUIRE_THROWS_AS(load(in, loaded), std::runtime_error);
+    REQUIRE(loaded.empty());
+  }
+  {
+    std::stringstream in;
+    serialization::detail::write_header<std::string, int>(in, huge);
+    serialization::detail::write_raw(in, std::uint64_t{3});
+    split_flatmap<std::string, int> loaded;
+    REQUIRE_THROWS_AS(load(in, loaded), std::runtime_error);
+    REQUIRE(loaded.empty());
+  }
+  {
+    std::stringstream in;
+    serialization::detail::write_header<int, std::string>(in, 1);
+    serialization::detail::write_raw(in, 1);
+    serialization::detail::write_raw(in, huge << 10);
+    in << "abc";
+    unordered_flatmap<int, std::string> loaded;
+    REQUIRE_THROWS_AS(load(in, loaded), std::runtime_error);
+    REQUIRE(loaded.empty());
+  }
+}
+
+TEST_CASE("loading a stream with repeated keys into a sorted map keeps the first of each")
+{
+  std::stringstream stream;
+  serialization::detail::write_header<int, int>(stream, 5);
+  for (int k : { 3, 1, 3, 2, 1 }) serialization::detail::write_raw(stream, k);
+  for (int v : { 30, 10, 31, 20, 11 }) serialization::detail::write_raw(stream, v);
+  auto const data = stream.str();
+  std::vector<std::pair<const int, int>> expected{{1, 10}, {2, 20}, {3, 30}};
+  {
+    std::stringstream in(data);
+    flatmap<int, int> loaded;
+    load(in, loaded);
+    REQUIRE(same_elements(loaded, expected));
+  }
+  {
+    std::stringstream in(data);
+    split_flatmap<int, int> loaded;
+    load(in, loaded);
+    REQUIRE(same_elements(loaded, expected));
+  }
+}
+
+////
+
+namespace {
+  struct temp_store
+  {
+    ~temp_store()
+    {
+      std::remove(checkpoint.c_str());
+      std::remove(log.c_str());
+    }
+    std::string checkpoint = "flatmap_test_checkpoint.bin";
+    std::string log = "flatmap_test_log.bin";
+    logged_flatmap_options options{ 64, false };
+  };
+}
+
+TEST_CASE("a logged_flatmap recovers inserts, assignments and erases from its log")
+{
+  temp_store store;
+  {
+    logged_flatmap<std::string, std::string> map(store.checkpoint, store.log, store.options);
+    REQUIRE(map.insert({"one", "1"}).second);
+    REQUIRE(!map.insert({"one", "uno"}).second);
+    REQUIRE(map.insert({"two", "2"}).second);
+    REQUIRE(map.insert({"three", "3"}).second);
+    REQUIRE(!map.insert_or_assign("two", "II").second);
+    REQUIRE(map.erase("three") == 1U);
+    REQUIRE(map.erase("four") == 0U);
+    REQUIRE(map.insert_or_assign("four", "4").second);
+  }
+  logged_flatmap<std::string, std::string> recovered(store.checkpoint, store.log, store.options);
+  flatmap<std::string, std::string> expected{{"one", "1"}, {"two", "II"}, {"four", "4"}};
+  REQUIRE(same_elements(recovered, expected));
+}
+
+TEST_CASE("a logged_flatmap recovers from a checkpoint followed by a log")
+{
+  temp_store store;
+  {
+    logged_flatmap<int, int> map(store.checkpoint, store.log, store.options);
+    auto const header_size = std::ifstream(store.log, std::ios::ate).tellg();
+    for (int i = 0; i != 100; ++i)
+    {
+      map.insert({i, i});
+    }
+    map.checkpoint();
+    REQUIRE(std::ifstream(store.log, std::ios::ate).tellg() == header_size);
+    for (int i = 0; i != 100; i += 2)
+    {
+      map.erase(i);
+    }
+    map.insert_or_assign(1, -1);
+    map.insert_or_assign(200, 200);
+  }
+  logged_flatmap<int, int> recovered(store.checkpoint, store.log, store.options);
+  REQUIRE(recovered.size() == 51U);
+  REQUIRE(recovered.count(2) == 0U);
+  REQUIRE(recovered.find(1)->second == -1);
+  REQUIRE(recovered.find(99)->second == 99);
+  REQUIRE(recovered.find(200)->second == 200);
+}
+
+TEST_CASE("a torn record at the end of the log of a logged_flatmap is discarded")
+{
+  temp_store store;
+  {
+    logged_flatmap<int, int> map(store.checkpoint, store.log, store.options);
+    map.insert({1, 1});
+    map.insert({2, 2});
+  }
+  {
+    std::ofstream log(store.log, std::ios::binary | std::ios::app);
+    log.write("\x01\x03\x00", 3);
+  }
+  {
+    logged_flatmap<int, int> recovered(store.checkpoint, store.log, store.options);
+    REQUIRE(recovered.size() == 2U);
+    recovered.insert({3, 3});
+  }
+  logged_flatmap<int, int> recovered(store.checkpoint, store.log, store.options);
+  REQUIRE(recovered.size() == 3U);
+  REQUIRE(recovered.count(3) == 1U);
+}
+
+TEST_CASE("a logged_flatmap refuses a log that is not its own, rather than replaying it")
+{
+  temp_store store;
+  {
+    logged_flatmap<int, int> map(store.checkpoint, store.log, store.options);
+    map.insert({1, 1});
+  }
+  REQUIRE_THROWS_AS((logged_flatmap<std::string, int>(store.checkpoint, store.log, store.options)), std::runtime_error);
+  {
+    std::ofstream log(store.log, std::ios::binary | std::ios::trunc);
+    log << "\x01 not a log at all";
+  }
+  REQUIRE_THROWS_AS((logged_flatmap<int, int>(store.checkpoint, store.log, store.options)), std::runtime_error);
+  {
+    // a header torn right after the log was created
+    std::ofstream log(store.log, std::ios::binary | std::ios::trunc);
+    log.write("FLM", 3);
+  }
+  logged_flatmap<int, int> map(store.checkpoint, store.log, store.options);
+  REQUIRE(map.empty());
+}
+
+////
+
+TEST_CASE("a slot_flatmap iterates its elements in key order")
+{
+  slot_flatmap<int, std::string> map{{3, "three"}, {1, "one"}, {2, "two"}};
+  REQUIRE(!map.insert({2, "deux"}).second);
+  std::vector<std::pair<int, std::string>> elements;
+  for (auto&& x : map)
+  {
+    elements.emplace_back(x.first, x.second);
+  }
+  REQUIRE(elements == std::vector<std::pair<int, std::string>>{{1, "one"}, {2, "two"}, {3, "three"}});
+  REQUIRE(map.lower_bound(2)->second == "two");
+  REQUIRE(map.upper_bound(2)->second == "three");
+  REQUIRE(map.count(4) == 0U);
+}
+
+TEST_CASE("references to the values of a slot_flatmap survive inserts and erases of other elements")
+{
+  slot_flatmap<int, std::string> map;
+  auto& kept = map[401];
+  kept = "a value too long for the small string buffer";
+  for (int i = 0; i != 1000; ++i)
+  {
+    map.try_emplace(i, std::to_string(i));
+  }
+  for (int i = 0; i != 1000; i += 2)
+  {
+    REQUIRE(map.erase(i) == 1U);
+  }
+  map.insert_or_assign(1001, "reuses an erased slot");
+  REQUIRE(&map.find(401)->second == &kept);
+  REQUIRE(kept == "a value too long for the small string buffer");
+  REQUIRE(map.size() == 501U);
+}
+
+TEST_CASE("a slot_flatmap is unchanged when constructing an inserted value throws, and copies keep all values")
+{
+  slot_flatmap<int, throws_if_negative> map;
+  map.try_emplace(1, 1);
+  map.try_emplace(3, 3);
+  REQUIRE_THROWS_AS(map.try_emplace(2, -2), std::invalid_argument);
+  map.try_emplace(5, 5);
+  auto copy = map;
+  map.clear();
+  REQUIRE(map.empty());
+  std::vector<std::pair<int, int>> elements;
+  for (auto&& x : as_const(copy))
+  {
+    elements.emplace_back(x.first, x.second.value);
+  }
+  REQUIRE(elements == std::vector<std::pair<int, int>>{{1, 1}, {3, 3}, {5, 5}});
+}
+
+////
+
+TEST_CASE("a chunked_flatmap holds the same elements as a std::map through random inserts and erases")
+{
+  chunked_flatmap<int, int, std::less<>, 8> map;
+  std::map<int, int> reference;
+  std::mt19937 gen(1);
+  for (int round = 0; round != 4000; ++round)
+  {
+    auto const key = static_cast<int>(gen() % 200);
+    if (round % 1000 < 600)
+    {
+      REQUIRE(map.insert({key, round}).second == reference.insert({key, round}).second);
+    }
+    else
+    {
+      REQUIRE(map.erase(key) == reference.erase(key));
+    }
+    REQUIRE(map.size() == reference.size());
+  }
+  REQUIRE(std::equal(map.begin(), map.end(), reference.begin(), reference.end()));
+  REQUIRE(std::equal(std::make_reverse_iterator(map.end()), std::make_reverse_iterator(map.begin()),
+                     reference.rbegin(), reference.rend()));
+  for (int key = -1; key != 201; ++key)
+  {
+    REQUIRE(map.count(key) == reference.count(key));
+    auto const lower = map.lower_bound(key);
+    auto const expected = reference.lower_bound(key);
+    REQUIRE((lower == map.end()) == (expected == reference.end()));
+    if (expected != reference.end()) REQUIRE(lower->first == expected->first);
+    auto const upper = map.upper_bound(key);
+    REQUIRE(std::distance(map.begin(), upper) == std::distance(reference.begin(), reference.upper_bound(key)));
+  }
+  auto copy = map;
+  for (auto& x : reference)
+  {
+    REQUIRE(copy.erase(x.first) == 1U);
+    REQUIRE(std::distance(copy.begin(), copy.end()) == static_cast<std::ptrdiff_t>(copy.size()));
+  }
+  REQUIRE(copy.begin() == copy.end());
+  REQUIRE(std::equal(map.begin(), map.end(), reference.begin(), reference.end()));
+}
+
+TEST_CASE("a chunked_flatmap grows its chunk index geometrically, and a copy still merges chunks")
+{
+  chunked_flatmap<int, int, std::less<>, 8> map;
+  // Ascending inserts split about every fourth insert, and each split
+  // allocates one new chunk. Growing the index by one for each split would
+  // add two more allocations per split.
+  auto const inserting = allocations_during([&] {
+    for (int i = 0; i != 4096; ++i)
+    {
+      map.insert({i, i});
+    }
+  });
+  REQUIRE(inserting < 4096 / 4 + 100);
+  auto copy = map;
+  // The chunks of the copy hold exactly their elements, so merging them
+  // has to give them room first.
+  auto const erasing = allocations_during([&] {
+    for (int i = 0; i != 4096; ++i)
+    {
+      if (i % 8 != 0) copy.erase(i);
+    }
+  });
+  REQUIRE(erasing > 0U);
+  REQUIRE(copy.size() == 512U);
+  int expected = 0;
+  for (auto& x : copy)
+  {
+    REQUIRE(x.first == expected);
+    expected += 8;
+  }
+}
+
+TEST_CASE("a chunked_flatmap finds string keys by compatible types, and ranges span chunks")
+{
+  chunked_flatmap<std::string, int, std::less<>, 4> map;
+  for (int i = 0; i != 100; ++i)
+  {
+    map[std::to_string(1000 + i)] = i;
+  }
+  REQUIRE(map.find(std::string_view("1042"))->second == 42);
+  REQUIRE(map.count("1100") == 0U);
+  REQUIRE(map.insert_or_assign("1042", 4242).second == false);
+  REQUIRE(as_const(map).find("1042")->second == 4242);
+  auto r = map.range("1010", "1020");
+  REQUIRE(std::distance(r.begin(), r.end()) == 10);
+  REQUIRE(r.begin()->first == "1010");
+  REQUIRE(map.range("1020", "1010").empty());
+  auto [ b, e ] = map.equal_range("1099");
+  REQUIRE(std::next(b) == e);
+  REQUIRE(e == map.end());
+  map.erase(b);
+  REQUIRE(map.size() == 99U);
+  map.clear();
+  REQUIRE(map.empty());
+  REQUIRE(map.begin() == map.end());
+}
+
+////
+
+namespace {
+  template <typename Map>
+  void check_lazy_erase()
+  {
+    lazy_erase_flatmap<Map> map(lazy_erase_options{0.5});
+    for (int i = 0; i != 10; ++i)
+    {
+      map.insert({i, std::to_string(i)});
+    }
+    REQUIRE(map.erase(3) == 1U);
+    REQUIRE(map.erase(3) == 0U);
+    REQUIRE(map.erase(7) == 1U);
+    REQUIRE(map.tombstones() == 2U);
+    REQUIRE(map.size() == 8U);
+    REQUIRE(map.count(3) == 0U);
+    REQUIRE(map.lower_bound(3)->first == 4);
+    REQUIRE(map.insert_or_assign(5, "five").second == false);
+    REQUIRE(map.insert({-1, "-1"}).second);
+    REQUIRE(map.try_emplace(7, "seven").second);
+    std::vector<int> keys;
+    for (auto&& x : as_const(map))
+    {
+      keys.push_back(x.first);
+    }
+    REQUIRE(keys == std::vector<int>{-1, 0, 1, 2, 4, 5, 6, 7, 8, 9});
+    REQUIRE(map.find(7)->second == "seven");
+    REQUIRE(map.find(5)->second == "five");
+    for (int i = 0; i != 5; ++i)
+    {
+      map.erase(i);
+    }
+    REQUIRE(map.tombstones() == 5U);
+    REQUIRE(map.size() == 6U);
+    REQUIRE(map.begin()->first == -1);
+    map.erase(8);
+    REQUIRE(map.tombstones() == 0U);
+    REQUIRE(map.map().size() == 5U);
+    REQUIRE(map.erase(9) == 1U);
+    REQUIRE(map.map().size() == 4U);
+    REQUIRE(map.tombstones() == 0U);
+  }
+}
+
+TEST_CASE("a lazy_erase_flatmap skips erased elements until it compacts them away")
+{
+  check_lazy_erase<flatmap<int, std::string>>();
+  check_lazy_erase<split_flatmap<int, std::string>>();
+}
+
+TEST_CASE("a lazy_erase_flatmap compacts values that are not default constructible")
+{
+  struct no_default
+  {
+    explicit no_default(int v_) : v{v_} {}
+    int v;
+  };
+  lazy_erase_flatmap<flatmap<int, no_default>> map(lazy_erase_options{0.5});
+  lazy_erase_flatmap<split_flatmap<int, no_default>> split(lazy_erase_options{0.5});
+  for (int i = 0; i != 10; ++i)
+  {
+    map.insert({i, no_default{i}});
+    split.insert({i, no_default{i}});
+  }
+  for (int i = 0; i != 10; i += 2)
+  {
+    map.erase(i);
+    split.erase(i);
+  }
+  REQUIRE(map.tombstones() == 0U);
+  REQUIRE(split.tombstones() == 0U);
+  REQUIRE(map.size() == 5U);
+  REQUIRE(split.size() == 5U);
+  REQUIRE(map.find(7)->second.v == 7);
+  REQUIRE((*split.find(9)).second.v == 9);
+}
+////
+
+namespace {
+  template <typename Map>
+  std::vector<std::pair<int, std::string>> elements(const Map& map)
+  {
+    std::vector<std::pair<int, std::string>> rv;
+    for (auto&& [ k, v ] : map)
+    {
+      rv.emplace_back(k, v);
+    }
+    return rv;
+  }
+
+  template <typename Map>
+  void check_erase_if_and_range_erase()
+  {
+    Map map;
+    for (int i = 0; i != 10; ++i)
+    {
+      map.insert({i, std::to_string(i)});
+    }
+    auto const before = elements(map);
+    REQUIRE(erase_if(map, [](const auto& x) { return x.first > 20;}) == 0U);
+    REQUIRE(elements(map) == before);
+    REQUIRE(erase_if(map, [](const auto& x) { return x.first % 3 == 0 || x.second == "4";}) == 5U);
+    auto expected = before;
+    expected.erase(std::remove_if(expected.begin(), expected.end(),
+                                  [](const auto& x) { return x.first % 3 == 0 || x.first == 4;}),
+                   expected.end());
+    REQUIRE(elements(map) == expected);
+    auto i = map.erase(std::next(map.cbegin()), std::next(map.cbegin(), 3));
+    expected.erase(std::next(expected.begin()), std::next(expected.begin(), 3));
+    REQUIRE(elements(map) == expected);
+    REQUIRE((*i).first == expected[1].first);
+    i = map.erase(map.cbegin(), map.cbegin());
+    REQUIRE(i == map.begin());
+    i = map.erase(map.cbegin(), map.cend());
+    REQUIRE(i == map.end());
+    REQUIRE(map.empty());
+    REQUIRE(erase_if(map, [](const auto&) { return true;}) == 0U);
+  }
+}
+
+TEST_CASE("erase_if and range erase remove elements in one pass and keep the order of the rest")
+{
+  check_erase_if_and_range_erase<unordered_flatmap<int, std::string>>();
+  check_erase_if_and_range_erase<unordered_split_flatmap<int, std::string>>();
+  check_erase_if_and_range_erase<flatmap<int, std::string>>();
+  check_erase_if_and_range_erase<split_flatmap<int, std::string>>();
+}
+
+TEST_CASE("erase_if moves values that are not trivially relocatable")
+{
+  flatmap<int, std::unique_ptr<int>> map;
+  split_flatmap<int, std::unique_ptr<int>> split;
+  for (int i = 0; i != 100; ++i)
+  {
+    map.insert({i, std::make_unique<int>(i)});
+    split.insert({i, std::make_unique<int>(i)});
+  }
+  auto odd = [](const auto& x) { return *x.second % 2 == 1;};
+  REQUIRE(erase_if(map, odd) == 50U);
+  REQUIRE(erase_if(split, odd) == 50U);
+  map.erase(map.cbegin(), map.find(10));
+  split.erase(split.cbegin(), split.find(10));
+  REQUIRE(map.size() == 45U);
+  REQUIRE(split.size() == 45U);
+  int expected = 10;
+  for (auto&& [ k, v ] : map)
+  {
+    REQUIRE(k == expected);
+    REQUIRE(*v == expected);
+    expected += 2;
+  }
+  REQUIRE((*split.begin()).first == 10);
+  REQUIRE(*(*std::prev(split.end())).second == 98);
+}
+
+namespace {
+  template <typename Map>
+  void check_erase_if_throw()
+  {
+    Map map;
+    for (int i = 0; i != 100; ++i) map.insert({i, std::to_string(i)});
+    REQUIRE_THROWS_AS(erase_if(map, [](const auto& x) {
+      if (x.first == 60) throw std::runtime_error("pred");
+      return x.first % 3 == 0;
+    }), std::runtime_error);
+    REQUIRE(map.size() == 80U);
+    int expected = 0;
+    for (auto&& [ k, v ] : map)
+    {
+      while (expected < 60 && expected % 3 == 0) ++expected;
+      REQUIRE(k == expected);
+      REQUIRE(v == std::to_string(expected));
+      ++expected;
+    }
+    REQUIRE(expected == 100);
+  }
+}
+
+TEST_CASE("erase_if keeps the elements pred did not remove when pred throws")
+{
+  check_erase_if_throw<unordered_flatmap<int, std::string>>();
+  check_erase_if_throw<unordered_split_flatmap<int, std::string>>();
+  check_erase_if_throw<flatmap<int, std::string>>();
+  check_erase_if_throw<split_flatmap<int, std::string>>();
+}
+
+////
+
+namespace {
+  template <typename Map>
+  Map random_map(std::mt19937& gen, std::size_t n, int max_key, const std::string& tag)
+  {
+    std::uniform_int_distribution<int> key(0, max_key);
+    Map rv;
+    for (std::size_t i = 0; i != n; ++i)
+    {
+      auto const k = key(gen);
+      rv.insert({k, tag + std::to_string(k)});
+    }
+    return rv;
+  }
+
+  template <typename Map>
+  std::map<int, std::string> as_std_map(const Map& map)
+  {
+    std::map<int, std::string> rv;
+    for (auto&& [ k, v ] : map)
+    {
+      rv.emplace(k, v);
+    }
+    return rv;
+  }
+
+  template <typename Map>
+  void check_set_operations()
+  {
+    std::mt19937 gen(3);
+    auto const join = [](const std::string& a, const std::string& b) { return a + "+" + b;};
+    for (auto [ na, nb ] : { std::pair{200, 200}, std::pair{1000, 5}, std::pair{5, 1000}, std::pair{0, 50}, std::pair{50, 0} })
+    {
+      auto const a = random_map<Map>(gen, na, 500, "a");
+      auto const b = random_map<Map>(gen, nb, 500, "b");
+      auto const sa = as_std_map(a);
+      auto const sb = as_std_map(b);
+      std::map<int, std::string> expected_union = sa;
+      std::map<int, std::string> expected_intersection;
+      std::map<int, std::string> expected_difference = sa;
+      for (auto& [ k, v ] : sb)
+      {
+        if (auto i = sa.find(k); i != sa.end())
+        {
+          expected_union[k] = join(i->second, v);
+          expected_intersection[k] = join(i->second, v);
+          expected_difference.erase(k);
+        }
+        else
+        {
+          expected_union[k] = v;
+        }
+      }
+      REQUIRE(as_std_map(set_union(a, b, join)) == expected_union);
+      REQUIRE(as_std_map(set_intersection(a, b, join)) == expected_intersection);
+      REQUIRE(as_std_map(set_difference(a, b)) == expected_difference);
+      auto const kept = set_union(a, b);
+      for (auto&& [ k, v ] : kept)
+      {
+        REQUIRE(v == (sa.count(k) ? sa.at(k) : sb.at(k)));
+      }
+      auto merged = a;
+      auto source = b;
+      merged.merge(std::move(source), join);
+      REQUIRE(source.empty());
+      REQUIRE(as_std_map(merged) == expected_union);
+      REQUIRE(std::is_sorted(merged.begin(), merged.end(),
+                             [](const auto& lh, const auto& rh) { return lh.first < rh.first;}));
+    }
+  }
+}
+
+TEST_CASE("set operations and merge between sorted maps match std::map results, also with very different sizes")
+{
+  check_set_operations<flatmap<int, std::string>>();
+  check_set_operations<split_flatmap<int, std::string>>();
+}
+
+TEST_CASE("merge keeps the values of the target by default, and leaves both maps as they were if resolve throws")
+{
+  flatmap<int, std::string> map{{1, "one"}, {2, "two"}};
+  map.merge(flatmap<int, std::string>{{2, "deux"}, {3, "trois"}});
+  REQUIRE(as_std_map(map) == std::map<int, std::string>{{1, "one"}, {2, "two"}, {3, "trois"}});
+  map.merge(std::move(map));
+  REQUIRE(map.size() == 3U);
+  flatmap<int, std::string> source{{0, "zero"}, {2, "zwei"}, {3, "drei"}, {4, "vier"}};
+  int calls = 0;
+  auto const fail_second = [&calls](std::string&& a, std::string&& b) {
+    if (++calls == 2) throw std::runtime_error("conflict");
+    return a + b;
+  };
+  REQUIRE_THROWS_AS(map.merge(std::move(source), fail_second), std::runtime_error);
+  REQUIRE(as_std_map(map) == std::map<int, std::string>{{1, "one"}, {2, "two"}, {3, "trois"}});
+  REQUIRE(as_std_map(source) == std::map<int, std::string>{{0, "zero"}, {2, "zwei"}, {3, "drei"}, {4, "vier"}});
+  split_flatmap<int, std::string> split{{1, "one"}, {2, "two"}, {5, "five"}};
+  split_flatmap<int, std::string> other{{2, "deux"}, {3, "trois"}, {5, "cinq"}};
+  REQUIRE_THROWS_AS(split.merge(std::move(other), [](auto&& a, auto&&) -> std::string {
+                      if (a == "five") throw std::runtime_error("conflict");
+                      return std::move(a) + "!";
+                    }),
+                    std::runtime_error);
+  REQUIRE(as_std_map(split) == std::map<int, std::string>{{1, "one"}, {2, "two"}, {5, "five"}});
+  REQUIRE(as_std_map(other) == std::map<int, std::string>{{2, "deux"}, {3, "trois"}, {5, "cinq"}});
+  split.merge(std::move(other), [](auto&& a, auto&& b) { return a + "/" + b;});
+  REQUIRE(as_std_map(split) == std::map<int, std::string>{{1, "one"}, {2, "two/deux"}, {3, "trois"}, {5, "five/cinq"}});
+  REQUIRE(other.empty());
+}
+
+////
+
+namespace {
+  template <typename Map>
+  void check_insert_many()
+  {
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> key(0, 2000);
+    Map map;
+    std::map<int, std::string> expected;
+    for (std::size_t batch_size : { 0, 1, 10, 500, 3000, 40 })
+    {
+      std::vector<std::pair<int, std::string>> batch;
+      for (std::size_t i = 0; i != batch_size; ++i)
+      {
+        auto const k = key(gen);
+        batch.emplace_back(k, std::to_string(k) + "/" + std::to_string(i));
+      }
+      auto const assign = batch_size % 2 == 0;
+      if (assign)
+      {
+        map.insert_or_assign_many(batch.begin(), batch.end());
+        for (auto& [ k, v ] : batch) expected[k] = v;
+      }
+      else
+      {
+        map.insert_many(batch.begin(), batch.end());
+        for (auto& x : batch) expected.insert(x);
+      }
+      REQUIRE(as_std_map(map) == expected);
+      REQUIRE(std::is_sorted(map.begin(), map.end(),
+                             [](const auto& lh, const auto& rh) { return lh.first < rh.first;}));
+    }
+  }
+}
+
+TEST_CASE("insert_many and insert_or_assign_many match repeated insert and insert_or_assign")
+{
+  check_insert_many<flatmap<int, std::string>>();
+  check_insert_many<split_flatmap<int, std::string>>();
+}
+
+TEST_CASE("insert_many moves elements that are not trivially relocatable into place")
+{
+  flatmap<std::string, std::unique_ptr<int>> map;
+  split_flatmap<std::string, std::unique_ptr<int>> split;
+  std::vector<std::pair<std::string, std::unique_ptr<int>>> batch;
+  for (int i = 0; i != 100; i += 2)
+  {
+    batch.emplace_back("key" + std::to_string(i), std::make_unique<int>(i));
+  }
+  map.insert_many(std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+  batch.clear();
+  for (int i = 99; i > 0; i -= 2)
+  {
+    batch.emplace_back("key" + std::to_string(i), std::make_unique<int>(i));
+  }
+  split.insert_many(std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+  batch.clear();
+  for (int i = 0; i != 100; ++i)
+  {
+    batch.emplace_back("key" + std::to_string(i), std::make_unique<int>(-i));
+  }
+  map.insert_many(std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+  REQUIRE(map.size() == 100U);
+  for (auto&& [ k, v ] : map)
+  {
+    auto const i = std::stoi(k.substr(3));
+    REQUIRE(*v == (i % 2 == 0 ? i : -i));
+  }
+  REQUIRE(split.size() == 50U);
+  REQUIRE((*split.begin()).first == "key1");
+  REQUIRE(*(*split.find("key99")).second == 99);
+}
+
+////
+
+namespace {
+  template <typename Map>
+  void check_parallel_build(unsigned threads)
+  {
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<int> key(0, 20000);
+    std::vector<std::vector<std::pair<int, std::string>>> shards(5);
+    std::map<int, std::string> expected;
+    for (std::size_t s = 0; s != shards.size(); ++s)
+    {
+      auto const n = s == 2 ? 0 : 4000 * s + 7;
+      for (std::size_t i = 0; i != n; ++i)
+      {
+        auto const k = key(gen);
+        shards[s].emplace_back(k, std::to_string(s));
+        auto& v = expected[k];
+        v += v.empty() ? std::to_string(s) : "," + std::to_string(s);
+      }
+      if (s == 3) std::sort(shards[s].begin(), shards[s].end());
+    }
+    Map map{{-1, "gone"}};
+    parallel_build(map, std::move(shards), parallel_build_options{threads},
+                   [](std::string&& a, std::string&& b) { return a + "," + b;});
+    REQUIRE(as_std_map(map) == expected);
+    REQUIRE(std::is_sorted(map.begin(), map.end(),
+                           [](const auto& lh, const auto& rh) { return lh.first < rh.first;}));
+  }
+}
+
+TEST_CASE("parallel_build merges shards into a sorted map, resolving repeated keys in shard order")
+{
+  for (unsigned threads : { 1U, 3U, 8U })
+  {
+    check_parallel_build<flatmap<int, std::string>>(threads);
+    check_parallel_build<split_flatmap<int, std::string>>(threads);
+  }
+}
+
+TEST_CASE("parallel_build keeps the first value by default, and leaves the map empty if resolve throws")
+{
+  std::vector<std::vector<std::pair<std::string, int>>> shards(4);
+  for (int i = 0; i != 10000; ++i)
+  {
+    shards[i % 4].emplace_back("key" + std::to_string(i % 5000), i);
+  }
+  split_flatmap<std::string, int> map;
+  parallel_build(map, shards, parallel_build_options{4, 2});
+  REQUIRE(map.size() == 5000U);
+  for (auto&& [ k, v ] : map)
+  {
+    REQUIRE(v == std::stoi(k.substr(3)));
+  }
+  flatmap<std::string, int> other{{"a", 1}};
+  REQUIRE_THROWS_AS(parallel_build(other, shards, parallel_build_options{4, 2},
+                                   [](int, int) -> int { throw std::runtime_error("duplicate");}),
+                    std::runtime_error);
+  REQUIRE(other.empty());
+  parallel_build(other, {});
+  REQUIRE(other.empty());
+}
+
+////
+
+namespace {
+  template <typename Map>
+  const int* first_key(const Map& map)
+  {
+    return map.begin() == map.end() ? nullptr : &(*map.begin()).first;
+  }
+
+  template <typename Unordered, typename Compare>
+  void check_freeze(int n)
+  {
+    std::vector<int> keys(static_cast<std::size_t>(n));
+    std::iota(keys.begin(), keys.end(), 0);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(n));
+    Unordered map;
+    for (auto k : keys)
+    {
+      map.insert({k, std::to_string(k)});
+    }
+    auto const copy = to_sorted<Compare>(map);
+    REQUIRE(copy.size() == map.size());
+    auto const data = first_key(map);
+    auto frozen = freeze<Compare>(std::move(map));
+    REQUIRE(map.empty());
+    REQUIRE(first_key(frozen) == data);
+    REQUIRE(frozen.size() == keys.size());
+    REQUIRE(std::is_sorted(frozen.begin(), frozen.end(),
+                           [](const auto& lh, const auto& rh) { return Compare{}(lh.first, rh.first);}));
+    REQUIRE(as_std_map(frozen) == as_std_map(copy));
+    for (auto k : keys)
+    {
+      auto i = frozen.find(k);
+      REQUIRE(i != frozen.end());
+      REQUIRE((*i).second == std::to_string(k));
+    }
+    decltype(thaw(std::move(frozen))) thawed;
+    REQUIRE(allocations_during([&] { thawed = thaw(std::move(frozen));}) == 0U);
+    REQUIRE(frozen.empty());
+    REQUIRE(first_key(thawed) == data);
+    REQUIRE(thawed.size() == keys.size());
+    thawed.insert({n, "new"});
+    REQUIRE(thawed.find(n) != thawed.end());
+  }
+}
+
+TEST_CASE("freeze sorts the storage of an unordered map in place, and thaw gives it back")
+{
+  for (int n : { 0, 1, 2, 1000 })
+  {
+    check_freeze<unordered_flatmap<int, std::string>, std::less<>>(n);
+    check_freeze<unordered_split_flatmap<int, std::string>, std::less<>>(n);
+    check_freeze<unordered_flatmap<int, std::string>, std::greater<>>(n);
+    check_freeze<unordered_split_flatmap<int, std::string>, std::greater<>>(n);
+  }
+}
+
+TEST_CASE("freeze moves values that are not trivially relocatable")
+{
+  unordered_split_flatmap<std::string, std::unique_ptr<int>> map;
+  for (int i = 0; i != 100; ++i)
+  {
+    auto const k = (i * 37) % 100;
+    map.insert({"key" + std::to_string(100 + k), std::make_unique<int>(k)});
+  }
+  auto frozen = freeze(std::move(map));
+  int expected = 0;
+  for (auto&& [ k, v ] : frozen)
+  {
+    REQUIRE(k == "key" + std::to_string(100 + expected));
+    REQUIRE(*v == expected++);
+  }
+  REQUIRE(expected == 100);
+}
+
+namespace {
+  struct less_throwing_on_7
+  {
+    bool operator()(int lh, int rh) const
+    {
+      if (lh == 7 || rh == 7) throw std::runtime_error("compare");
+      return lh < rh;
+    }
+  };
+
+  template <typename Unordered>
+  void check_freeze_throw()
+  {
+    Unordered map;
+    for (int k = 20; k-- != 0;) map.insert({k, std::to_string(k)});
+    auto const data = first_key(map);
+    REQUIRE_THROWS_AS(freeze<less_throwing_on_7>(std::move(map)), std::runtime_error);
+    REQUIRE(first_key(map) == data);
+    REQUIRE(map.size() == 20U);
+    for (int k = 0; k != 20; ++k)
+    {
+      auto i = map.find(k);
+      REQUIRE(i != map.end());
+      REQUIRE((*i).second == std::to_string(k));
+    }
+  }
+}
+
+TEST_CASE("freeze leaves the unordered map as it was if the comparator throws")
+{
+  check_freeze_throw<unordered_flatmap<int, std::string>>();
+  check_freeze_throw<unordered_split_flatmap<int, std::string>>();
+}
+
+TEST_CASE("lookups with compatible key types do not allocate in any of the maps")
+{
+  const char* const known = "a key too long for the small string buffer";
+  const char* const unknown = "another key too long for the small string buffer";
+  unordered_flatmap<std::string, int> um;
+  flatmap<std::string, int> fm;
+  unordered_split_flatmap<std::string, int> usm;
+  split_flatmap<std::string, int> sm;
+  for (auto k : { known, "a", "zzz" })
+  {
+    um.insert({k, 1});
+    fm.insert({k, 1});
+    usm.insert({k, 1});
+    sm.insert({k, 1});
+  }
+  std::size_t found = 0;
+  auto const n = allocations_during([&] {
+    found += um.count(known) + um.count(unknown) + (um.find(std::string_view(known)) != um.end());
+    found += usm.count(known) + usm.count(unknown) + (usm.find(std::string_view(known)) != usm.end());
+    found += fm.count(known) + fm.count(unknown) + (fm.find(std::string_view(known)) != fm.end());
+    found += sm.count(known) + sm.count(unknown) + (sm.find(std::string_view(known)) != sm.end());
+    found += (fm.lower_bound(unknown) != fm.end()) + (sm.upper_bound(known) != sm.end());
+    auto const [ b, e ] = sm.equal_range(known);
+    found += !fm.range("a", "zzz").empty() + (b != e);
+  });
+  REQUIRE(n == 0U);
+  REQUIRE(found == 12U);
+}
@@ -0,0 +1,234 @@
+// Measures, for each key type, the sizes where a linear search of sorted
+// keys stops beating bisection, and where a hash map starts beating the
+// sorted maps, and writes them as tuning::thresholds specializations to
+// flatmap_tuning.hpp, or the file named on the command line. flatmap.hpp
+// picks that header up when it is on the include path.
+#include "flatmap.hpp"
+#include <unordered_map>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+std::mt19937_64 gen(5489U);
+volatile size_t sink;
+
+template <typename Key>
+Key make_key(size_t);
+
+template <>
+int make_key<int>(size_t) { return static_cast<int>(gen());}
+
+template <>
+std::int64_t make_key<std::int64_t>(size_t) { return static_cast<std::int64_t>(gen());}
+
+template <>
+std::string make_key<std::string>(size_t length)
+{
+  // Long keys share a prefix, like paths in the same directory tree.
+  static const std::string prefix = "/usr/local/share/flatmap/";
+  std::string rv = length > prefix.size() ? prefix : std::string{};
+  while (rv.size() < length)
+  {
+    rv += static_cast<char>('a' + gen() % 26);
+  }
+  return rv;
+}
+
+template <typename Key>
+std::vector<Key> make_keys(size_t n, size_t length)
+{
+  std::vector<Key> rv;
+  while (rv.size() < n)
+  {
+    std::generate_n(std::back_inserter(rv), n - rv.size(), [length] { return make_key<Key>(length);});
+    std::sort(rv.begin(), rv.end());
+    rv.erase(std::unique(rv.begin(), rv.end()), rv.end());
+  }
+  return rv;
+}
+
+// Half of the probes are keys in the map, and half are not.
+template <typename Key>
+std::vector<Key> make_probes(const std::vector<Key>& keys, size_t length)
+{
+  std::vector<Key> rv;
+  for (size_t i = 0; i != 4096; ++i)
+  {
+    rv.push_back(i % 2 ? keys[gen() % keys.size()] : make_key<Key>(length));
+  }
+  return rv;
+}
+
+// The best of five runs, in ns per probe, of at least a millisecond each.
+template <typename F>
+double time_per_probe(size_t probes, F lookup)
+{
+  using clock = std::chrono::steady_clock;
+  double best = std::numeric_limits<double>::max();
+  for (int run = 0; run != 5; ++run)
+  {
+    size_t rounds = 0;
+    size_t found = 0;
+    auto const start = clock::now();
+    auto elapsed = clock::duration{};
+    do
+    {
+      found += lookup();
+      ++rounds;
+      elapsed = clock::now() - start;
+    } while (elapsed < std::chrono::milliseconds(1));
+    sink = found;
+    best = std::min(best, std::chrono::duration<double, std::nano>(elapsed).count() / double(rounds * probes));
+  }
+  return best;
+}
+
+// The largest size where linear search wins. At a few keys both take a few
+// ns, and bisection, which the compiler makes branch free, can win there
+// without mattering.
+template <typename Key>
+size_t linear_search_max(size_t length)
+{
+  static const size_t sizes[] = { 1, 2, 3, 4, 6, 8, 12, 16, 24, 32, 48, 64, 96, 128, 192, 256 };
+  size_t rv = 0;
+  for (auto n : sizes)
+  {
+    auto const keys = make_keys<Key>(n, length);
+    auto const probes = make_probes(keys, length);
+    auto const search = [&](size_t linear_max) {
+      return time_per_probe(probes.size(), [&] {
+        size_t found = 0;
+        for (auto& p : probes)
+        {
+          found += impl::search_keys(keys.begin(), keys.end(), p, std::less<>{}, linear_max).second;
+        }
+        return found;
+      });
+    };
+    auto const linear = search(std::numeric_limits<size_t>::max());
+    auto const bisect = search(0);
+    std::cerr << "  " << n << " keys: linear " << linear << " ns, bisect " << bisect << " ns\n";
+    if (linear <= bisect) rv = n;
+  }
+  return rv;
+}
+
+// The smallest size from which the hash map wins at every larger size.
+template <typename Key>
+size_t hash_min(size_t length)
+{
+  size_t rv = std::numeric_limits<size_t>::max();
+  for (size_t n = 4; n <= (size_t{1} << 20); n *= 4)
+  {
+    auto const keys = make_keys<Key>(n, length);
+    auto const probes = make_probes(keys, length);
+    split_flatmap<Key, int> sorted;
+    std::unordered_map<Key, int> hashed;
+    for (auto& k : keys)
+    {
+      sorted.insert({k, 0});
+      hashed.insert({k, 0});
+    }
+    auto const lookup = [&](auto& map) {
+      return time_per_probe(probes.size(), [&] {
+        size_t found = 0;
+        for (auto& p : probes)
+        {
+          found += map.count(p);
+        }
+        return found;
+      });
+    };
+    auto const sorted_time = lookup(sorted);
+    auto const hashed_time = lookup(hashed);
+    std::cerr << "  " << n << " elements: split_flatmap " << sorted_time << " ns, unordered_map " << hashed_time << " ns\n";
+    if (hashed_time < sorted_time)
+    {
+      rv = std::min(rv, n);
+    }
+    else
+    {
+      rv = std::numeric_limits<size_t>::max();
+    }
+  }
+  return rv;
+}
+
+struct result
+{
+  const char* type;
+  size_t      linear_search_max;
+  size_t      hash_min;
+};
+
+// Strings are measured short and long, and get the smaller of the
+// thresholds.
+template <typename Key>
+result tune(const char* type, std::initializer_list<size_t> lengths)
+{
+  result rv{ type, std::numeric_limits<size_t>::max(), std::numeric_limits<size_t>::max() };
+  for (auto length : lengths)
+  {
+    std::cerr << type << ", length " << length << ":\n";
+    rv.linear_search_max = std::min(rv.linear_search_max, linear_search_max<Key>(length));
+    rv.hash_min = std::min(rv.hash_min, hash_min<Key>(length));
+  }
+  return rv;
+}
+
+std::string literal(size_t n)
+{
+  return n == std::numeric_limits<size_t>::max() ? "static_cast<std::size_t>(-1)" : std::to_string(n);
+}
+}
+
+int main(int argc, char** argv)
+{
+  const char* filename = argc > 1 ? argv[1] : "flatmap_tuning.hpp";
+  result const results[] = {
+    tune<int>("int", { 0 }),
+    tune<std::int64_t>("std::int64_t", { 0 }),
+    tune<std::string>("std::string", { 8, 48 }),
+  };
+  std::ofstream os(filename);
+  os << "// Generated by flatmap_tune for the machine it ran on. Rerun it to retune.\n"
+        "#ifndef FLATMAP_TUNING_HPP\n"
+        "#define FLATMAP_TUNING_HPP\n"
+        "\n"
+        "#ifndef FLATMAP_FLATMAP_HPP\n"
+        "#error \"include flatmap.hpp, which includes flatmap_tuning.hpp\"\n"
+        "#endif\n"
+        "\n"
+        "#include <cstdint>\n"
+        "#include <string>\n"
+        "\n"
+        "namespace tuning {\n";
+  for (auto& r : results)
+  {
+    os << "  template <>\n"
+          "  struct thresholds<" << r.type << ">\n"
+          "  {\n"
+          "    static constexpr std::size_t linear_search_max = " << literal(r.linear_search_max) << ";\n"
+          "    static constexpr std::size_t hash_min = " << literal(r.hash_min) << ";\n"
+          "  };\n";
+  }
+  os << "}\n"
+        "\n"
+        "#endif //FLATMAP_TUNING_HPP\n";
+  os.close();
+  if (!os)
+  {
+    std::cerr << "failed writing " << filename << '\n';
+    return 1;
+  }
+  std::cerr << "wrote " << filename << '\n';
+}
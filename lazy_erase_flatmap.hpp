@@ -0,0 +1,326 @@
+#ifndef FLATMAP_LAZY_ERASE_FLATMAP_HPP
+#define FLATMAP_LAZY_ERASE_FLATMAP_HPP
+
+#include "flatmap.hpp"
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+struct lazy_erase_options
+{
+  // Compact once this share of the elements are tombstones.
+  double max_tombstone_ratio = 0.25;
+};
+
+namespace impl
+{
+  // One bit per element of a sorted map. Inserting a bit moves the bits
+  // above it up one step, as inserting an element shifts the elements.
+  class tombstones
+  {
+  public:
+    bool test(std::size_t i) const noexcept
+    {
+      return i / 64 < m_words.size() && (m_words[i / 64] >> (i % 64) & 1U);
+    }
+    void set(std::size_t i)
+    {
+      if (i / 64 >= m_words.size()) m_words.resize(i / 64 + 1);
+      m_words[i / 64] |= std::uint64_t{1} << (i % 64);
+    }
+    void reset(std::size_t i) noexcept { m_words[i / 64] &= ~(std::uint64_t{1} << (i % 64));}
+    // Inserts a clear bit at i.
+    void insert(std::size_t i)
+    {
+      auto w = i / 64;
+      if (w >= m_words.size()) return;
+      if (m_words.back() >> 63) m_words.push_back(0);
+      auto const low = (std::uint64_t{1} << (i % 64)) - 1;
+      auto carry = m_words[w] >> 63;
+      m_words[w] = (m_words[w] & low) | ((m_words[w] & ~low) << 1);
+      while (++w != m_words.size())
+      {
+        auto const next = m_words[w] >> 63;
+        m_words[w] = (m_words[w] << 1) | carry;
+        carry = next;
+      }
+    }
+    void clear() noexcept { m_words.clear();}
+  private:
+    std::vector<std::uint64_t> m_words;
+  };
+
+  template <typename Key, typename Value, typename Compare, typename Iterator>
+  std::size_t index_of(const flatmap<Key, Value, Compare>& m, Iterator i) noexcept
+  {
+    return i == m.end() ? m.size() : static_cast<std::size_t>(std::addressof(*i) - std::addressof(*m.begin()));
+  }
+
+  template <typename Key, typename Value, typename Compare, typename Iterator>
+  std::size_t index_of(const split_flatmap<Key, Value, Compare>&, Iterator i) noexcept
+  {
+    return index(i);
+  }
+
+  // Removes the elements marked in dead in one sweep, moving each kept
+  // element at most once.
+  template <typename T>
+  void compact(relocating_vector<T>& values, const tombstones& dead) noexcept
+  {
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i != values.size(); ++i)
+    {
+      if (dead.test(i)) continue;
+      if (kept != i) move_assign(values[kept], values[i]);
+      ++kept;
+    }
+    values.erase(values.begin() + kept, values.end());
+  }
+
+  template <typename Key, typename Value>
+  void compact(split_columns<Key, Value>& columns, const tombstones& dead) noexcept
+  {
+    std::size_t kept = 0;
+    auto const keys = columns.keys();
+    auto const values = columns.values();
+    for (std::size_t i = 0; i != columns.size(); ++i)
+    {
+      if (dead.test(i)) continue;
+      if (kept != i)
+      {
+        move_assign(keys[kept], keys[i]);
+        move_assign(values[kept], values[i]);
+      }
+      ++kept;
+    }
+    columns.erase(kept, columns.size());
+  }
+
+  template <typename Key, typename Value, typename Compare>
+  void compact(flatmap<Key, Value, Compare>& m, const tombstones& dead) noexcept
+  {
+    compact(storage_access::values(m), dead);
+  }
+
+  template <typename Key, typename Value, typename Compare>
+  void compact(split_flatmap<Key, Value, Compare>& m, const tombstones& dead) noexcept
+  {
+    compact(storage_access::columns(m), dead);
+  }
+}
+
+// A flatmap or split_flatmap whose erase marks the element as a tombstone
+// instead of shifting the elements after it. Lookups and iteration skip
+// tombstones, and inserting an erased key again revives its slot. Once
+// tombstones make up max_tombstone_ratio of the elements, or on
+// compact(), one sweep removes them all, so erasing k elements costs
+// O(k log n) plus O(n) per compaction instead of O(k n). Erased values
+// are destroyed by the compaction.
+template <typename Map>
+class lazy_erase_flatmap
+{
+public:
+  using map_type = Map;
+  using value_type = typename Map::value_type;
+  using key_type = std::remove_const_t<typename value_type::first_type>;
+  using mapped_type = typename value_type::second_type;
+  using size_type = typename Map::size_type;
+  using options = lazy_erase_options;
+  template <typename container, typename map_iterator>
+  class iterator_type;
+  using iterator = iterator_type<lazy_erase_flatmap, typename Map::iterator>;
+  using const_iterator = iterator_type<const lazy_erase_flatmap, typename Map::const_iterator>;
+
+  lazy_erase_flatmap() = default;
+  explicit lazy_erase_flatmap(options opts) : m_options(opts) {}
+  explicit lazy_erase_flatmap(Map map, options opts = {}) : m_map(std::move(map)), m_options(opts) {}
+
+  bool empty() const noexcept { return size() == 0;}
+  size_type size() const noexcept { return m_map.size() - m_dead;}
+  size_type tombstones() const noexcept { return m_dead;}
+  void clear() noexcept { m_map.clear(); m_tombstones.clear(); m_dead = 0;}
+  iterator begin() noexcept { return at(m_map.begin());}
+  iterator end() noexcept { return { *this, m_map.end(), m_map.size() };}
+  const_iterator begin() const noexcept { return at(m_map.begin());}
+  const_iterator end() const noexcept { return { *this, m_map.end(), m_map.size() };}
+  const_iterator cbegin() const noexcept { return begin();}
+  const_iterator cend() const noexcept { return end();}
+  // The map without tombstones.
+  const Map& map() { compact(); return m_map;}
+
+  template <typename T>
+  iterator find(const T& key) noexcept;
+  template <typename T>
+  const_iterator find(const T& key) const noexcept;
+  template <typename T>
+  size_type count(const T& key) const noexcept { return find(key) == end() ? 0 : 1;}
+  template <typename T>
+  iterator lower_bound(const T& key) noexcept { return at(m_map.lower_bound(key));}
+  template <typename T>
+  const_iterator lower_bound(const T& key) const noexcept { return at(m_map.lower_bound(key));}
+  template <typename T>
+  iterator upper_bound(const T& key) noexcept { return at(m_map.upper_bound(key));}
+  template <typename T>
+  const_iterator upper_bound(const T& key) const noexcept { return at(m_map.upper_bound(key));}
+
+  std::pair<iterator, bool> insert(const value_type& v) { return try_emplace(v.first, v.second);}
+  std::pair<iterator, bool> insert(value_type&& v) { return try_emplace(v.first, std::move(v.second));}
+  template <typename K, typename V>
+  std::pair<iterator, bool> insert_or_assign(K&& key, V&& value);
+  template <typename K, typename ... V>
+  std::pair<iterator, bool> try_emplace(K&& key, V&& ... v);
+  template <typename T>
+  mapped_type& operator[](const T& key) { return try_emplace(key).first->second;}
+  void erase(iterator i);
+  template <typename K>
+  size_type erase(const K& key);
+  // Removes all tombstones in one sweep.
+  void compact() noexcept;
+private:
+  template <typename I>
+  iterator at(I i) noexcept { return { *this, i, impl::index_of(m_map, i) };}
+  template <typename I>
+  const_iterator at(I i) const noexcept { return { *this, i, impl::index_of(m_map, i) };}
+  bool dead(size_type idx) const noexcept { return m_dead && m_tombstones.test(idx);}
+
+  Map              m_map;
+  impl::tombstones m_tombstones;
+  size_type        m_dead = 0;
+  options          m_options;
+};
+
+template <typename Map>
+template <typename container, typename map_iterator>
+class lazy_erase_flatmap<Map>::iterator_type
+{
+  template <typename C, typename I>
+  friend class lazy_erase_flatmap<Map>::iterator_type;
+  friend class lazy_erase_flatmap<Map>;
+public:
+  using value_type = typename std::iterator_traits<map_iterator>::value_type;
+  using iterator_category = std::forward_iterator_tag;
+  using pointer = typename std::iterator_traits<map_iterator>::pointer;
+  using reference = typename std::iterator_traits<map_iterator>::reference;
+  using difference_type = std::ptrdiff_t;
+
+  constexpr iterator_type() noexcept = default;
+  iterator_type(container& c_, map_iterator i_, size_type idx_) noexcept : c{&c_}, i{i_}, idx{idx_} { skip();}
+  template <typename C, typename I, typename = std::enable_if_t<std::is_convertible<I, map_iterator>{}>>
+  constexpr iterator_type(const iterator_type<C, I>& ci) noexcept : c{ci.c}, i{ci.i}, idx{ci.idx} {}
+  iterator_type& operator++() noexcept { ++i; ++idx; skip(); return *this;}
+  iterator_type operator++(int) noexcept { auto rv = *this; operator++(); return rv;}
+  reference operator*() const noexcept { return *i;}
+  decltype(auto) operator->() const noexcept { return i.operator->();}
+  template <typename C, typename I>
+  bool operator==(const iterator_type<C, I>& ci) const noexcept { return idx == ci.idx;}
+  template <typename C, typename I>
+  bool operator!=(const iterator_type<C, I>& ci) const noexcept { return idx != ci.idx;}
+private:
+  void skip() noexcept
+  {
+    while (idx != c->m_map.size() && c->dead(idx))
+    {
+      ++i;
+      ++idx;
+    }
+  }
+
+  container* c = nullptr;
+  map_iterator i;
+  size_type idx = 0;
+};
+
+template <typename Map>
+template <typename T>
+auto lazy_erase_flatmap<Map>::find(const T& key) noexcept -> iterator
+{
+  auto i = m_map.find(key);
+  if (i == m_map.end()) return end();
+  auto const idx = impl::index_of(m_map, i);
+  return dead(idx) ? end() : iterator{ *this, i, idx };
+}
+
+template <typename Map>
+template <typename T>
+auto lazy_erase_flatmap<Map>::find(const T& key) const noexcept -> const_iterator
+{
+  auto i = m_map.find(key);
+  if (i == m_map.end()) return end();
+  auto const idx = impl::index_of(m_map, i);
+  return dead(idx) ? end() : const_iterator{ *this, i, idx };
+}
+
+template <typename Map>
+template <typename K, typename ... V>
+auto lazy_erase_flatmap<Map>::try_emplace(K&& key, V&& ... v) -> std::pair<iterator, bool>
+{
+  if (auto i = m_map.find(key); i != m_map.end())
+  {
+    auto const idx = impl::index_of(m_map, i);
+    if (!dead(idx)) return { iterator{ *this, i, idx }, false };
+    i->second = mapped_type(std::forward<V>(v)...);
+    m_tombstones.reset(idx);
+    --m_dead;
+    return { iterator{ *this, i, idx }, true };
+  }
+  auto [ i, inserted ] = m_map.try_emplace(std::forward<K>(key), std::forward<V>(v)...);
+  auto const idx = impl::index_of(m_map, i);
+  if (m_dead)
+  {
+    try
+    {
+      m_tombstones.insert(idx);
+    }
+    catch (...)
+    {
+      m_map.erase(i);
+      throw;
+    }
+  }
+  return { iterator{ *this, i, idx }, inserted };
+}
+
+template <typename Map>
+template <typename K, typename V>
+auto lazy_erase_flatmap<Map>::insert_or_assign(K&& key, V&& value) -> std::pair<iterator, bool>
+{
+  if (auto i = find(key); i != end())
+  {
+    i->second = std::forward<V>(value);
+    return { i, false };
+  }
+  return try_emplace(std::forward<K>(key), std::forward<V>(value));
+}
+
+template <typename Map>
+void lazy_erase_flatmap<Map>::erase(iterator i)
+{
+  m_tombstones.set(i.idx);
+  ++m_dead;
+  if (static_cast<double>(m_dead) >= m_options.max_tombstone_ratio * static_cast<double>(m_map.size()))
+  {
+    compact();
+  }
+}
+
+template <typename Map>
+template <typename K>
+auto lazy_erase_flatmap<Map>::erase(const K& key) -> size_type
+{
+  auto i = find(key);
+  if (i == end()) return 0;
+  erase(i);
+  return 1;
+}
+
+template <typename Map>
+void lazy_erase_flatmap<Map>::compact() noexcept
+{
+  if (m_dead == 0) return;
+  impl::compact(m_map, m_tombstones);
+  m_tombstones.clear();
+  m_dead = 0;
+}
+
+#endif //FLATMAP_LAZY_ERASE_FLATMAP_HPP
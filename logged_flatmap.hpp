@@ -0,0 +1,449 @@
+#ifndef FLATMAP_LOGGED_FLATMAP_HPP
+#define FLATMAP_LOGGED_FLATMAP_HPP
+
+#include "flatmap.hpp"
+#include "flatmap_serialization.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <fcntl.h>
+#include <unistd.h>
+
+struct logged_flatmap_options
+{
+  std::size_t group_commit_bytes = 64 * 1024;
+  bool        sync = true;
+};
+
+// A flatmap whose mutations are appended to a write ahead log.
+//
+// The log starts with a header { magic, version, key column tag, value
+// column tag }, so a log of another type, or not a log at all, is refused
+// rather than replayed. Log records are { op, key[, value] }, with keys and
+// values encoded by serialization::column_codec. A record is staged before
+// the map changes, and dropped again if the change throws. Records are
+// collected in memory and written as one group once group_commit_bytes have
+// accumulated, or on commit(). If writing the group fails, the log is cut
+// back to where the group started and the group stays staged for the next
+// commit(), so the map and the log still agree.
+// checkpoint() saves the whole map next to the log and truncates the log.
+// Construction recovers the state from the checkpoint and the log, and a
+// torn record at the end of the log, from a crash mid write, is discarded.
+template <typename Key, typename Value, typename Compare = std::less<>>
+class logged_flatmap
+{
+public:
+  using map_type = flatmap<Key, Value, Compare>;
+  using value_type = typename map_type::value_type;
+  using const_iterator = typename map_type::const_iterator;
+  using size_type = typename map_type::size_type;
+
+  using options = logged_flatmap_options;
+
+  logged_flatmap(std::string checkpoint_path, std::string log_path, options opts = {});
+  logged_flatmap(const logged_flatmap&) = delete;
+  logged_flatmap& operator=(const logged_flatmap&) = delete;
+  ~logged_flatmap();
+
+  const map_type& map() const noexcept { return m_map;}
+  bool empty() const noexcept { return m_map.empty();}
+  size_type size() const noexcept { return m_map.size();}
+  const_iterator begin() const noexcept { return m_map.begin();}
+  const_iterator end() const noexcept { return m_map.end();}
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, T, Key>{}>>
+  const_iterator find(const T& key) const noexcept { return m_map.find(key);}
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, T, Key>{}>>
+  size_type count(const T& key) const noexcept { return m_map.count(key);}
+
+  std::pair<const_iterator, bool> insert(const value_type& v);
+  template <typename K,
+            typename V,
+            typename = std::enable_if_t<type_traits::is_callable<Compare, K, Key>{} &&
+                                        std::is_constructible<Value, V>{} &&
+                                        std::is_assignable<Value&, V>{}>>
+  std::pair<const_iterator, bool> insert_or_assign(K&& key, V&& value);
+  template <typename K, typename = std::enable_if_t<type_traits::is_callable<Compare, K, Key>{}>>
+  size_type erase(const K& key);
+
+  void commit();
+  void checkpoint();
+private:
+  enum class op : std::uint8_t { upsert = 1, erase = 2 };
+  using delta = std::pair<Key, std::optional<Value>>;
+
+  static constexpr char log_magic[4] = { 'F', 'L', 'M', 'L' };
+  static constexpr std::uint32_t log_version = 1;
+  static std::string log_header();
+
+  std::streamoff stage(op o, const Key& key, const Value* value);
+  void unstage(std::streamoff pos);
+  void commit_if_full();
+  void recover();
+  std::vector<delta> read_log();
+  void apply(std::vector<delta> deltas);
+  void sync_file(const std::string& path);
+  void sync_directory(const std::string& path);
+
+  map_type           m_map;
+  std::string        m_checkpoint_path;
+  std::string        m_log_path;
+  options            m_options;
+  std::ostringstream m_pending;
+  int                m_log_fd = -1;
+  off_t              m_log_size = 0;
+};
+
+template <typename Key, typename Value, typename Compare>
+logged_flatmap<Key, Value, Compare>::logged_flatmap(std::string checkpoint_path, std::string log_path, options opts)
+  : m_checkpoint_path(std::move(checkpoint_path))
+  , m_log_path(std::move(log_path))
+  , m_options(opts)
+{
+  recover();
+  m_log_fd = ::open(m_log_path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+  if (m_log_fd < 0)
+  {
+    throw std::system_error(errno, std::generic_category(), m_log_path);
+  }
+  m_log_size = ::lseek(m_log_fd, 0, SEEK_END);
+  if (m_log_size == 0)
+  {
+    m_pending << log_header();
+    try
+    {
+      commit();
+    }
+    catch (...)
+    {
+      ::close(m_log_fd);
+      throw;
+    }
+  }
+}
+
+template <typename Key, typename Value, typename Compare>
+std::string logged_flatmap<Key, Value, Compare>::log_header()
+{
+  std::ostringstream os;
+  os.write(log_magic, sizeof(log_magic));
+  serialization::detail::write_raw(os, log_version);
+  serialization::detail::write_raw(os, serialization::column_codec<Key>::tag.codec);
+  serialization::detail::write_raw(os, serialization::column_codec<Key>::tag.element_size);
+  serialization::detail::write_raw(os, serialization::column_codec<Value>::tag.codec);
+  serialization::detail::write_raw(os, serialization::column_codec<Value>::tag.element_size);
+  return os.str();
+}
+
+template <typename Key, typename Value, typename Compare>
+logged_flatmap<Key, Value, Compare>::~logged_flatmap()
+{
+  try
+  {
+    commit();
+  }
+  catch (...)
+  {
+  }
+  ::close(m_log_fd);
+}
+
+template <typename Key, typename Value, typename Compare>
+auto logged_flatmap<Key, Value, Compare>::insert(const value_type& v) -> std::pair<const_iterator, bool>
+{
+  if (auto i = m_map.find(v.first); i != m_map.end()) return { i, false };
+  auto const pos = stage(op::upsert, v.first, std::addressof(v.second));
+  const_iterator iter;
+  try
+  {
+    iter = m_map.insert(v).first;
+  }
+  catch (...)
+  {
+    unstage(pos);
+    throw;
+  }
+  commit_if_full();
+  return { iter, true };
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename K, typename V, typename>
+auto logged_flatmap<Key, Value, Compare>::insert_or_assign(K&& key, V&& value) -> std::pair<const_iterator, bool>
+{
+  Key k(std::forward<K>(key));
+  Value v(std::forward<V>(value));
+  auto const pos = stage(op::upsert, k, std::addressof(v));
+  std::pair<const_iterator, bool> rv;
+  try
+  {
+    rv = m_map.insert_or_assign(std::move(k), std::move(v));
+  }
+  catch (...)
+  {
+    unstage(pos);
+    throw;
+  }
+  commit_if_full();
+  return rv;
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename K, typename>
+auto logged_flatmap<Key, Value, Compare>::erase(const K& key) -> size_type
+{
+  auto i = m_map.find(key);
+  if (i == m_map.end()) return 0;
+  stage(op::erase, i->first, nullptr);
+  m_map.erase(i);
+  commit_if_full();
+  return 1;
+}
+
+// Appends a record to the pending group, and returns where it starts.
+template <typename Key, typename Value, typename Compare>
+std::streamoff logged_flatmap<Key, Value, Compare>::stage(op o, const Key& key, const Value* value)
+{
+  auto const pos = static_cast<std::streamoff>(m_pending.tellp());
+  try
+  {
+    auto const o_byte = static_cast<std::uint8_t>(o);
+    m_pending.write(reinterpret_cast<const char*>(&o_byte), sizeof(o_byte));
+    serialization::column_codec<Key>::write(m_pending, &key, &key + 1, serialization::identity{});
+    if (value)
+    {
+      serialization::column_codec<Value>::write(m_pending, value, value + 1, serialization::identity{});
+    }
+  }
+  catch (...)
+  {
+    unstage(pos);
+    throw;
+  }
+  return pos;
+}
+
+// Drops the pending records from pos on.
+template <typename Key, typename Value, typename Compare>
+void logged_flatmap<Key, Value, Compare>::unstage(std::streamoff pos)
+{
+  m_pending.str(m_pending.str().substr(0, static_cast<std::size_t>(pos)));
+  m_pending.seekp(0, std::ios::end);
+}
+
+template <typename Key, typename Value, typename Compare>
+void logged_flatmap<Key, Value, Compare>::commit_if_full()
+{
+  if (static_cast<std::size_t>(m_pending.tellp()) >= m_options.group_commit_bytes)
+  {
+    commit();
+  }
+}
+
+template <typename Key, typename Value, typename Compare>
+void logged_flatmap<Key, Value, Compare>::commit()
+{
+  auto const group = m_pending.str();
+  if (group.empty()) return;
+  auto const fail = [this](int err) {
+    // Cut off a partly written group, so that retrying does not leave a
+    // torn record in the middle of the log.
+    auto what = m_log_path;
+    if (::ftruncate(m_log_fd, m_log_size) != 0)
+    {
+      what += " (cutting off the partly written group also failed: " + std::generic_category().message(errno) + ")";
+    }
+    throw std::system_error(err, std::generic_category(), what);
+  };
+  for (std::size_t written = 0; written != group.size();)
+  {
+    auto const n = ::write(m_log_fd, group.data() + written, group.size() - written);
+    if (n < 0)
+    {
+      if (errno == EINTR) continue;
+      fail(errno);
+    }
+    written += static_cast<std::size_t>(n);
+  }
+  if (m_options.sync && ::fdatasync(m_log_fd) != 0)
+  {
+    fail(errno);
+  }
+  m_log_size += static_cast<off_t>(group.size());
+  m_pending.str({});
+}
+
+template <typename Key, typename Value, typename Compare>
+void logged_flatmap<Key, Value, Compare>::checkpoint()
+{
+  commit();
+  auto const tmp_path = m_checkpoint_path + ".tmp";
+  {
+    std::ofstream os(tmp_path, std::ios::binary | std::ios::trunc);
+    save(os, m_map);
+    os.close();
+    if (!os)
+    {
+      throw std::system_error(errno, std::generic_category(), tmp_path);
+    }
+  }
+  if (m_options.sync)
+  {
+    sync_file(tmp_path);
+  }
+  if (std::rename(tmp_path.c_str(), m_checkpoint_path.c_str()) != 0)
+  {
+    throw std::system_error(errno, std::generic_category(), m_checkpoint_path);
+  }
+  // The rename must be durable before the log is truncated, or a power
+  // loss could keep the truncation but lose the new checkpoint.
+  if (m_options.sync)
+  {
+    sync_directory(m_checkpoint_path);
+  }
+  auto const header_size = static_cast<off_t>(log_header().size());
+  if (::ftruncate(m_log_fd, header_size) != 0)
+  {
+    throw std::system_error(errno, std::generic_category(), m_log_path);
+  }
+  m_log_size = header_size;
+}
+
+template <typename Key, typename Value, typename Compare>
+void logged_flatmap<Key, Value, Compare>::sync_file(const std::string& path)
+{
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0 || ::fsync(fd) != 0)
+  {
+    auto const err = errno;
+    if (fd >= 0) ::close(fd);
+    throw std::system_error(err, std::generic_category(), path);
+  }
+  ::close(fd);
+}
+
+template <typename Key, typename Value, typename Compare>
+void logged_flatmap<Key, Value, Compare>::sync_directory(const std::string& path)
+{
+  auto const slash = path.rfind('/');
+  auto const dir = slash == std::string::npos ? std::string(".") : slash == 0 ? std::string("/") : path.substr(0, slash);
+  int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0 || ::fsync(fd) != 0)
+  {
+    auto const err = errno;
+    if (fd >= 0) ::close(fd);
+    throw std::system_error(err, std::generic_category(), dir);
+  }
+  ::close(fd);
+}
+
+template <typename Key, typename Value, typename Compare>
+void logged_flatmap<Key, Value, Compare>::recover()
+{
+  if (std::ifstream is{m_checkpoint_path, std::ios::binary})
+  {
+    load(is, m_map);
+  }
+  apply(read_log());
+}
+
+template <typename Key, typename Value, typename Compare>
+auto logged_flatmap<Key, Value, Compare>::read_log() -> std::vector<delta>
+{
+  std::vector<delta> deltas;
+  std::ifstream is{m_log_path, std::ios::binary};
+  if (!is) return deltas;
+  auto const header = log_header();
+  std::string found(header.size(), '\0');
+  is.read(found.data(), static_cast<std::streamsize>(found.size()));
+  found.resize(static_cast<std::size_t>(is.gcount()));
+  if (found.size() < header.size() && header.compare(0, found.size(), found) == 0)
+  {
+    // empty, or a header torn by a crash right after creating the log
+    is.close();
+    if (::truncate(m_log_path.c_str(), 0) != 0)
+    {
+      throw std::system_error(errno, std::generic_category(), m_log_path);
+    }
+    return deltas;
+  }
+  if (found != header)
+  {
+    throw std::runtime_error("not a logged_flatmap log of this type, or unsupported version: " + m_log_path);
+  }
+  auto good_size = static_cast<std::streamoff>(header.size());
+  try
+  {
+    std::uint8_t o_byte;
+    while (is.read(reinterpret_cast<char*>(&o_byte), sizeof(o_byte)))
+    {
+      if (o_byte != static_cast<std::uint8_t>(op::upsert) && o_byte != static_cast<std::uint8_t>(op::erase))
+      {
+        break;
+      }
+      delta d;
+      serialization::column_codec<Key>::read(is, &d.first, &d.first + 1, serialization::identity{});
+      if (o_byte == static_cast<std::uint8_t>(op::upsert))
+      {
+        d.second.emplace();
+        serialization::column_codec<Value>::read(is, &*d.second, &*d.second + 1, serialization::identity{});
+      }
+      deltas.push_back(std::move(d));
+      good_size = is.tellg();
+    }
+  }
+  catch (const std::runtime_error&)
+  {
+    // torn record at the end of the log
+  }
+  is.close();
+  if (::truncate(m_log_path.c_str(), good_size) != 0)
+  {
+    throw std::system_error(errno, std::generic_category(), m_log_path);
+  }
+  return deltas;
+}
+
+// Applies the log in one merge pass over the checkpointed state, rather
+// than one insert or erase per record. Only the last record for each key
+// matters.
+template <typename Key, typename Value, typename Compare>
+void logged_flatmap<Key, Value, Compare>::apply(std::vector<delta> deltas)
+{
+  if (deltas.empty()) return;
+  auto& comp = impl::storage_access::compare(m_map);
+  std::stable_sort(deltas.begin(), deltas.end(),
+                   [&comp](const delta& lh, const delta& rh) { return comp(lh.first, rh.first);});
+  auto& values = impl::storage_access::values(m_map);
+  std::remove_reference_t<decltype(values)> merged;
+  merged.reserve(values.size() + deltas.size());
+  auto v = values.begin();
+  for (auto d = deltas.begin(); d != deltas.end();)
+  {
+    auto last = d;
+    while (std::next(last) != deltas.end() && !comp(d->first, std::next(last)->first))
+    {
+      ++last;
+    }
+    while (v != values.end() && comp(v->first, last->first))
+    {
+      merged.push_back(std::move(*v++));
+    }
+    if (v != values.end() && !comp(last->first, v->first))
+    {
+      ++v;
+    }
+    if (last->second)
+    {
+      merged.emplace_back(std::move(last->first), std::move(*last->second));
+    }
+    d = std::next(last);
+  }
+  std::move(v, values.end(), std::back_inserter(merged));
+  values.swap(merged);
+}
+
+#endif //FLATMAP_LOGGED_FLATMAP_HPP
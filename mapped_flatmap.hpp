@@ -0,0 +1,334 @@
+#ifndef FLATMAP_MAPPED_FLATMAP_HPP
+#define FLATMAP_MAPPED_FLATMAP_HPP
+
+#include "flatmap.hpp"
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <ostream>
+#include <fstream>
+#include <string>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// On disk layout of a sorted map with trivially copyable keys and values:
+// a header followed by the key column and the value column, each starting
+// on a column_alignment boundary. Data is stored in native byte order.
+class flatmap_image
+{
+public:
+  static constexpr std::uint32_t version = 1;
+  static constexpr std::uint64_t column_alignment = 64;
+
+  struct header
+  {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t header_size;
+    std::uint64_t count;
+    std::uint32_t key_size;
+    std::uint32_t key_align;
+    std::uint32_t value_size;
+    std::uint32_t value_align;
+    std::uint64_t key_offset;
+    std::uint64_t value_offset;
+    std::uint64_t file_size;
+  };
+
+  template <typename Map>
+  static void write(std::ostream& os, const Map& map);
+  template <typename Map>
+  static void write(const std::string& filename, const Map& map);
+
+  template <typename Key, typename Value>
+  static header make_header(std::uint64_t count) noexcept;
+  template <typename Key, typename Value>
+  static void validate(const header& h, std::uint64_t file_size);
+private:
+  static constexpr char magic[8] = { 'F', 'L', 'A', 'T', 'M', 'A', 'P', '\0' };
+  static constexpr std::uint64_t align(std::uint64_t n) noexcept
+  {
+    return (n + column_alignment - 1) / column_alignment * column_alignment;
+  }
+  static void pad(std::ostream& os, std::uint64_t from, std::uint64_t to)
+  {
+    static const char zeros[column_alignment] = {};
+    os.write(zeros, static_cast<std::streamsize>(to - from));
+  }
+};
+
+template <typename Key, typename Value, typename Compare = std::less<>>
+class mapped_flatmap : private Compare
+{
+  static_assert(std::is_trivially_copyable<Key>{});
+  static_assert(std::is_trivially_copyable<Value>{});
+  static_assert(alignof(Key) <= flatmap_image::column_alignment);
+  static_assert(alignof(Value) <= flatmap_image::column_alignment);
+public:
+  using key_type = Key;
+  using mapped_type = Value;
+  using value_type = std::pair<Key, Value>;
+  using size_type = std::size_t;
+  class const_iterator;
+  using iterator = const_iterator;
+
+  explicit mapped_flatmap(const std::string& filename);
+  mapped_flatmap(mapped_flatmap&& m) noexcept;
+  mapped_flatmap& operator=(mapped_flatmap&& m) noexcept;
+  ~mapped_flatmap();
+
+  bool empty() const noexcept { return m_size == 0;}
+  size_type size() const noexcept { return m_size;}
+  const_iterator begin() const noexcept { return { *this, 0 };}
+  const_iterator end() const noexcept { return { *this, m_size };}
+  const_iterator cbegin() const noexcept { return begin();}
+  const_iterator cend() const noexcept { return end();}
+
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, Key, T>{}>>
+  const_iterator find(const T& key) const noexcept;
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, Key, T>{}>>
+  size_type count(const T& key) const noexcept { return find(key) == end() ? 0 : 1;}
+private:
+  void unmap() noexcept;
+
+  void*        m_mapping = nullptr;
+  std::size_t  m_mapping_size = 0;
+  const Key*   m_keys = nullptr;
+  const Value* m_values = nullptr;
+  size_type    m_size = 0;
+};
+
+template <typename Key, typename Value, typename Compare>
+class mapped_flatmap<Key, Value, Compare>::const_iterator
+{
+  using data = std::pair<const Key&, const Value&>;
+public:
+  class data_ptr
+  {
+  public:
+    data_ptr(const Key& k, const Value& v) : m{k,v} {}
+    const data* operator->() const { return &m; }
+  private:
+    data m;
+  };
+  using value_type = typename mapped_flatmap::value_type;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using reference = data;
+  using pointer = data_ptr;
+  using difference_type = std::ptrdiff_t;
+
+  constexpr const_iterator() noexcept = default;
+  constexpr const_iterator(const mapped_flatmap& m_, size_type idx_) noexcept : m{&m_}, idx{idx_} {}
+  constexpr const_iterator& operator++() noexcept { ++idx; return *this;}
+  constexpr const_iterator operator++(int) noexcept { auto rv = *this; operator++();return rv;}
+  constexpr const_iterator& operator--() noexcept { --idx;return *this;}
+  constexpr const_iterator operator--(int) noexcept { auto rv = *this; operator--();return rv;}
+  constexpr reference operator*() const noexcept { return {m->m_keys[idx], m->m_values[idx]};}
+  constexpr pointer operator->() const noexcept { return {m->m_keys[idx], m->m_values[idx]};}
+  constexpr bool operator==(const const_iterator& ci) const noexcept { return m == ci.m && idx == ci.idx;}
+  constexpr bool operator!=(const const_iterator& ci) const noexcept { return !(*this == ci);}
+private:
+  const mapped_flatmap* m = nullptr;
+  size_type idx = 0;
+};
+
+template <typename Key, typename Value>
+inline auto flatmap_image::make_header(std::uint64_t count) noexcept -> header
+{
+  header h{};
+  std::memcpy(h.magic, magic, sizeof(magic));
+  h.version = version;
+  h.header_size = sizeof(header);
+  h.count = count;
+  h.key_size = sizeof(Key);
+  h.key_align = alignof(Key);
+  h.value_size = sizeof(Value);
+  h.value_align = alignof(Value);
+  h.key_offset = align(sizeof(header));
+  h.value_offset = align(h.key_offset + count * sizeof(Key));
+  h.file_size = h.value_offset + count * sizeof(Value);
+  return h;
+}
+
+template <typename Key, typename Value>
+inline void flatmap_image::validate(const header& h, std::uint64_t file_size)
+{
+  if (file_size < sizeof(header) || std::memcmp(h.magic, magic, sizeof(magic)) != 0)
+  {
+    throw std::runtime_error("not a flatmap image");
+  }
+  if (h.version != version || h.header_size != sizeof(header))
+  {
+    throw std::runtime_error("unsupported flatmap image version " + std::to_string(h.version));
+  }
+  if (h.key_size != sizeof(Key) || h.key_align != alignof(Key) ||
+      h.value_size != sizeof(Value) || h.value_align != alignof(Value))
+  {
+    throw std::runtime_error("flatmap image key or value type mismatch");
+  }
+  // A count from the file must not make the column sizes wrap around, or
+  // a crafted image could match the expected offsets and point the
+  // columns outside the mapping.
+  if (h.key_offset != align(sizeof(header)) || h.key_offset > file_size ||
+      h.value_offset > file_size ||
+      h.count > (file_size - h.key_offset) / (sizeof(Key) + sizeof(Value)))
+  {
+    throw std::runtime_error("truncated or corrupt flatmap image");
+  }
+  auto const expected = make_header<Key, Value>(h.count);
+  if (h.key_offset != expected.key_offset || h.value_offset != expected.value_offset ||
+      h.file_size != expected.file_size || file_size < h.file_size)
+  {
+    throw std::runtime_error("truncated or corrupt flatmap image");
+  }
+}
+
+template <typename Map>
+inline void flatmap_image::write(std::ostream& os, const Map& map)
+{
+  using key_type = std::decay_t<decltype(map.begin()->first)>;
+  using mapped_type = std::decay_t<decltype(map.begin()->second)>;
+  static_assert(std::is_trivially_copyable<key_type>{});
+  static_assert(std::is_trivially_copyable<mapped_type>{});
+  static_assert(alignof(key_type) <= column_alignment);
+  static_assert(alignof(mapped_type) <= column_alignment);
+
+  auto const h = make_header<key_type, mapped_type>(map.size());
+  os.write(reinterpret_cast<const char*>(&h), sizeof(h));
+  pad(os, sizeof(h), h.key_offset);
+  for (auto&& elem : map)
+  {
+    os.write(reinterpret_cast<const char*>(std::addressof(elem.first)), sizeof(key_type));
+  }
+  pad(os, h.key_offset + h.count * sizeof(key_type), h.value_offset);
+  for (auto&& elem : map)
+  {
+    os.write(reinterpret_cast<const char*>(std::addressof(elem.second)), sizeof(mapped_type));
+  }
+  if (!os)
+  {
+    throw std::runtime_error("failed writing flatmap image");
+  }
+}
+
+template <typename Map>
+inline void flatmap_image::write(const std::string& filename, const Map& map)
+{
+  std::ofstream os(filename, std::ios::binary | std::ios::trunc);
+  if (!os)
+  {
+    throw std::system_error(errno, std::generic_category(), filename);
+  }
+  write(os, map);
+  os.close();
+  if (!os)
+  {
+    throw std::system_error(errno, std::generic_category(), filename);
+  }
+}
+
+template <typename Key, typename Value, typename Compare>
+inline mapped_flatmap<Key, Value, Compare>::mapped_flatmap(const std::string& filename)
+{
+  int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    throw std::system_error(errno, std::generic_category(), filename);
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0)
+  {
+    auto err = errno;
+    ::close(fd);
+    throw std::system_error(err, std::generic_category(), filename);
+  }
+  auto const file_size = static_cast<std::size_t>(st.st_size);
+  if (file_size < sizeof(flatmap_image::header))
+  {
+    ::close(fd);
+    throw std::runtime_error("not a flatmap image: " + filename);
+  }
+  void* p = ::mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+  auto err = errno;
+  ::close(fd);
+  if (p == MAP_FAILED)
+  {
+    throw std::system_error(err, std::generic_category(), filename);
+  }
+  m_mapping = p;
+  m_mapping_size = file_size;
+  auto const base = static_cast<const char*>(p);
+  auto const& h = *reinterpret_cast<const flatmap_image::header*>(base);
+  try
+  {
+    flatmap_image::validate<Key, Value>(h, file_size);
+  }
+  catch (...)
+  {
+    unmap();
+    throw;
+  }
+  m_size = h.count;
+  m_keys = reinterpret_cast<const Key*>(base + h.key_offset);
+  m_values = reinterpret_cast<const Value*>(base + h.value_offset);
+}
+
+template <typename Key, typename Value, typename Compare>
+inline mapped_flatmap<Key, Value, Compare>::mapped_flatmap(mapped_flatmap&& m) noexcept
+  : Compare(std::move(m))
+  , m_mapping{std::exchange(m.m_mapping, nullptr)}
+  , m_mapping_size{std::exchange(m.m_mapping_size, 0)}
+  , m_keys{std::exchange(m.m_keys, nullptr)}
+  , m_values{std::exchange(m.m_values, nullptr)}
+  , m_size{std::exchange(m.m_size, 0)}
+{
+}
+
+template <typename Key, typename Value, typename Compare>
+inline auto mapped_flatmap<Key, Value, Compare>::operator=(mapped_flatmap&& m) noexcept -> mapped_flatmap&
+{
+  if (this != &m)
+  {
+    unmap();
+    static_cast<Compare&>(*this) = std::move(static_cast<Compare&>(m));
+    m_mapping = std::exchange(m.m_mapping, nullptr);
+    m_mapping_size = std::exchange(m.m_mapping_size, 0);
+    m_keys = std::exchange(m.m_keys, nullptr);
+    m_values = std::exchange(m.m_values, nullptr);
+    m_size = std::exchange(m.m_size, 0);
+  }
+  return *this;
+}
+
+template <typename Key, typename Value, typename Compare>
+inline mapped_flatmap<Key, Value, Compare>::~mapped_flatmap()
+{
+  unmap();
+}
+
+template <typename Key, typename Value, typename Compare>
+inline void mapped_flatmap<Key, Value, Compare>::unmap() noexcept
+{
+  if (m_mapping)
+  {
+    ::munmap(m_mapping, m_mapping_size);
+    m_mapping = nullptr;
+  }
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename T, typename>
+inline auto mapped_flatmap<Key, Value, Compare>::find(const T& key) const noexcept -> const_iterator
+{
+  const Compare& comp = *this;
+  auto [ i, exact_match ] = impl::search_keys(m_keys, m_keys + m_size, key, comp,
+                                              tuning::thresholds<Key>::linear_search_max);
+  return exact_match ? const_iterator{ *this, static_cast<size_type>(i - m_keys)} : end();
+}
+
+#endif //FLATMAP_MAPPED_FLATMAP_HPP
@@ -0,0 +1,450 @@
+#ifndef FLATMAP_SLOT_FLATMAP_HPP
+#define FLATMAP_SLOT_FLATMAP_HPP
+
+#include "flatmap.hpp"
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace impl
+{
+  // Values in blocks of block_size slots that never move, numbered with 32
+  // bit slot numbers. Released slots are reused, last released first. The
+  // pool does not know which slots hold values, so its owner destroys them
+  // before the pool goes away.
+  template <typename Value>
+  class slot_pool
+  {
+  public:
+    using slot = std::uint32_t;
+    static constexpr slot block_size = 256;
+
+    slot_pool() = default;
+    slot_pool(slot_pool&& rh) noexcept;
+    slot_pool& operator=(slot_pool&& rh) noexcept;
+
+    void swap(slot_pool& rh) noexcept;
+
+    Value& operator[](slot s) noexcept { return address(s)[0];}
+    const Value& operator[](slot s) const noexcept { return const_cast<slot_pool&>(*this)[s];}
+
+    // Constructs a value from a in a free slot. If that throws, the pool is
+    // unchanged.
+    template <typename ... A>
+    slot acquire(A&& ... a);
+    void release(slot s) noexcept;
+    // Makes all slots free, once the owner has destroyed their values.
+    void reset() noexcept;
+  private:
+    struct block
+    {
+      alignas(Value) unsigned char bytes[block_size * sizeof(Value)];
+    };
+    Value* address(slot s) noexcept
+    {
+      return reinterpret_cast<Value*>(m_blocks[s / block_size]->bytes) + s % block_size;
+    }
+
+    std::vector<std::unique_ptr<block>> m_blocks;
+    std::vector<slot>                   m_free;
+    slot                                m_used = 0;
+  };
+
+  template <typename Value>
+  slot_pool<Value>::slot_pool(slot_pool&& rh) noexcept
+    : m_blocks(std::move(rh.m_blocks))
+    , m_free(std::move(rh.m_free))
+    , m_used(std::exchange(rh.m_used, 0))
+  {
+  }
+
+  template <typename Value>
+  auto slot_pool<Value>::operator=(slot_pool&& rh) noexcept -> slot_pool&
+  {
+    slot_pool(std::move(rh)).swap(*this);
+    return *this;
+  }
+
+  template <typename Value>
+  void slot_pool<Value>::swap(slot_pool& rh) noexcept
+  {
+    m_blocks.swap(rh.m_blocks);
+    m_free.swap(rh.m_free);
+    std::swap(m_used, rh.m_used);
+  }
+
+  template <typename Value>
+  template <typename ... A>
+  auto slot_pool<Value>::acquire(A&& ... a) -> slot
+  {
+    if (m_free.empty())
+    {
+      if (m_used == std::numeric_limits<slot>::max())
+      {
+        throw std::length_error("slot_pool: out of 32 bit slots");
+      }
+      if (m_used == m_blocks.size() * block_size)
+      {
+        m_free.reserve(m_blocks.size() * block_size + block_size);
+        m_blocks.push_back(std::make_unique<block>());
+      }
+      ::new(address(m_used)) Value(std::forward<A>(a)...);
+      return m_used++;
+    }
+    auto const s = m_free.back();
+    ::new(address(s)) Value(std::forward<A>(a)...);
+    m_free.pop_back();
+    return s;
+  }
+
+  template <typename Value>
+  void slot_pool<Value>::release(slot s) noexcept
+  {
+    address(s)->~Value();
+    // Cannot allocate, since acquire reserves room for every slot.
+    m_free.push_back(s);
+  }
+
+  template <typename Value>
+  void slot_pool<Value>::reset() noexcept
+  {
+    m_free.clear();
+    m_used = 0;
+  }
+}
+
+// A sorted map whose values live out of line, in an impl::slot_pool. The
+// sorted columns hold the keys and 32 bit slot numbers, so inserts and
+// erases shift only those, however large the values are. A value stays
+// at its address until its element is erased, so references to values
+// survive other inserts and erases. Iterators do not, as for
+// split_flatmap.
+template <typename Key, typename Value, typename Compare = std::less<>>
+class slot_flatmap : private Compare
+{
+  static_assert(std::is_nothrow_move_constructible<Key>{});
+  using pool = impl::slot_pool<Value>;
+  using slot = typename pool::slot;
+  using columns = impl::split_columns<Key, slot>;
+public:
+  using key_type = Key;
+  using mapped_type = Value;
+  using value_type = std::pair<Key, Value>;
+  using size_type = std::size_t;
+  template <typename container>
+  class iterator_type;
+  using iterator = iterator_type<slot_flatmap>;
+  using const_iterator = iterator_type<const slot_flatmap>;
+
+  slot_flatmap() = default;
+  slot_flatmap(std::initializer_list<value_type> list);
+  slot_flatmap(const slot_flatmap& rh);
+  slot_flatmap(slot_flatmap&& rh) noexcept = default;
+  slot_flatmap& operator=(const slot_flatmap& rh);
+  slot_flatmap& operator=(slot_flatmap&& rh) noexcept;
+  ~slot_flatmap();
+
+  void swap(slot_flatmap& rh) noexcept;
+
+  void clear() noexcept;
+  bool empty() const noexcept { return m_columns.empty();}
+  size_type size() const noexcept { return m_columns.size();}
+  iterator begin() noexcept { return { *this, 0 };}
+  iterator end() noexcept { return { *this, size() };}
+  const_iterator begin() const noexcept { return { *this, 0 };}
+  const_iterator end() const noexcept { return { *this, size() };}
+  const_iterator cbegin() const noexcept { return begin();}
+  const_iterator cend() const noexcept { return end();}
+
+  template <typename K, typename = std::enable_if_t<type_traits::is_callable<Compare, K, Key>{}>>
+  size_type count(const K& key) const noexcept { return find_index(key).second ? 1 : 0;}
+  std::pair<iterator, bool> insert(const value_type& v) { return try_emplace(v.first, v.second);}
+  std::pair<iterator, bool> insert(value_type&& v) { return try_emplace(std::move(v.first), std::move(v.second));}
+  template <typename K,
+            typename V,
+            typename = std::enable_if_t<type_traits::is_callable<Compare, Key, K>{} && std::is_constructible<Value, V>{} && std::is_assignable<Value&, V>{}>>
+  std::pair<iterator, bool> insert_or_assign(K&& k, V&& v);
+  template <typename ... T, typename = std::enable_if_t<std::is_constructible<value_type, T...>{}>>
+  std::pair<iterator, bool> emplace(T&& ... t) { return insert(value_type(std::forward<T>(t)...));}
+  template <typename K,
+            typename ... V,
+            typename = std::enable_if_t<type_traits::is_callable<Compare, Key, K>{} && std::is_constructible<Value, V...>{}>>
+  std::pair<iterator, bool> try_emplace(K&& key, V&& ... v);
+  void erase(iterator i) noexcept;
+  template <typename K, typename = std::enable_if_t<type_traits::is_callable<Compare, K, Key>{}>>
+  size_type erase(const K& key) noexcept;
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, Key, T>{}>>
+  Value& operator[](const T& key);
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, Key, T>{}>>
+  iterator find(const T& key) noexcept;
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, Key, T>{}>>
+  const_iterator find(const T& key) const noexcept;
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, Key, T>{}>>
+  iterator lower_bound(const T& key) noexcept { return { *this, find_index(key).first };}
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, Key, T>{}>>
+  const_iterator lower_bound(const T& key) const noexcept { return { *this, find_index(key).first };}
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, Key, T>{}>>
+  iterator upper_bound(const T& key) noexcept { return { *this, upper_index(key)};}
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, Key, T>{}>>
+  const_iterator upper_bound(const T& key) const noexcept { return { *this, upper_index(key)};}
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, Key, T>{}>>
+  std::pair<iterator, iterator> equal_range(const T& key) noexcept;
+  template <typename T, typename = std::enable_if_t<type_traits::is_callable<Compare, Key, T>{}>>
+  std::pair<const_iterator, const_iterator> equal_range(const T& key) const noexcept;
+private:
+  const Compare& compare() const noexcept { return *this;}
+  template <typename T>
+  std::pair<size_type, bool> find_index(const T& t) const noexcept;
+  template <typename T>
+  size_type upper_index(const T& t) const noexcept;
+  void destroy_values() noexcept;
+
+  columns m_columns;
+  pool    m_pool;
+};
+
+template <typename Key, typename Value, typename Compare>
+template <typename container>
+class slot_flatmap<Key, Value, Compare>::iterator_type
+{
+  template <typename C>
+  friend class slot_flatmap<Key, Value, Compare>::iterator_type;
+  using mapped = std::conditional_t<std::is_const<container>{}, const Value, Value>;
+  using data = std::pair<const Key&, mapped&>;
+public:
+  class data_ptr
+  {
+  public:
+    data_ptr(const Key& k, mapped& v) : m{k,v} {}
+    data* operator->() { return &m; }
+  private:
+    data m;
+  };
+  using value_type = typename slot_flatmap::value_type;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using reference = data;
+  using pointer = data_ptr;
+  using difference_type = std::ptrdiff_t;
+
+  constexpr iterator_type() noexcept = default;
+  constexpr iterator_type(container& c_, size_type idx_) noexcept : c{&c_}, idx{idx_} {}
+  template <typename C, typename = std::enable_if_t<std::is_convertible<C*, container*>{}>>
+  constexpr iterator_type(const iterator_type<C>& i) noexcept : c{i.c}, idx{i.idx} {}
+  constexpr iterator_type& operator++() noexcept { ++idx; return *this;}
+  constexpr iterator_type operator++(int) noexcept { auto rv = *this; operator++();return rv;}
+  constexpr iterator_type& operator--() noexcept { --idx;return *this;}
+  constexpr iterator_type operator--(int) noexcept { auto rv = *this; operator--();return rv;}
+  reference operator*() const noexcept { return {c->m_columns.keys()[idx], c->m_pool[c->m_columns.values()[idx]]};}
+  pointer operator->() const noexcept { return {c->m_columns.keys()[idx], c->m_pool[c->m_columns.values()[idx]]};}
+  template <typename C>
+  constexpr bool operator==(const iterator_type<C>& ci) const noexcept
+  {
+    return c == ci.c && idx == ci.idx;
+  }
+  template <typename C>
+  constexpr bool operator!=(const iterator_type<C>& ci) const noexcept
+  {
+    return !(*this == ci);
+  }
+  friend size_type index(iterator_type i) noexcept { return i.idx;}
+private:
+  container* c = nullptr;
+  size_type idx = 0;
+};
+
+template <typename Key, typename Value, typename Compare>
+slot_flatmap<Key, Value, Compare>::slot_flatmap(std::initializer_list<value_type> list)
+  : slot_flatmap()
+{
+  for (auto& x : list)
+  {
+    insert(x);
+  }
+}
+
+template <typename Key, typename Value, typename Compare>
+slot_flatmap<Key, Value, Compare>::slot_flatmap(const slot_flatmap& rh)
+  : slot_flatmap()
+{
+  static_cast<Compare&>(*this) = rh;
+  m_columns.reserve(rh.size());
+  for (size_type i = 0; i != rh.size(); ++i)
+  {
+    auto const s = m_pool.acquire(rh.m_pool[rh.m_columns.values()[i]]);
+    try
+    {
+      m_columns.emplace(i, rh.m_columns.keys()[i], s);
+    }
+    catch (...)
+    {
+      m_pool.release(s);
+      throw;
+    }
+  }
+}
+
+template <typename Key, typename Value, typename Compare>
+auto slot_flatmap<Key, Value, Compare>::operator=(const slot_flatmap& rh) -> slot_flatmap&
+{
+  if (this != &rh)
+  {
+    slot_flatmap(rh).swap(*this);
+  }
+  return *this;
+}
+
+template <typename Key, typename Value, typename Compare>
+auto slot_flatmap<Key, Value, Compare>::operator=(slot_flatmap&& rh) noexcept -> slot_flatmap&
+{
+  slot_flatmap(std::move(rh)).swap(*this);
+  return *this;
+}
+
+template <typename Key, typename Value, typename Compare>
+slot_flatmap<Key, Value, Compare>::~slot_flatmap()
+{
+  destroy_values();
+}
+
+template <typename Key, typename Value, typename Compare>
+void slot_flatmap<Key, Value, Compare>::swap(slot_flatmap& rh) noexcept
+{
+  using std::swap;
+  swap(static_cast<Compare&>(*this), static_cast<Compare&>(rh));
+  m_columns.swap(rh.m_columns);
+  m_pool.swap(rh.m_pool);
+}
+
+template <typename Key, typename Value, typename Compare>
+void slot_flatmap<Key, Value, Compare>::destroy_values() noexcept
+{
+  auto const slots = m_columns.values();
+  for (size_type i = 0; i != size(); ++i)
+  {
+    m_pool[slots[i]].~Value();
+  }
+}
+
+template <typename Key, typename Value, typename Compare>
+void slot_flatmap<Key, Value, Compare>::clear() noexcept
+{
+  destroy_values();
+  m_columns.clear();
+  m_pool.reset();
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename T>
+auto slot_flatmap<Key, Value, Compare>::find_index(const T& t) const noexcept -> std::pair<size_type, bool>
+{
+  auto const first = m_columns.keys();
+  auto [ i, exact_match ] = impl::search_keys(first, first + size(), t, compare(),
+                                              tuning::thresholds<Key>::linear_search_max);
+  return { static_cast<size_type>(i - first), exact_match };
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename T>
+auto slot_flatmap<Key, Value, Compare>::upper_index(const T& t) const noexcept -> size_type
+{
+  auto const first = m_columns.keys();
+  return static_cast<size_type>(std::upper_bound(first, first + size(), t, compare()) - first);
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename K, typename ... V, typename>
+auto slot_flatmap<Key, Value, Compare>::try_emplace(K&& key, V&& ... v) -> std::pair<iterator, bool>
+{
+  auto const [ idx, exact_match ] = find_index(key);
+  if (exact_match)
+  {
+    return { { *this, idx }, false };
+  }
+  auto const s = m_pool.acquire(std::forward<V>(v)...);
+  try
+  {
+    m_columns.emplace(idx, std::forward<K>(key), s);
+  }
+  catch (...)
+  {
+    m_pool.release(s);
+    throw;
+  }
+  return { { *this, idx }, true };
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename K, typename V, typename>
+auto slot_flatmap<Key, Value, Compare>::insert_or_assign(K&& k, V&& v) -> std::pair<iterator, bool>
+{
+  auto const [ idx, exact_match ] = find_index(k);
+  if (exact_match)
+  {
+    m_pool[m_columns.values()[idx]] = std::forward<V>(v);
+    return { { *this, idx }, false };
+  }
+  return try_emplace(std::forward<K>(k), std::forward<V>(v));
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename T, typename>
+auto slot_flatmap<Key, Value, Compare>::operator[](const T& key) -> Value&
+{
+  auto [ i, inserted ] = try_emplace(key);
+  static_cast<void>(inserted);
+  return i->second;
+}
+
+template <typename Key, typename Value, typename Compare>
+void slot_flatmap<Key, Value, Compare>::erase(iterator i) noexcept
+{
+  auto const s = m_columns.values()[index(i)];
+  m_columns.erase(index(i));
+  m_pool.release(s);
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename K, typename>
+auto slot_flatmap<Key, Value, Compare>::erase(const K& key) noexcept -> size_type
+{
+  auto const [ idx, exact_match ] = find_index(key);
+  if (!exact_match) return 0;
+  erase(iterator{ *this, idx });
+  return 1;
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename T, typename>
+auto slot_flatmap<Key, Value, Compare>::find(const T& key) noexcept -> iterator
+{
+  auto const [ idx, exact_match ] = find_index(key);
+  return exact_match ? iterator{ *this, idx } : end();
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename T, typename>
+auto slot_flatmap<Key, Value, Compare>::find(const T& key) const noexcept -> const_iterator
+{
+  auto const [ idx, exact_match ] = find_index(key);
+  return exact_match ? const_iterator{ *this, idx } : end();
+}
+template <typename Key, typename Value, typename Compare>
+template <typename T, typename>
+auto slot_flatmap<Key, Value, Compare>::equal_range(const T& key) noexcept -> std::pair<iterator, iterator>
+{
+  auto const [ idx, exact_match ] = find_index(key);
+  return { iterator{ *this, idx }, iterator{ *this, idx + exact_match } };
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename T, typename>
+auto slot_flatmap<Key, Value, Compare>::equal_range(const T& key) const noexcept -> std::pair<const_iterator, const_iterator>
+{
+  auto const [ idx, exact_match ] = find_index(key);
+  return { const_iterator{ *this, idx }, const_iterator{ *this, idx + exact_match } };
+}
+
+#endif //FLATMAP_SLOT_FLATMAP_HPP